@@ -0,0 +1,61 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 40
+
+        // Opérations arithmétiques et logiques (résultats rangés dans les
+        // données) et comparaisons
+main    EQU *
+        LOAD R01, #-7
+        MUL R01, #6             // -42
+        STORE R01, @rmul
+        LOAD R02, #-7
+        DIV R02, #2             // -3 (quotient tronqué vers 0)
+        STORE R02, @rdiv
+        LOAD R03, #-7
+        MOD R03, @two           // -1 (signe du dividende)
+        STORE R03, @rmod
+        LOAD R04, @min
+        DIV R04, #-1            // 0x80000000 (dépassement ignoré)
+        STORE R04, @rmin
+        LOAD R05, #0xF0F0
+        AND R05, #0x0FF0        // 0x00F0
+        OR R05, #0x1000         // 0x10F0
+        XOR R05, 1[R00]         // 0x100F (R00 = 0, Data[1] = 0xFF)
+        STORE R05, @rlogic
+        LOAD R06, #1
+        SHL R06, #33            // 2 (décalage modulo 32)
+        STORE R06, @rshl
+        LOAD R07, @min
+        SHR R07, #4             // 0x08000000 (décalage logique)
+        STORE R07, @rshr
+        LOAD R08, #5
+        CMP R08, #7             // R08 < 7, R08 inchangé
+        BRANCH GE, @bad
+        CMP R08, @five
+        BRANCH NE, @bad
+        CMP R08, #-1
+        BRANCH LE, @bad
+        LOAD R09, #1            // toutes les comparaisons sont correctes
+bad     HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+two     WORD 2
+mask    WORD 0xFF
+five    WORD 5
+min     WORD 0x80000000
+rmul    WORD 0
+rdiv    WORD 0
+rmod    WORD 0
+rmin    WORD 0
+rlogic  WORD 0
+rshl    WORD 0
+rshr    WORD 0
+
+        END
@@ -0,0 +1,46 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Copies de blocs (avec recouvrement dans les deux sens) et
+        // remplissage
+main    EQU *
+        LOAD R01, #4
+        LOAD R02, #src
+        LOAD R03, #dst
+        MOVE R01, R03, R02      // dst <- 1 2 3 4
+        LOAD R03, #1
+        ADD R03, #src
+        MOVE R01, R03, R02      // src+1 <- src (recouvrement) : 1 1 2 3 4
+        MOVE R01, R02, R03      // src <- src+1 (recouvrement) : 1 2 3 4 4
+        LOAD R04, #3
+        LOAD R05, #-1
+        LOAD R06, #fill
+        FILL R04, R06, R05      // fill <- -1 -1 -1
+        LOAD R07, #0
+        FILL R07, R06, R07      // bloc vide : rien n'est écrit
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+src     WORD 1
+        WORD 2
+        WORD 3
+        WORD 4
+        WORD 0
+dst     WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+fill    WORD 0
+        WORD 0
+        WORD 0
+        WORD 7
+
+        END
@@ -0,0 +1,33 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Recopie de la file d'entrée dans la file de sortie, chaque mot
+        // augmenté de 1, jusqu'à la fin de l'entrée ; count reçoit le
+        // nombre de mots recopiés
+devin   EQU 0xFFFF0
+devcnt  EQU 0xFFFF1
+devout  EQU 0xFFFF2
+
+main    EQU *
+loop    LOAD R01, @devcnt
+        BRANCH EQ, @done
+        LOAD R02, @devin
+        ADD R02, #1
+        STORE R02, @devout
+        ADD R03, #1
+        BRANCH NC, @loop
+done    STORE R03, @count
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+count   WORD 0
+
+        END
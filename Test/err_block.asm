@@ -0,0 +1,23 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Bloc source qui déborde du segment de données
+main    EQU *
+        LOAD R01, #4
+        LOAD R02, #28
+        LOAD R03, #0
+        MOVE R01, R03, R02
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+        WORD 5
+
+        END
@@ -0,0 +1,22 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Division par zéro (opérande en mémoire)
+main    EQU *
+        LOAD R01, #5
+        DIV R01, #1
+        MOD R01, @zero
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+zero    WORD 0
+
+        END
@@ -0,0 +1,20 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Appel d'un service qui n'existe pas
+main    EQU *
+        TRAP #40
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+        WORD 0
+
+        END
@@ -0,0 +1,23 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Écriture d'un bloc qui déborde du segment de données
+main    EQU *
+        LOAD R00, #2
+        LOAD R01, #20
+        LOAD R02, #20
+        TRAP #2
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+        WORD 0
+
+        END
@@ -0,0 +1,34 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 8
+
+        // Somme des mots de tab, rangée dans tab[0] (36) ; Test/image.img
+        // en est l'image dans l'ordre des octets étranger (simul_image -x
+        // sur un hôte petit-boutiste)
+main    EQU *
+        LOAD R01, #0
+        LOAD R02, #7
+loop    ADD R01, tab[R02]
+        SUB R02, #1
+        BRANCH GE, @loop
+        STORE R01, @tab
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 20
+
+tab     WORD 1
+        WORD 2
+        WORD 3
+        WORD 4
+        WORD 5
+        WORD 6
+        WORD 7
+        WORD 8
+
+        END
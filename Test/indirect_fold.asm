@@ -0,0 +1,26 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Branchement indexé vers le milieu d'une suite d'immédiats :
+        // l'optimiseur ne doit pas replier LOAD et ADD (R01 = 7)
+main    EQU *
+        LOAD R02, #target
+        BRANCH NC, 0[R02]
+        LOAD R01, #5
+target  ADD R01, #7
+        STORE R01, @result
+        HALT 
+        
+        END
+        
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+        
+        WORD 0
+result  WORD 0
+        
+        END
@@ -0,0 +1,42 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Chaque processeur (4 au plus) ajoute 50 fois 1 à counter par FADD,
+        // puis dépose son jeton dans x par XCHG et l'en retire par un second
+        // XCHG, chaque valeur retirée de x étant ajoutée à sum par FADD. Le
+        // dernier accès à x est un retrait : x vaut 0 à la fin et sum la
+        // somme des jetons déposés, quel que soit l'entrelacement (avec 4
+        // processeurs : counter = 200, sum = 1111)
+main    EQU *
+        LOAD R04, #50
+loop    LOAD R05, #1
+        FADD R05, @counter
+        SUB R04, #1
+        BRANCH GT, @loop
+        LOAD R05, tokens[R00]
+        XCHG R05, @x
+        FADD R05, @sum
+        LOAD R05, #0
+        XCHG R05, @x
+        FADD R05, @sum
+        LOAD R05, #0
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+counter WORD 0
+x       WORD 0
+sum     WORD 0
+tokens  WORD 1
+        WORD 10
+        WORD 100
+        WORD 1000
+
+        END
@@ -0,0 +1,57 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 10
+
+        // Données creuses (longues suites de mots nuls) : l'image
+        // Test/sparse.img les décrit par extensions (simul_image -i)
+main    EQU *
+        LOAD R01, @a
+        ADD R01, @b
+        ADD R01, @c
+        STORE R01, @sum
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 60
+
+a       WORD 1
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+b       WORD 20
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+        WORD 0
+c       WORD 300
+sum     WORD 0
+
+        END
@@ -0,0 +1,39 @@
+//-----------------
+// Instructions
+//-----------------
+        TEXT 30
+
+        // Lecture d'au plus 8 mots sur l'entrée standard (TRAP #1), recopie
+        // des mots lus sur la sortie d'erreur (TRAP #2), lecture de l'heure
+        // (TRAP #3, résultat effacé) puis arrêt avec le code de retour 3
+        // (TRAP #0)
+main    EQU *
+        LOAD R00, #0
+        LOAD R01, #buf
+        LOAD R02, #8
+        TRAP #1
+        STORE R00, @nread
+        LOAD R02, @nread
+        LOAD R00, #2
+        LOAD R01, #buf
+        TRAP #2
+        STORE R00, @nwrite
+        TRAP #3
+        LOAD R01, #0
+        LOAD R00, #3
+        TRAP #0
+        LOAD R00, #-1           // jamais exécutée
+        HALT 
+
+        END
+
+//-----------------
+// Données et pile
+//-----------------
+        DATA 30
+
+nread   WORD 0
+nwrite  WORD 0
+buf     WORD 0
+
+        END
@@ -0,0 +1,387 @@
+/*!
+ * \file archive.c
+ * \brief Archives de programmes à accès direct.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "archive.h"
+#include "image.h"
+
+//! Empreinte d'un nom de membre (FNV-1a, 64 bits)
+uint64_t archive_hash(const char *name)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const unsigned char *p = (const unsigned char *) name; *p != '\0'; ++p)
+    {
+        h ^= *p;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+//! Reconnaissance d'une archive
+bool archive_probe(const void *start, size_t len)
+{
+    uint32_t magic;
+
+    if (len < sizeof(magic))
+        return false;
+    memcpy(&magic, start, sizeof(magic));
+    return magic == ARCHIVE_MAGIC;
+}
+
+//! Vérification de l'index d'une archive projetée
+/*!
+ * \param par l'archive (\c _map et \c _len en place ; les tables sont remplies)
+ * \return NULL si l'index est valide, sinon la description de l'erreur
+ */
+static const char *archive_check(Archive *par)
+{
+    const Archive_Header *phdr = (const Archive_Header *) par->_map;
+
+    if (par->_len < sizeof(Archive_Header))
+        return archive_probe(par->_map, par->_len) ? "truncated header" : "not an archive";
+    if (phdr->_magic != ARCHIVE_MAGIC)
+        return phdr->_magic == __builtin_bswap32(ARCHIVE_MAGIC)
+            ? "foreign byte order archive" : "not an archive";
+    if (phdr->_version < 1 || phdr->_version > ARCHIVE_VERSION)
+        return "unsupported archive version";
+
+    // taille de l'index
+    uint64_t indexlen = sizeof(Archive_Header)
+        + (uint64_t) phdr->_count * (sizeof(Archive_Entry) + sizeof(Archive_Hash))
+        + phdr->_nameslen;
+    if (phdr->_nameslen % sizeof(uint32_t) != 0 || phdr->_indexlen != indexlen)
+        return "bad index size";
+    if (indexlen > par->_len)
+        return "truncated index";
+    if (image_checksum((const uint32_t *) (phdr + 1), (indexlen - sizeof(Archive_Header)) / sizeof(uint32_t))
+        != phdr->_checksum)
+        return "bad index checksum";
+
+    par->_count = phdr->_count;
+    par->_entries = (const Archive_Entry *) (phdr + 1);
+    par->_hashes = (const Archive_Hash *) (par->_entries + par->_count);
+    par->_names = (const char *) (par->_hashes + par->_count);
+
+    // membres et noms
+    for (unsigned i = 0; i < par->_count; ++i)
+    {
+        const Archive_Entry *pe = &par->_entries[i];
+        if (pe->_offset < indexlen || pe->_offset > par->_len || pe->_size > par->_len - pe->_offset)
+            return "bad member bounds";
+        if (pe->_name >= phdr->_nameslen
+            || memchr(par->_names + pe->_name, '\0', phdr->_nameslen - pe->_name) == NULL)
+            return "bad member name";
+        if (par->_hashes[i]._entry >= par->_count
+            || (i > 0 && par->_hashes[i]._hash < par->_hashes[i - 1]._hash))
+            return "bad hash table";
+    }
+    return NULL;
+}
+
+//! Ouverture d'une archive
+Archive *archive_open(const char *file)
+{
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+
+    Archive *par = (Archive *) calloc(1, sizeof(Archive));
+    if (par == NULL || (par->_file = strdup(file)) == NULL)
+    {
+        perror("archive_open.malloc");
+        exit(EXIT_FAILURE);
+    }
+    par->_len = st.st_size;
+    par->_map = par->_len > 0 ? mmap(NULL, par->_len, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (par->_map == MAP_FAILED)
+    {
+        perror("archive_open.mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    const char *err = par->_map != NULL ? archive_check(par) : "not an archive";
+    if (err != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", file, err);
+        exit(EXIT_FAILURE);
+    }
+    return par;
+}
+
+//! Fermeture d'une archive
+void archive_close(Archive *par)
+{
+    if (par->_map != NULL)
+        munmap(par->_map, par->_len);
+    free(par->_file);
+    free(par);
+}
+
+//! Nom d'un membre
+const char *archive_name(const Archive *par, unsigned index)
+{
+    return par->_names + par->_entries[index]._name;
+}
+
+//! Recherche d'un membre
+int archive_find(const Archive *par, const char *name)
+{
+    // par numéro
+    if (name[0] == '#')
+    {
+        char *end;
+        unsigned long index = strtoul(name + 1, &end, 10);
+        return end != name + 1 && *end == '\0' && index < par->_count ? (int) index : -1;
+    }
+
+    // première empreinte égale (recherche dichotomique), puis comparaison des noms
+    uint64_t h = archive_hash(name);
+    unsigned low = 0, high = par->_count;
+    while (low < high)
+    {
+        unsigned mid = low + (high - low) / 2;
+        if (par->_hashes[mid]._hash < h)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    for (; low < par->_count && par->_hashes[low]._hash == h; ++low)
+        if (strcmp(archive_name(par, par->_hashes[low]._entry), name) == 0)
+            return (int) par->_hashes[low]._entry;
+    return -1;
+}
+
+//! Chargement d'une machine depuis un membre d'une archive
+void archive_load(Machine *pmach, const Archive *par, unsigned index)
+{
+    const Archive_Entry *pe = &par->_entries[index];
+    if (load_mapped(pmach, (const char *) par->_map + pe->_offset, pe->_size,
+                    archive_name(par, index), true))
+        pmach->_archive = par; // le texte reste dans la projection
+}
+
+//! Chargement d'un programme désigné par "archive:membre"
+bool archive_read_program(Machine *pmach, const char *programfile, bool map)
+{
+    const char *sep = strrchr(programfile, ARCHIVE_SEP);
+    if (sep == NULL || sep == programfile)
+        return false;
+
+    // le préfixe est-il une archive ?
+    char *file = strndup(programfile, sep - programfile);
+    if (file == NULL)
+    {
+        perror("archive_read_program.malloc");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t magic;
+    int fd = open(file, O_RDONLY);
+    bool found = fd != -1 && pread(fd, &magic, sizeof(magic), 0) == sizeof(magic)
+        && archive_probe(&magic, sizeof(magic));
+    if (fd != -1)
+        close(fd);
+    if (!found)
+    {
+        free(file);
+        return false;
+    }
+
+    Archive *par = archive_open(file);
+    free(file);
+    int index = archive_find(par, sep + 1);
+    if (index < 0)
+    {
+        fprintf(stderr, "%s: no such member\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+
+    // la projection passe à la machine si elle en utilise le texte
+    const Archive_Entry *pe = &par->_entries[index];
+    if (load_mapped(pmach, (const char *) par->_map + pe->_offset, pe->_size, programfile, map))
+    {
+        pmach->_textmap = par->_map;
+        pmach->_textmaplen = par->_len;
+        par->_map = NULL;
+    }
+    archive_close(par);
+    return true;
+}
+
+//! Arrondi d'une position à un alignement (puissance de 2)
+static uint64_t align_up(uint64_t offset, uint64_t align)
+{
+    return (offset + align - 1) & ~(align - 1);
+}
+
+//! Comparaison de deux entrées de la table de hachage (qsort())
+static int hash_compare(const void *a, const void *b)
+{
+    const Archive_Hash *pa = (const Archive_Hash *) a, *pb = (const Archive_Hash *) b;
+    if (pa->_hash != pb->_hash)
+        return pa->_hash < pb->_hash ? -1 : 1;
+    return pa->_entry < pb->_entry ? -1 : pa->_entry > pb->_entry;
+}
+
+//! Écriture complète à une position donnée
+static void write_at(int fd, const void *buf, size_t n, uint64_t offset, const char *file)
+{
+    for (size_t done = 0; done < n; )
+    {
+        ssize_t w = pwrite(fd, (const char *) buf + done, n - done, offset + done);
+        if (w <= 0)
+        {
+            perror(file);
+            exit(EXIT_FAILURE);
+        }
+        done += w;
+    }
+}
+
+//! Fichier temporaire de l'archive en cours d'écriture (vide sinon)
+static char archive_tmp[PATH_MAX];
+
+//! Suppression du fichier temporaire après une erreur fatale (atexit())
+static void remove_tmp(void)
+{
+    if (archive_tmp[0] != '\0')
+        unlink(archive_tmp);
+}
+
+//! Écriture d'une archive
+void archive_write(const char *file, int nfiles, char *const files[])
+{
+    unsigned count = nfiles;
+
+    // table des noms
+    size_t nameslen = 0;
+    for (unsigned i = 0; i < count; ++i)
+        nameslen += strlen(files[i]) + 1;
+    nameslen = align_up(nameslen, sizeof(uint32_t));
+
+    size_t indexlen = sizeof(Archive_Header)
+        + count * (sizeof(Archive_Entry) + sizeof(Archive_Hash)) + nameslen;
+    char *index = (char *) calloc(1, indexlen);
+    if (index == NULL)
+    {
+        perror("archive_write.calloc");
+        exit(EXIT_FAILURE);
+    }
+    Archive_Header *phdr = (Archive_Header *) index;
+    Archive_Entry *entries = (Archive_Entry *) (phdr + 1);
+    Archive_Hash *hashes = (Archive_Hash *) (entries + count);
+    char *names = (char *) (hashes + count);
+
+    // écriture sous un nom temporaire, renommé une fois l'archive complète :
+    // une erreur laisse intact un fichier existant (qui peut être une entrée)
+    if (snprintf(archive_tmp, sizeof(archive_tmp), "%s.%ld.tmp", file, (long) getpid())
+        >= (int) sizeof(archive_tmp))
+    {
+        fprintf(stderr, "%s: name too long\n", file);
+        exit(EXIT_FAILURE);
+    }
+    int out = open(archive_tmp, O_WRONLY|O_TRUNC|O_CREAT|O_EXCL, S_IRUSR|S_IRGRP|S_IROTH|S_IWUSR);
+    if (out == -1)
+    {
+        perror(archive_tmp);
+        exit(EXIT_FAILURE);
+    }
+    atexit(remove_tmp);
+
+    // membres, recopiés tels quels à leur alignement
+    uint64_t offset = indexlen;
+    size_t nameoff = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        int fd = open(files[i], O_RDONLY);
+        struct stat st;
+        if (fd == -1 || fstat(fd, &st) == -1)
+        {
+            perror(files[i]);
+            exit(EXIT_FAILURE);
+        }
+        size_t len = st.st_size;
+        void *map = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        if (map == MAP_FAILED)
+        {
+            perror("archive_write.mmap");
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+
+        bool image = image_probe(map, len);
+        if (image)
+        {
+            Image img;
+            image_open(&img, map, len, files[i]); // erreur fatale si invalide
+        }
+        else if (len < 3 * sizeof(uint32_t)
+                 || len < (3 + (size_t) ((uint32_t *) map)[0] + ((uint32_t *) map)[1]) * sizeof(uint32_t))
+        {
+            fprintf(stderr, "%s: not a program\n", files[i]);
+            exit(EXIT_FAILURE);
+        }
+
+        offset = align_up(offset, image ? IMAGE_ALIGN : ARCHIVE_ALIGN);
+        write_at(out, map, len, offset, file);
+        if (map != NULL)
+            munmap(map, len);
+
+        entries[i]._offset = offset;
+        entries[i]._size = len;
+        entries[i]._hash = archive_hash(files[i]);
+        entries[i]._name = nameoff;
+        hashes[i]._hash = entries[i]._hash;
+        hashes[i]._entry = i;
+        strcpy(names + nameoff, files[i]);
+        nameoff += strlen(files[i]) + 1;
+        offset += len;
+    }
+
+    // table de hachage triée, sans nom répété
+    qsort(hashes, count, sizeof(Archive_Hash), hash_compare);
+    for (unsigned i = 1; i < count; ++i)
+        for (unsigned j = i; j > 0 && hashes[j - 1]._hash == hashes[i]._hash; --j)
+            if (strcmp(names + entries[hashes[j - 1]._entry]._name,
+                       names + entries[hashes[i]._entry]._name) == 0)
+            {
+                fprintf(stderr, "%s: duplicate member %s\n", file,
+                        names + entries[hashes[i]._entry]._name);
+                exit(EXIT_FAILURE);
+            }
+
+    // index
+    phdr->_magic = ARCHIVE_MAGIC;
+    phdr->_version = ARCHIVE_VERSION;
+    phdr->_count = count;
+    phdr->_nameslen = nameslen;
+    phdr->_indexlen = indexlen;
+    phdr->_checksum = image_checksum((const uint32_t *) (phdr + 1),
+                                     (indexlen - sizeof(Archive_Header)) / sizeof(uint32_t));
+    write_at(out, index, indexlen, 0, file);
+    free(index);
+
+    if (ftruncate(out, offset) == -1 || close(out) == -1 || rename(archive_tmp, file) == -1)
+    {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    archive_tmp[0] = '\0';
+}
@@ -0,0 +1,191 @@
+#ifndef _ARCHIVE_H_
+#define _ARCHIVE_H_
+
+/*!
+ * \file archive.h
+ * \brief Archives de programmes à accès direct.
+ *
+ * Une archive range de nombreux programmes binaires (chacun dans l'ancien
+ * format ou au format image, voir read_program() et image.h) dans un seul
+ * fichier, projeté une fois pour toutes en mémoire : charger l'un d'eux ne
+ * coûte plus ni ouverture ni lecture de fichier.
+ *
+ * L'archive commence par un index :
+ *
+ *   - un en-tête (Archive_Header) ;
+ *
+ *   - la table des membres (Archive_Entry), dans l'ordre de l'empaquetage :
+ *   le numéro d'un membre est sa position dans cette table ;
+ *
+ *   - la table de hachage (Archive_Hash) : les empreintes des noms
+ *   (archive_hash()), triées, avec le numéro du membre correspondant ;
+ *
+ *   - les noms des membres (chaînes terminées par un octet nul), complétés
+ *   par des zéros jusqu'à un multiple de 4 octets.
+ *
+ * Les membres suivent, chacun recopié tel quel à une position multiple de \c
+ * IMAGE_ALIGN pour une image (ses sections restent alignées sur les pages)
+ * et de \c ARCHIVE_ALIGN sinon. Le texte d'un membre est donc utilisable
+ * dans la projection sans copie (archive_load()), comme avec map_program().
+ *
+ * L'index est écrit dans l'ordre des octets de l'hôte et protégé par une
+ * somme de contrôle (image_checksum()) ; les membres au format image gardent
+ * leurs propres sommes. Une archive d'ordre étranger est refusée.
+ *
+ * read_program() et map_program() acceptent un membre d'archive sous la
+ * forme \c archive:membre, où \c membre est le nom du membre ou \c #numéro.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+//! Nombre magique ("SARC" lu en petit-boutiste)
+#define ARCHIVE_MAGIC 0x43524153u
+
+//! Version courante du format
+#define ARCHIVE_VERSION 1
+
+//! Alignement des membres dans l'ancien format (en octets, une ligne de cache)
+#define ARCHIVE_ALIGN 64
+
+//! Séparateur entre le nom de l'archive et celui du membre
+#define ARCHIVE_SEP ':'
+
+//! En-tête d'une archive (32 octets)
+typedef struct
+{
+    uint32_t _magic;		//!< \c ARCHIVE_MAGIC
+    uint16_t _version;		//!< Version du format
+    uint16_t _reserved;		//!< Inutilisé (0)
+    uint32_t _count;		//!< Nombre de membres
+    uint32_t _nameslen;		//!< Taille de la table des noms (octets, multiple de 4)
+    uint64_t _indexlen;		//!< Taille de l'index, en-tête compris (octets)
+    uint64_t _checksum;		//!< Somme de contrôle de l'index (en-tête exclu)
+} Archive_Header;
+
+//! Entrée de la table des membres (32 octets)
+typedef struct
+{
+    uint64_t _offset;		//!< Position du membre dans l'archive
+    uint64_t _size;		//!< Taille du membre (octets)
+    uint64_t _hash;		//!< Empreinte du nom
+    uint32_t _name;		//!< Position du nom dans la table des noms
+    uint32_t _reserved;		//!< Inutilisé (0)
+} Archive_Entry;
+
+//! Entrée de la table de hachage (16 octets)
+typedef struct
+{
+    uint64_t _hash;		//!< Empreinte du nom
+    uint32_t _entry;		//!< Numéro du membre
+    uint32_t _reserved;		//!< Inutilisé (0)
+} Archive_Hash;
+
+//! Archive ouverte (projetée en mémoire)
+typedef struct Archive
+{
+    void *_map;			//!< Projection du fichier
+    size_t _len;		//!< Sa taille
+    unsigned _count;		//!< Nombre de membres
+    const Archive_Entry *_entries;	//!< Table des membres (dans la projection)
+    const Archive_Hash *_hashes;	//!< Table de hachage (idem)
+    const char *_names;		//!< Table des noms (idem)
+    char *_file;		//!< Nom du fichier (messages d'erreur)
+} Archive;
+
+//! Empreinte d'un nom de membre (FNV-1a, 64 bits)
+/*!
+ * \param name le nom
+ * \return l'empreinte
+ */
+uint64_t archive_hash(const char *name);
+
+//! Reconnaissance d'une archive
+/*!
+ * \param start le début du fichier
+ * \param len sa taille
+ * \return vrai si le fichier commence par le nombre magique
+ */
+bool archive_probe(const void *start, size_t len);
+
+//! Ouverture d'une archive
+/*!
+ * Le fichier est projeté en mémoire (ses pages ne sont lues qu'à la
+ * demande) ; l'index est vérifié, toute incohérence est une erreur fatale.
+ *
+ * \param file le nom du fichier
+ * \return l'archive (à fermer par archive_close())
+ */
+Archive *archive_open(const char *file);
+
+//! Fermeture d'une archive
+/*!
+ * Les machines chargées depuis l'archive par archive_load() doivent avoir
+ * été libérées (machine_free()).
+ *
+ * \param par l'archive
+ */
+void archive_close(Archive *par);
+
+//! Nom d'un membre
+/*!
+ * \param par l'archive
+ * \param index le numéro du membre
+ * \return son nom (dans la projection)
+ */
+const char *archive_name(const Archive *par, unsigned index);
+
+//! Recherche d'un membre
+/*!
+ * \param par l'archive
+ * \param name le nom du membre, ou \c #numéro
+ * \return le numéro du membre, -1 s'il n'existe pas
+ */
+int archive_find(const Archive *par, const char *name);
+
+//! Chargement d'une machine depuis un membre d'une archive
+/*!
+ * La machine est initialisée comme par map_program() : son texte est
+ * utilisé dans la projection de l'archive quand c'est possible, son segment
+ * de données est copié. Elle doit être neuve ou avoir été libérée par
+ * machine_free() ; l'archive doit rester ouverte tant qu'elle est chargée.
+ *
+ * \param pmach la machine
+ * \param par l'archive
+ * \param index le numéro du membre
+ */
+void archive_load(Machine *pmach, const Archive *par, unsigned index);
+
+//! Chargement d'un programme désigné par "archive:membre"
+/*!
+ * Appelé par read_program() et map_program() quand le nom ne désigne aucun
+ * fichier. Le membre est chargé avec copie du texte (\c map faux) ou avec
+ * son texte dans une projection de l'archive que la machine garde (\c
+ * _textmap) et qui est supprimée par machine_free().
+ *
+ * \param pmach la machine
+ * \param programfile le nom du programme
+ * \param map utiliser le texte sans copie si possible ?
+ * \return faux si le nom ne désigne pas un membre d'archive (rien n'est
+ * fait) ; un membre absent est une erreur fatale
+ */
+bool archive_read_program(Machine *pmach, const char *programfile, bool map);
+
+//! Écriture d'une archive
+/*!
+ * Chaque fichier est recopié tel quel (il doit être dans l'un des formats
+ * acceptés par read_program()) ; son nom de membre est le nom donné. Les
+ * erreurs sont fatales ; un nom répété est refusé. L'archive est écrite sous
+ * un nom temporaire puis renommée : après une erreur, un fichier existant du
+ * même nom (éventuellement l'un des programmes) est intact.
+ *
+ * \param file le nom de l'archive
+ * \param nfiles le nombre de programmes
+ * \param files leurs noms
+ */
+void archive_write(const char *file, int nfiles, char *const files[]);
+
+#endif
@@ -0,0 +1,115 @@
+/*!
+ * \file arena.c
+ * \brief Réserve de blocs mémoire (par thread) pour les segments des machines.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "arena.h"
+
+//! En-tête d'un bloc (16 octets : le bloc garde l'alignement de malloc)
+typedef struct
+{
+    size_t _cap;		//!< Capacité du bloc (octets)
+    size_t _pad;		//!< Inutilisé
+} Block_Header;
+
+//! Réserve d'un thread
+typedef struct
+{
+    void *_blocks[ARENA_NBLOCKS]; //!< Blocs disponibles
+    unsigned _nblocks;		//!< Leur nombre
+    Arena_Stats _stats;		//!< Compteurs
+} Arena;
+
+//! Réserve du thread courant
+static __thread Arena arena;
+
+//! Capacité d'un bloc
+static inline size_t capacity(void *block)
+{
+    return ((Block_Header *) block - 1)->_cap;
+}
+
+//! Rendu d'un bloc au système
+static void release_block(Arena *pa, void *block)
+{
+    free((Block_Header *) block - 1);
+    pa->_stats._frees++;
+}
+
+//! Allocation d'un bloc
+void *arena_alloc(size_t size)
+{
+    Arena *pa = &arena;
+
+    // le plus petit bloc disponible qui convient
+    int best = -1;
+    for (unsigned i = 0; i < pa->_nblocks; ++i)
+        if (capacity(pa->_blocks[i]) >= size
+            && (best < 0 || capacity(pa->_blocks[i]) < capacity(pa->_blocks[best])))
+            best = i;
+    if (best >= 0)
+    {
+        void *block = pa->_blocks[best];
+        pa->_blocks[best] = pa->_blocks[--pa->_nblocks];
+        pa->_stats._reuses++;
+        return block;
+    }
+
+    size_t cap = ARENA_MINBLOCK;
+    while (cap < size)
+        cap <<= 1;
+    Block_Header *phdr = (Block_Header *) malloc(sizeof(Block_Header) + cap);
+    if (phdr == NULL)
+    {
+        perror("arena_alloc.malloc");
+        exit(EXIT_FAILURE);
+    }
+    phdr->_cap = cap;
+    pa->_stats._mallocs++;
+    return phdr + 1;
+}
+
+//! Restitution d'un bloc à la réserve du thread courant
+void arena_release(void *block)
+{
+    Arena *pa = &arena;
+
+    if (block == NULL)
+        return;
+    if (pa->_nblocks < ARENA_NBLOCKS)
+    {
+        pa->_blocks[pa->_nblocks++] = block;
+        return;
+    }
+
+    // réserve pleine : on garde les plus grands blocs
+    unsigned smallest = 0;
+    for (unsigned i = 1; i < pa->_nblocks; ++i)
+        if (capacity(pa->_blocks[i]) < capacity(pa->_blocks[smallest]))
+            smallest = i;
+    if (capacity(pa->_blocks[smallest]) < capacity(block))
+    {
+        release_block(pa, pa->_blocks[smallest]);
+        pa->_blocks[smallest] = block;
+    }
+    else
+        release_block(pa, block);
+}
+
+//! Libération de tous les blocs de la réserve du thread courant
+void arena_trim(void)
+{
+    Arena *pa = &arena;
+
+    while (pa->_nblocks > 0)
+        release_block(pa, pa->_blocks[--pa->_nblocks]);
+}
+
+//! Compteurs de la réserve du thread courant
+Arena_Stats arena_stats(void)
+{
+    return arena._stats;
+}
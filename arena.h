@@ -0,0 +1,66 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+/*!
+ * \file arena.h
+ * \brief Réserve de blocs mémoire (par thread) pour les segments des machines.
+ *
+ * Les segments de texte et de données sont alloués par arena_alloc() et
+ * rendus par machine_free(). Chaque thread garde jusqu'à \c ARENA_NBLOCKS
+ * blocs rendus ; une allocation réutilise le plus petit bloc assez grand et
+ * ne fait appel à \c malloc qu'à défaut. Les tailles sont arrondies à la
+ * puissance de 2 supérieure pour que des programmes de tailles voisines
+ * puissent échanger leurs blocs : en régime permanent (programmes chargés
+ * puis libérés à tour de rôle sur un même thread), il n'y a plus aucune
+ * allocation dans le tas.
+ *
+ * Un bloc peut être rendu par un autre thread que celui qui l'a obtenu ; il
+ * rejoint alors la réserve de ce thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+//! Nombre maximal de blocs gardés par thread
+#define ARENA_NBLOCKS 8
+
+//! Taille minimale d'un bloc (octets)
+#define ARENA_MINBLOCK 256
+
+//! Compteurs de la réserve d'un thread
+typedef struct
+{
+    uint64_t _mallocs;		//!< Blocs obtenus par malloc
+    uint64_t _reuses;		//!< Blocs réutilisés depuis la réserve
+    uint64_t _frees;		//!< Blocs rendus au système
+} Arena_Stats;
+
+//! Allocation d'un bloc
+/*!
+ * Le contenu du bloc est quelconque (il peut provenir d'un programme
+ * précédent). Erreur fatale si la mémoire manque.
+ *
+ * \param size la taille demandée (octets)
+ * \return le bloc
+ */
+void *arena_alloc(size_t size);
+
+//! Restitution d'un bloc à la réserve du thread courant
+/*!
+ * Si la réserve est pleine, le plus petit des blocs est rendu au système.
+ *
+ * \param block le bloc (obtenu par arena_alloc()) ou NULL
+ */
+void arena_release(void *block);
+
+//! Libération de tous les blocs de la réserve du thread courant
+/*!
+ * À appeler avant la fin d'un thread qui a chargé des programmes (les blocs
+ * gardés seraient sinon perdus).
+ */
+void arena_trim(void);
+
+//! Compteurs de la réserve du thread courant
+Arena_Stats arena_stats(void);
+
+#endif
@@ -0,0 +1,243 @@
+/*!
+ * \file bpred.c
+ * \brief Modèles de prédiction de branchement.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bpred.h"
+#include "model.h"
+
+//! Nombre de branchements affichés dans le classement des mauvaises prédictions
+#define BPRED_TOPPC 10
+
+//! Nombre maximal de bits d'index
+#define BPRED_MAXBITS 24
+
+//! Profondeur maximale de la pile d'adresses de retour
+#define BPRED_MAXRAS 1024
+
+//! Analyse d'une description de prédicteur
+/*!
+ * \param spec la description (<tt>static|bimodal|gshare[:bits[:ras]]</tt>)
+ * \param pcfg les paramètres résultants
+ * \return faux si la description est invalide
+ */
+bool bpred_parse(const char *spec, Bpred_Config *pcfg)
+{
+    static const char *names[] = { "static", "bimodal", "gshare" };
+    size_t len = strcspn(spec, ":");
+    unsigned k;
+
+    for (k = 0; k <= BP_GSHARE; ++k)
+        if (strlen(names[k]) == len && strncmp(spec, names[k], len) == 0)
+            break;
+    if (k > BP_GSHARE)
+        return false;
+
+    pcfg->_kind = (Bpred_Kind) k;
+    pcfg->_bits = BPRED_DEFBITS;
+    pcfg->_rasdepth = BPRED_DEFRAS;
+
+    const char *p = spec + len;
+    int n = 0;
+    if (*p == ':' && (sscanf(p + 1, "%u%n", &pcfg->_bits, &n) < 1 || n == 0))
+        return false;
+    p += *p == ':' ? n + 1 : 0;
+    if (*p == ':' && (sscanf(p + 1, "%u%n", &pcfg->_rasdepth, &n) < 1 || n == 0))
+        return false;
+    p += *p == ':' ? n + 1 : 0;
+
+    return *p == '\0' && pcfg->_bits >= 1 && pcfg->_bits <= BPRED_MAXBITS
+        && pcfg->_rasdepth >= 1 && pcfg->_rasdepth <= BPRED_MAXRAS;
+}
+
+//! Création d'un prédicteur
+/*!
+ * Les compteurs partent de l'état « faiblement pris ».
+ *
+ * \param pcfg les paramètres
+ * \param textsize la taille du texte du programme observé
+ * \return le prédicteur
+ */
+Bpred *bpred_new(const Bpred_Config *pcfg, unsigned textsize)
+{
+    Bpred *pbp = (Bpred *) xcalloc(1, sizeof(Bpred));
+    size_t entries = (size_t) 1 << pcfg->_bits;
+
+    pbp->_cfg = *pcfg;
+    pbp->_mask = entries - 1;
+    pbp->_counters = (uint8_t *) xcalloc(entries, sizeof(uint8_t));
+    memset(pbp->_counters, 2, entries);
+    pbp->_targets = (unsigned *) xcalloc(entries, sizeof(unsigned));
+    pbp->_ras = (unsigned *) xcalloc(pcfg->_rasdepth, sizeof(unsigned));
+    pbp->_textsize = textsize;
+    pbp->_pc_stats = (Bpred_Stats *) xcalloc(textsize + 1, sizeof(Bpred_Stats));
+    return pbp;
+}
+
+//! Destruction d'un prédicteur
+void bpred_free(Bpred *pbp)
+{
+    free(pbp->_counters);
+    free(pbp->_targets);
+    free(pbp->_ras);
+    free(pbp->_pc_stats);
+    free(pbp);
+}
+
+//! Prédiction et apprentissage de la direction d'un branchement conditionnel absolu
+/*!
+ * \param pbp le prédicteur
+ * \param addr l'adresse du branchement
+ * \param target sa cible
+ * \param taken la direction effective
+ * \return la direction prédite
+ */
+static bool predict_direction(Bpred *pbp, unsigned addr, unsigned target, bool taken)
+{
+    if (pbp->_cfg._kind == BP_STATIC)
+        return target <= addr; // boucles : les branchements arrière sont pris
+
+    unsigned index = addr;
+    if (pbp->_cfg._kind == BP_GSHARE)
+    {
+        index ^= pbp->_history;
+        pbp->_history = ((pbp->_history << 1) | taken) & pbp->_mask;
+    }
+    uint8_t *pc = &pbp->_counters[index & pbp->_mask];
+    bool predicted = *pc >= 2;
+    if (taken && *pc < 3)
+        (*pc)++;
+    else if (!taken && *pc > 0)
+        (*pc)--;
+    return predicted;
+}
+
+//! Prise en compte d'une instruction exécutée
+/*!
+ * \param pbp le prédicteur
+ * \param addr l'adresse de l'instruction
+ * \param instr l'instruction
+ * \param taken le branchement a-t-il été pris ?
+ * \param next l'adresse de l'instruction suivante effective
+ * \return vrai si la prédiction était fausse
+ */
+bool bpred_update(Bpred *pbp, unsigned addr, Instruction instr, bool taken, unsigned next)
+{
+    unsigned cop = instr.instr_generic._cop;
+    unsigned predicted;
+    Bpred_Class cls;
+
+    if (cop == RET)
+    {
+        cls = BC_RETURN;
+        predicted = addr + 1; // pile vide : pas de prédiction utile
+        if (pbp->_rascount > 0)
+        {
+            pbp->_rascount--;
+            pbp->_rastop--;
+            predicted = pbp->_ras[pbp->_rastop % pbp->_cfg._rasdepth];
+        }
+    }
+    else if (cop == BRANCH || cop == CALL)
+    {
+        bool conditional = instr.instr_generic._regcond != NC;
+        if (instr.instr_generic._indexed)
+        {
+            // cible : la dernière observée pour ce branchement
+            cls = BC_INDIRECT;
+            unsigned *pt = &pbp->_targets[addr & pbp->_mask];
+            predicted = *pt != 0 ? *pt - 1 : addr + 1;
+            if (taken)
+                *pt = next + 1;
+        }
+        else
+        {
+            unsigned target = instr.instr_absolute._address;
+            cls = conditional ? BC_CONDITIONAL : BC_DIRECT;
+            bool ptaken = !conditional || predict_direction(pbp, addr, target, taken);
+            predicted = ptaken ? target : addr + 1;
+        }
+        if (cop == CALL && taken)
+        {
+            pbp->_ras[pbp->_rastop % pbp->_cfg._rasdepth] = addr + 1;
+            pbp->_rastop++;
+            if (pbp->_rascount < pbp->_cfg._rasdepth)
+                pbp->_rascount++;
+        }
+    }
+    else
+        return false;
+
+    bool miss = predicted != next;
+    Bpred_Stats *ps = &pbp->_pc_stats[addr < pbp->_textsize ? addr : pbp->_textsize];
+    ps->_count++;
+    ps->_mispredicted += miss;
+    pbp->_class_stats[cls]._count++;
+    pbp->_class_stats[cls]._mispredicted += miss;
+    return miss;
+}
+
+//! Affichage d'une ligne de statistiques
+static void print_stats(FILE *out, const char *name, const Bpred_Stats *pstats)
+{
+    fprintf(out, "%-14s executed %10llu  mispredicted %10llu  accuracy %6.2f%%\n", name,
+            (unsigned long long) pstats->_count, (unsigned long long) pstats->_mispredicted,
+            pstats->_count > 0 ? 100.0 * (pstats->_count - pstats->_mispredicted) / pstats->_count : 100.0);
+}
+
+//! Clé de classement d'un branchement : ses mauvaises prédictions (s'il a été exécuté)
+static bool pc_mispredicted(const void *ctx, unsigned pc, uint64_t *pkey)
+{
+    const Bpred_Stats *ps = &((const Bpred *) ctx)->_pc_stats[pc];
+    *pkey = ps->_mispredicted;
+    return ps->_count > 0;
+}
+
+//! Affichage des statistiques
+/*!
+ * \param out le flot de sortie
+ * \param pbp le prédicteur
+ * \param text le texte du programme
+ * \param icount le nombre d'instructions exécutées
+ */
+void bpred_report(FILE *out, const Bpred *pbp, const Instruction *text, uint64_t icount)
+{
+    static const char *kind_names[] = { "static (BTFN)", "bimodal", "gshare" };
+    static const char *class_names[] = { "direct", "conditional", "indirect", "return" };
+    Bpred_Stats total = { 0, 0 };
+    char name[32];
+
+    for (unsigned c = 0; c < BPRED_NCLASSES; ++c)
+    {
+        total._count += pbp->_class_stats[c]._count;
+        total._mispredicted += pbp->_class_stats[c]._mispredicted;
+    }
+
+    fprintf(out, "\n*** BRANCH PREDICTION ***\n");
+    fprintf(out, "Predictor: %s, %u-entry tables, %u-entry return stack\n",
+            kind_names[pbp->_cfg._kind], pbp->_mask + 1, pbp->_cfg._rasdepth);
+    print_stats(out, "all", &total);
+    for (unsigned c = 0; c < BPRED_NCLASSES; ++c)
+        print_stats(out, class_names[c], &pbp->_class_stats[c]);
+    fprintf(out, "MPKI: %.3f (%llu instructions)\n",
+            icount > 0 ? 1000.0 * total._mispredicted / icount : 0.0, (unsigned long long) icount);
+
+    // classement des branchements par nombre de mauvaises prédictions
+    fprintf(out, "\nMispredictions by instruction (top %d):\n", BPRED_TOPPC);
+    unsigned top[BPRED_TOPPC];
+    unsigned ntop = model_top(pbp->_textsize, pc_mispredicted, pbp, top, BPRED_TOPPC);
+    for (unsigned rank = 0; rank < ntop; ++rank)
+    {
+        unsigned pc = top[rank];
+        char buf[DISASM_MAXLEN + 1];
+        buf[format_instruction(buf, text[pc], pc)] = '\0';
+        sprintf(name, "0x%04x", pc);
+        fprintf(out, "%-24s ", buf);
+        print_stats(out, name, &pbp->_pc_stats[pc]);
+    }
+    putc('\n', out);
+}
@@ -0,0 +1,126 @@
+#ifndef _BPRED_H_
+#define _BPRED_H_
+
+/*!
+ * \file bpred.h
+ * \brief Modèles de prédiction de branchement.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "instruction.h"
+
+//! Prédicteurs de direction disponibles
+typedef enum
+{
+    BP_STATIC,			//!< Statique : arrière pris, avant non pris
+    BP_BIMODAL,			//!< Compteurs à saturation de 2 bits indexés par l'adresse
+    BP_GSHARE,			//!< Compteurs indexés par l'adresse xor l'historique global
+} Bpred_Kind;
+
+//! Paramètres d'un prédicteur
+typedef struct
+{
+    Bpred_Kind _kind;		//!< Prédicteur de direction
+    unsigned _bits;		//!< Log2 du nombre d'entrées des tables (compteurs, cibles)
+    unsigned _rasdepth;		//!< Profondeur de la pile d'adresses de retour
+} Bpred_Config;
+
+//! Nombre de bits d'index par défaut
+#define BPRED_DEFBITS 12
+
+//! Profondeur par défaut de la pile d'adresses de retour
+#define BPRED_DEFRAS 16
+
+//! Compteurs d'un branchement ou d'une classe de branchements
+typedef struct
+{
+    uint64_t _count;		//!< Exécutions
+    uint64_t _mispredicted;	//!< Mauvaises prédictions
+} Bpred_Stats;
+
+//! Classes de transferts de contrôle
+typedef enum
+{
+    BC_DIRECT = 0,		//!< BRANCH/CALL absolu inconditionnel
+    BC_CONDITIONAL,		//!< BRANCH/CALL absolu conditionnel (direction prédite)
+    BC_INDIRECT,		//!< BRANCH/CALL indexé (cible prédite par la table des cibles)
+    BC_RETURN,			//!< RET (cible prédite par la pile d'adresses de retour)
+} Bpred_Class;
+
+//! Nombre de classes de transferts de contrôle
+#define BPRED_NCLASSES (BC_RETURN + 1)
+
+//! État d'un prédicteur de branchement
+/*!
+ * Une prédiction porte sur l'adresse de l'instruction suivante : elle est
+ * fausse si la direction \e ou la cible prédite est fausse.
+ */
+typedef struct Bpred
+{
+    Bpred_Config _cfg;		//!< Paramètres
+    unsigned _mask;		//!< Masque d'index des tables
+    uint8_t *_counters;		//!< Compteurs à saturation (BP_BIMODAL, BP_GSHARE)
+    unsigned _history;		//!< Historique global des directions (BP_GSHARE)
+    unsigned *_targets;		//!< Dernières cibles des branchements indexés (+1, 0 = inconnue)
+    unsigned *_ras;		//!< Pile circulaire d'adresses de retour
+    unsigned _rastop;		//!< Nombre d'empilements (modulo la profondeur : sommet)
+    unsigned _rascount;		//!< Nombre d'adresses valides dans la pile
+    unsigned _textsize;		//!< Taille du texte (statistiques par instruction)
+    Bpred_Stats *_pc_stats;	//!< Statistiques par adresse d'instruction
+    Bpred_Stats _class_stats[BPRED_NCLASSES]; //!< Statistiques par classe
+} Bpred;
+
+//! Analyse d'une description de prédicteur
+/*!
+ * La description a la forme <tt>static|bimodal|gshare[:bits[:ras]]</tt> où
+ * \c bits est le log2 de la taille des tables et \c ras la profondeur de la
+ * pile d'adresses de retour (par exemple <tt>gshare:14:32</tt>).
+ *
+ * \param spec la description
+ * \param pcfg les paramètres résultants
+ * \return faux si la description est invalide
+ */
+bool bpred_parse(const char *spec, Bpred_Config *pcfg);
+
+//! Création d'un prédicteur
+/*!
+ * \param pcfg les paramètres
+ * \param textsize la taille du texte du programme observé
+ * \return le prédicteur
+ */
+Bpred *bpred_new(const Bpred_Config *pcfg, unsigned textsize);
+
+//! Destruction d'un prédicteur
+void bpred_free(Bpred *pbp);
+
+//! Prise en compte d'une instruction exécutée
+/*!
+ * Sans effet si l'instruction n'est pas un transfert de contrôle. Sinon la
+ * prédiction est comparée au résultat, puis les tables sont mises à jour.
+ *
+ * \param pbp le prédicteur
+ * \param addr l'adresse de l'instruction
+ * \param instr l'instruction
+ * \param taken le branchement a-t-il été pris (voir transfer_taken()) ?
+ * \param next l'adresse de l'instruction suivante effective
+ * \return vrai si la prédiction était fausse
+ */
+bool bpred_update(Bpred *pbp, unsigned addr, Instruction instr, bool taken, unsigned next);
+
+//! Affichage des statistiques
+/*!
+ * Précision globale, par classe et pour les branchements les plus souvent
+ * mal prédits (avec leur désassemblage), et nombre de mauvaises prédictions
+ * pour mille instructions (MPKI).
+ *
+ * \param out le flot de sortie
+ * \param pbp le prédicteur
+ * \param text le texte du programme
+ * \param icount le nombre d'instructions exécutées
+ */
+void bpred_report(FILE *out, const Bpred *pbp, const Instruction *text, uint64_t icount);
+
+#endif
@@ -0,0 +1,314 @@
+/*!
+ * \file cache.c
+ * \brief Modèle de hiérarchie de caches de données.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cache.h"
+#include "model.h"
+
+//! Nombre d'instructions affichées dans le classement des échecs
+#define CACHE_TOPPC 10
+
+//! Log2 d'une puissance de 2 (-1 si ce n'en est pas une)
+static int log2_exact(unsigned n)
+{
+    int l = 0;
+    if (n == 0 || (n & (n - 1)) != 0)
+        return -1;
+    while ((1u << l) != n)
+        l++;
+    return l;
+}
+
+//! Analyse d'une description de hiérarchie de caches
+/*!
+ * \param spec la description (<tt>taille:assoc:ligne[:lru|plru][,...]</tt>)
+ * \param cfg les paramètres de chaque niveau
+ * \return le nombre de niveaux, ou 0 si la description est invalide
+ */
+unsigned cache_parse(const char *spec, Cache_Config cfg[CACHE_MAXLEVELS])
+{
+    unsigned nlevels = 0;
+    const char *p = spec;
+
+    while (*p != '\0')
+    {
+        char policy[8] = "lru";
+        int len = 0;
+        if (nlevels == CACHE_MAXLEVELS
+            || sscanf(p, "%u:%u:%u%n", &cfg[nlevels]._size, &cfg[nlevels]._assoc, &cfg[nlevels]._line, &len) < 3)
+            return 0;
+        p += len;
+        if (*p == ':')
+        {
+            if (sscanf(p + 1, "%7[a-z]%n", policy, &len) < 1)
+                return 0;
+            p += 1 + len;
+        }
+        if (strcmp(policy, "lru") == 0)
+            cfg[nlevels]._repl = REPL_LRU;
+        else if (strcmp(policy, "plru") == 0)
+            cfg[nlevels]._repl = REPL_PLRU;
+        else
+            return 0;
+
+        Cache_Config *pc = &cfg[nlevels];
+        if (log2_exact(pc->_size) < 0 || log2_exact(pc->_assoc) < 0 || log2_exact(pc->_line) < 0
+            || pc->_assoc > CACHE_MAXASSOC || pc->_assoc * pc->_line > pc->_size)
+            return 0;
+        nlevels++;
+
+        if (*p == ',')
+            p++;
+        else if (*p != '\0')
+            return 0;
+    }
+    return nlevels;
+}
+
+//! Création d'une hiérarchie de caches
+/*!
+ * \param cfg les paramètres de chaque niveau
+ * \param nlevels le nombre de niveaux
+ * \param textsize la taille du texte du programme observé
+ * \param dataend la fin de ses données statiques
+ * \return la hiérarchie (vide)
+ */
+Cache *cache_new(const Cache_Config cfg[], unsigned nlevels, unsigned textsize, unsigned dataend)
+{
+    Cache *pcache = (Cache *) xcalloc(1, sizeof(Cache));
+
+    pcache->_nlevels = nlevels;
+    pcache->_dataend = dataend;
+    pcache->_textsize = textsize;
+    pcache->_pc_stats = (Cache_Stats *) xcalloc(textsize + 1, sizeof(Cache_Stats));
+    for (unsigned l = 0; l < nlevels; ++l)
+    {
+        Cache_Level *plevel = &pcache->_levels[l];
+        unsigned nlines = cfg[l]._size / cfg[l]._line;
+        plevel->_cfg = cfg[l];
+        plevel->_nsets = nlines / cfg[l]._assoc;
+        plevel->_lineshift = log2_exact(cfg[l]._line);
+        plevel->_tags = (uint32_t *) xcalloc(nlines, sizeof(uint32_t));
+        plevel->_dirty = (bool *) xcalloc(nlines, sizeof(bool));
+        plevel->_stamps = (uint64_t *) xcalloc(nlines, sizeof(uint64_t));
+        plevel->_plru = (uint64_t *) xcalloc(plevel->_nsets, sizeof(uint64_t));
+    }
+    return pcache;
+}
+
+//! Destruction d'une hiérarchie de caches
+void cache_free(Cache *pcache)
+{
+    for (unsigned l = 0; l < pcache->_nlevels; ++l)
+    {
+        free(pcache->_levels[l]._tags);
+        free(pcache->_levels[l]._dirty);
+        free(pcache->_levels[l]._stamps);
+        free(pcache->_levels[l]._plru);
+    }
+    free(pcache->_pc_stats);
+    free(pcache);
+}
+
+//! Mise à jour de l'arbre pseudo-LRU après un accès à une voie
+/*!
+ * Chaque nœud (numérotés à partir de 1 comme dans un tas) désigne le côté
+ * à évincer ; on le fait pointer à l'opposé de la voie accédée.
+ */
+static void plru_touch(uint64_t *pbits, unsigned assoc, unsigned way)
+{
+    unsigned node = 1;
+    for (unsigned half = assoc >> 1; half > 0; half >>= 1)
+    {
+        unsigned right = (way & half) != 0;
+        if (right)
+            *pbits &= ~(1ull << node);
+        else
+            *pbits |= 1ull << node;
+        node = 2 * node + right;
+    }
+}
+
+//! Choix de la victime selon l'arbre pseudo-LRU
+static unsigned plru_victim(uint64_t bits, unsigned assoc)
+{
+    unsigned node = 1, way = 0;
+    for (unsigned half = assoc >> 1; half > 0; half >>= 1)
+    {
+        unsigned right = (bits >> node) & 1;
+        way |= right ? half : 0;
+        node = 2 * node + right;
+    }
+    return way;
+}
+
+//! Accès à une ligne d'un niveau (et aux niveaux suivants en cas d'échec)
+/*!
+ * \param pcache la hiérarchie
+ * \param l le niveau
+ * \param addr l'adresse du mot
+ * \param write écriture ?
+ * \return le nombre de niveaux manqués à partir de celui-ci (0 : succès)
+ */
+static unsigned level_access(Cache *pcache, unsigned l, unsigned addr, bool write)
+{
+    Cache_Level *plevel = &pcache->_levels[l];
+    unsigned assoc = plevel->_cfg._assoc;
+    uint32_t line = addr >> plevel->_lineshift;
+    unsigned set = line & (plevel->_nsets - 1);
+    uint32_t *tags = plevel->_tags + set * assoc;
+    unsigned way;
+
+    if (write)
+        plevel->_stats._writes++;
+    else
+        plevel->_stats._reads++;
+
+    for (way = 0; way < assoc; ++way)
+        if (tags[way] == line + 1)
+            break;
+
+    unsigned missed = 0;
+    if (way == assoc)
+    {
+        if (write)
+            plevel->_stats._write_misses++;
+        else
+            plevel->_stats._read_misses++;
+
+        // choix de la victime : une voie libre sinon selon la politique
+        for (way = 0; way < assoc && tags[way] != 0; ++way)
+            ;
+        if (way == assoc)
+        {
+            if (plevel->_cfg._repl == REPL_PLRU)
+                way = plru_victim(plevel->_plru[set], assoc);
+            else
+            {
+                way = 0;
+                for (unsigned w = 1; w < assoc; ++w)
+                    if (plevel->_stamps[set * assoc + w] < plevel->_stamps[set * assoc + way])
+                        way = w;
+            }
+        }
+
+        // écriture différée de la victime, puis chargement de la ligne
+        if (tags[way] != 0 && plevel->_dirty[set * assoc + way])
+        {
+            plevel->_writebacks++;
+            if (l + 1 < pcache->_nlevels)
+                level_access(pcache, l + 1, (tags[way] - 1) << plevel->_lineshift, true);
+        }
+        missed = 1;
+        if (l + 1 < pcache->_nlevels)
+            missed += level_access(pcache, l + 1, addr, false);
+        tags[way] = line + 1;
+        plevel->_dirty[set * assoc + way] = false;
+    }
+
+    if (write)
+        plevel->_dirty[set * assoc + way] = true;
+    plevel->_stamps[set * assoc + way] = ++plevel->_clock;
+    if (plevel->_cfg._repl == REPL_PLRU)
+        plru_touch(&plevel->_plru[set], assoc, way);
+    return missed;
+}
+
+//! Mise à jour d'un compteur de statistiques
+static inline void count(Cache_Stats *pstats, bool write, bool hit)
+{
+    if (write)
+    {
+        pstats->_writes++;
+        pstats->_write_misses += !hit;
+    }
+    else
+    {
+        pstats->_reads++;
+        pstats->_read_misses += !hit;
+    }
+}
+
+//! Accès à un mot de données
+/*!
+ * \param pcache la hiérarchie
+ * \param pc l'adresse de l'instruction qui fait l'accès
+ * \param addr l'adresse de la donnée
+ * \param write écriture ?
+ * \return le nombre de niveaux manqués
+ */
+unsigned cache_access(Cache *pcache, unsigned pc, unsigned addr, bool write)
+{
+    unsigned missed = level_access(pcache, 0, addr, write);
+
+    count(&pcache->_pc_stats[pc < pcache->_textsize ? pc : pcache->_textsize], write, missed == 0);
+    count(&pcache->_region_stats[addr < pcache->_dataend ? REGION_STATIC : REGION_STACK], write, missed == 0);
+    return missed;
+}
+
+//! Affichage d'une ligne de statistiques
+static void print_stats(FILE *out, const char *name, const Cache_Stats *pstats)
+{
+    uint64_t accesses = pstats->_reads + pstats->_writes;
+    uint64_t misses = pstats->_read_misses + pstats->_write_misses;
+
+    fprintf(out, "%-12s accesses %10llu  misses %10llu (R %llu, W %llu)  hit rate %6.2f%%\n", name,
+            (unsigned long long) accesses, (unsigned long long) misses,
+            (unsigned long long) pstats->_read_misses, (unsigned long long) pstats->_write_misses,
+            accesses > 0 ? 100.0 * (accesses - misses) / accesses : 0.0);
+}
+
+//! Clé de classement d'une instruction : ses échecs (si elle a accédé aux données)
+static bool pc_misses(const void *ctx, unsigned pc, uint64_t *pkey)
+{
+    const Cache_Stats *ps = &((const Cache *) ctx)->_pc_stats[pc];
+    *pkey = ps->_read_misses + ps->_write_misses;
+    return ps->_reads + ps->_writes > 0;
+}
+
+//! Affichage des statistiques
+/*!
+ * \param out le flot de sortie
+ * \param pcache la hiérarchie
+ * \param text le texte du programme (pour le désassemblage)
+ */
+void cache_report(FILE *out, const Cache *pcache, const Instruction *text)
+{
+    static const char *region_names[] = { "static data", "stack" };
+    char name[32];
+
+    fprintf(out, "\n*** DATA CACHE ***\n");
+    for (unsigned l = 0; l < pcache->_nlevels; ++l)
+    {
+        const Cache_Level *plevel = &pcache->_levels[l];
+        sprintf(name, "L%u", l + 1);
+        fprintf(out, "%s: %u words, %u-way, %u-word lines, %s\n", name, plevel->_cfg._size,
+                plevel->_cfg._assoc, plevel->_cfg._line, plevel->_cfg._repl == REPL_LRU ? "LRU" : "PLRU");
+        print_stats(out, name, &plevel->_stats);
+        fprintf(out, "%-12s writebacks %llu\n", name, (unsigned long long) plevel->_writebacks);
+    }
+
+    fprintf(out, "\nL1 by region:\n");
+    for (unsigned r = 0; r < CACHE_NREGIONS; ++r)
+        print_stats(out, region_names[r], &pcache->_region_stats[r]);
+
+    // classement des instructions par nombre d'échecs
+    fprintf(out, "\nL1 misses by instruction (top %d):\n", CACHE_TOPPC);
+    unsigned top[CACHE_TOPPC];
+    unsigned ntop = model_top(pcache->_textsize, pc_misses, pcache, top, CACHE_TOPPC);
+    for (unsigned rank = 0; rank < ntop; ++rank)
+    {
+        unsigned pc = top[rank];
+        char buf[DISASM_MAXLEN + 1];
+        buf[format_instruction(buf, text[pc], pc)] = '\0';
+        sprintf(name, "0x%04x", pc);
+        fprintf(out, "%-24s ", buf);
+        print_stats(out, name, &pcache->_pc_stats[pc]);
+    }
+    putc('\n', out);
+}
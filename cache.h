@@ -0,0 +1,133 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+/*!
+ * \file cache.h
+ * \brief Modèle de hiérarchie de caches de données.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "instruction.h"
+
+//! Nombre maximal de niveaux de cache
+#define CACHE_MAXLEVELS 2
+
+//! Associativité maximale d'un cache
+#define CACHE_MAXASSOC 64
+
+//! Politique de remplacement
+typedef enum
+{
+    REPL_LRU,		//!< Moins récemment utilisé (exact)
+    REPL_PLRU,		//!< Pseudo-LRU en arbre
+} Replacement;
+
+//! Paramètres d'un niveau de cache
+/*!
+ * Les tailles sont exprimées en mots de la machine (une adresse de donnée
+ * désigne un mot) et doivent être des puissances de 2.
+ */
+typedef struct
+{
+    unsigned _size;		//!< Taille totale (mots)
+    unsigned _assoc;		//!< Associativité (nombre de voies)
+    unsigned _line;		//!< Taille d'une ligne (mots)
+    Replacement _repl;		//!< Politique de remplacement
+} Cache_Config;
+
+//! Compteurs de succès et d'échecs
+typedef struct
+{
+    uint64_t _reads;		//!< Lectures
+    uint64_t _writes;		//!< Écritures
+    uint64_t _read_misses;	//!< Lectures manquées
+    uint64_t _write_misses;	//!< Écritures manquées
+} Cache_Stats;
+
+//! Un niveau de cache (écriture différée, allocation sur écriture)
+typedef struct
+{
+    Cache_Config _cfg;		//!< Paramètres
+    unsigned _nsets;		//!< Nombre d'ensembles
+    unsigned _lineshift;	//!< Log2 de la taille de ligne
+    uint32_t *_tags;		//!< Étiquettes (numéro de ligne + 1, 0 = invalide)
+    bool *_dirty;		//!< Lignes modifiées
+    uint64_t *_stamps;		//!< Dates de dernier accès (LRU)
+    uint64_t *_plru;		//!< Bits de l'arbre pseudo-LRU (un mot par ensemble)
+    uint64_t _clock;		//!< Horloge LRU
+    uint64_t _writebacks;	//!< Lignes modifiées évincées
+    Cache_Stats _stats;		//!< Compteurs globaux
+} Cache_Level;
+
+//! Régions du segment de données pour les statistiques
+typedef enum
+{
+    REGION_STATIC = 0,		//!< Données statiques (avant \c _dataend)
+    REGION_STACK,		//!< Pile (à partir de \c _dataend)
+} Cache_Region;
+
+//! Nombre de régions
+#define CACHE_NREGIONS (REGION_STACK + 1)
+
+//! Hiérarchie de caches de données
+typedef struct Cache
+{
+    unsigned _nlevels;		//!< Nombre de niveaux
+    Cache_Level _levels[CACHE_MAXLEVELS]; //!< Niveaux (L1 d'abord)
+    unsigned _dataend;		//!< Frontière entre données statiques et pile
+    unsigned _textsize;		//!< Taille du texte (statistiques par instruction)
+    Cache_Stats *_pc_stats;	//!< Statistiques L1 par adresse d'instruction
+    Cache_Stats _region_stats[CACHE_NREGIONS]; //!< Statistiques L1 par région
+} Cache;
+
+//! Analyse d'une description de hiérarchie de caches
+/*!
+ * La description a la forme <tt>taille:assoc:ligne[:lru|plru][,...]</tt>,
+ * un niveau par élément séparé par des virgules (L1 d'abord), les tailles
+ * étant en mots. Par exemple <tt>256:4:8,4096:8:8:plru</tt>.
+ *
+ * \param spec la description
+ * \param cfg les paramètres de chaque niveau
+ * \return le nombre de niveaux, ou 0 si la description est invalide
+ */
+unsigned cache_parse(const char *spec, Cache_Config cfg[CACHE_MAXLEVELS]);
+
+//! Création d'une hiérarchie de caches
+/*!
+ * \param cfg les paramètres de chaque niveau
+ * \param nlevels le nombre de niveaux
+ * \param textsize la taille du texte du programme observé
+ * \param dataend la fin de ses données statiques
+ * \return la hiérarchie (vide)
+ */
+Cache *cache_new(const Cache_Config cfg[], unsigned nlevels, unsigned textsize, unsigned dataend);
+
+//! Destruction d'une hiérarchie de caches
+void cache_free(Cache *pcache);
+
+//! Accès à un mot de données
+/*!
+ * \param pcache la hiérarchie
+ * \param pc l'adresse de l'instruction qui fait l'accès
+ * \param addr l'adresse de la donnée
+ * \param write écriture ?
+ * \return le nombre de niveaux manqués (0 : succès en L1, \c _nlevels :
+ * accès à la mémoire)
+ */
+unsigned cache_access(Cache *pcache, unsigned pc, unsigned addr, bool write);
+
+//! Affichage des statistiques
+/*!
+ * Taux de succès par niveau, par région et pour les instructions qui
+ * provoquent le plus d'échecs en L1 (avec leur désassemblage).
+ *
+ * \param out le flot de sortie
+ * \param pcache la hiérarchie
+ * \param text le texte du programme (pour le désassemblage)
+ */
+void cache_report(FILE *out, const Cache *pcache, const Instruction *text);
+
+#endif
@@ -0,0 +1,272 @@
+/*!
+ * \file device.c
+ * \brief Périphériques projetés en mémoire (entrées-sorties avec l'hôte).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "device.h"
+#include "machine.h"
+#include "error.h"
+
+//! Ajout d'un bloc de mots dans un tampon circulaire
+/*!
+ * La copie se fait en au plus deux memcpy() (avant et après le retour au
+ * début du tampon).
+ *
+ * \param pring le tampon
+ * \param words les mots à ajouter
+ * \param n leur nombre
+ * \return le nombre de mots effectivement ajoutés (limité par la place libre)
+ */
+unsigned ring_put(Ring *pring, const Word *words, unsigned n)
+{
+    unsigned space = ring_space(pring);
+    if (n > space)
+        n = space;
+
+    unsigned pos = pring->_tail & (pring->_capacity - 1);
+    unsigned first = pring->_capacity - pos;
+    if (first > n)
+        first = n;
+    memcpy(pring->_buf + pos, words, first * sizeof(Word));
+    memcpy(pring->_buf, words + first, (n - first) * sizeof(Word));
+    pring->_tail += n;
+    return n;
+}
+
+//! Retrait d'un bloc de mots d'un tampon circulaire
+/*!
+ * \param pring le tampon
+ * \param words où ranger les mots retirés
+ * \param n le nombre de mots demandés
+ * \return le nombre de mots effectivement retirés
+ */
+unsigned ring_get(Ring *pring, Word *words, unsigned n)
+{
+    unsigned count = ring_count(pring);
+    if (n > count)
+        n = count;
+
+    unsigned pos = pring->_head & (pring->_capacity - 1);
+    unsigned first = pring->_capacity - pos;
+    if (first > n)
+        first = n;
+    memcpy(words, pring->_buf + pos, first * sizeof(Word));
+    memcpy(words + first, pring->_buf, (n - first) * sizeof(Word));
+    pring->_head += n;
+    return n;
+}
+
+//! Initialisation d'un tampon circulaire
+/*!
+ * \param pring le tampon
+ * \param size la capacité souhaitée (arrondie à la puissance de 2 supérieure)
+ */
+static void ring_init(Ring *pring, unsigned size)
+{
+    unsigned capacity = 1;
+    while (capacity < size)
+        capacity <<= 1;
+
+    pring->_buf = (Word *) malloc(capacity * sizeof(Word));
+    if (pring->_buf == NULL)
+    {
+        perror("ring_init.malloc");
+        exit(EXIT_FAILURE);
+    }
+    pring->_capacity = capacity;
+    pring->_head = pring->_tail = 0;
+}
+
+//! Initialisation des périphériques
+/*!
+ * \param pdev les périphériques
+ * \param ringsize capacité des files (arrondie à la puissance de 2 supérieure)
+ */
+void devices_init(Devices *pdev, unsigned ringsize)
+{
+    ring_init(&pdev->_in, ringsize);
+    ring_init(&pdev->_out, ringsize);
+    pdev->_fill = NULL;
+    pdev->_drain = NULL;
+    pdev->_infd = pdev->_outfd = -1;
+    pdev->_inbytes = pdev->_outbytes = 0;
+}
+
+//! Libération des périphériques
+void devices_free(Devices *pdev)
+{
+    free(pdev->_in._buf);
+    free(pdev->_out._buf);
+    pdev->_in._buf = pdev->_out._buf = NULL;
+    if (pdev->_infd >= 0)
+        close(pdev->_infd);
+    if (pdev->_outfd >= 0)
+        close(pdev->_outfd);
+    devices_bind_fds(pdev, -1, -1);
+}
+
+//! Remplissage de la file d'entrée depuis le descripteur \c _infd
+/*!
+ * On lit directement dans la mémoire du tampon, en au plus deux appels à
+ * read() par remplissage (partie contiguë jusqu'à la fin du tampon, puis
+ * début du tampon). Une lecture courte (tube, socket) peut s'arrêter au
+ * milieu d'un mot : ses premiers octets restent en place (\c _inbytes) et
+ * la lecture suivante le complète ; on lit jusqu'à obtenir au moins un mot
+ * complet (ou la fin du fichier). Un mot incomplet en fin de fichier est
+ * ignoré.
+ */
+static void fill_from_fd(Devices *pdev)
+{
+    Ring *pring = &pdev->_in;
+
+    while (ring_space(pring) > 0)
+    {
+        unsigned pos = pring->_tail & (pring->_capacity - 1);
+        unsigned chunk = pring->_capacity - pos;
+        if (chunk > ring_space(pring))
+            chunk = ring_space(pring);
+
+        size_t wanted = chunk * sizeof(Word) - pdev->_inbytes;
+        ssize_t nread = read(pdev->_infd, (char *) (pring->_buf + pos) + pdev->_inbytes, wanted);
+        if (nread <= 0)
+            break;
+        size_t total = pdev->_inbytes + nread;
+        pring->_tail += total / sizeof(Word);
+        pdev->_inbytes = total % sizeof(Word); // début du mot suivant, déjà en place
+        if (nread < wanted && ring_count(pring) > 0)
+            break; // lecture courte : assez pour continuer
+    }
+}
+
+//! Vidage de la file de sortie vers le descripteur \c _outfd
+/*!
+ * Une écriture courte peut s'arrêter au milieu d'un mot : il reste en tête
+ * de file et seuls ses octets non encore écrits (après \c _outbytes) le
+ * sont ensuite.
+ */
+static void drain_to_fd(Devices *pdev)
+{
+    Ring *pring = &pdev->_out;
+
+    while (ring_count(pring) > 0)
+    {
+        unsigned pos = pring->_head & (pring->_capacity - 1);
+        unsigned chunk = pring->_capacity - pos;
+        if (chunk > ring_count(pring))
+            chunk = ring_count(pring);
+
+        ssize_t nwritten = write(pdev->_outfd, (char *) (pring->_buf + pos) + pdev->_outbytes,
+                                 chunk * sizeof(Word) - pdev->_outbytes);
+        if (nwritten == -1 && errno == EINTR)
+            continue;
+        if (nwritten <= 0)
+        {
+            perror("drain_to_fd.write");
+            exit(EXIT_FAILURE);
+        }
+        size_t total = pdev->_outbytes + nwritten;
+        pring->_head += total / sizeof(Word);
+        pdev->_outbytes = total % sizeof(Word);
+    }
+}
+
+//! Branchement des files sur des descripteurs de fichier de l'hôte
+/*!
+ * \param pdev les périphériques
+ * \param infd descripteur alimentant la file d'entrée
+ * \param outfd descripteur recevant la file de sortie
+ */
+void devices_bind_fds(Devices *pdev, int infd, int outfd)
+{
+    pdev->_infd = infd;
+    pdev->_outfd = outfd;
+    pdev->_fill = infd >= 0 ? fill_from_fd : NULL;
+    pdev->_drain = outfd >= 0 ? drain_to_fd : NULL;
+}
+
+//! Ajout de données en entrée par l'hôte
+unsigned devices_feed(Devices *pdev, const Word *words, unsigned n)
+{
+    return ring_put(&pdev->_in, words, n);
+}
+
+//! Récupération des données produites par la machine
+unsigned devices_collect(Devices *pdev, Word *words, unsigned n)
+{
+    return ring_get(&pdev->_out, words, n);
+}
+
+//! Vidage final de la file de sortie (si une fonction de vidage est définie)
+void devices_flush(Devices *pdev)
+{
+    if (pdev->_drain != NULL && ring_count(&pdev->_out) > 0)
+        pdev->_drain(pdev);
+}
+
+//! Nombre de mots en entrée, après une éventuelle demande de remplissage
+static unsigned input_available(Devices *pdev)
+{
+    if (ring_count(&pdev->_in) == 0 && pdev->_fill != NULL)
+        pdev->_fill(pdev);
+    return ring_count(&pdev->_in);
+}
+
+//! Lecture d'un registre de périphérique
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse de donnée (hors du segment de données)
+ * \param addr adresse de l'instruction en cours
+ * \return la valeur lue ; lève \c ERR_SEGDATA si l'adresse ne correspond à
+ * aucun périphérique
+ */
+Word device_load(Machine *pmach, unsigned adresse, unsigned addr)
+{
+    Devices *pdev = pmach->_devices;
+
+    if (pdev == NULL || adresse < DEV_BASE || adresse >= DEV_BASE + DEV_NREGS)
+        error(ERR_SEGDATA, addr);
+
+    switch (adresse - DEV_BASE)
+    {
+        case DEV_IN:
+        {
+            Word value = 0; // file vide : on lit 0
+            if (input_available(pdev) > 0)
+                ring_get(&pdev->_in, &value, 1);
+            return value;
+        }
+        case DEV_INCOUNT: return input_available(pdev);
+        case DEV_OUTSPACE: return ring_space(&pdev->_out);
+        case DEV_CYCLES_LO: return (Word) pmach->_icount;
+        case DEV_CYCLES_HI: return (Word) (pmach->_icount >> 32);
+        default: error(ERR_DEVICE, addr); // registre en écriture seule
+    }
+}
+
+//! Écriture dans un registre de périphérique
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse de donnée (hors du segment de données)
+ * \param value la valeur à écrire
+ * \param addr adresse de l'instruction en cours
+ */
+void device_store(Machine *pmach, unsigned adresse, Word value, unsigned addr)
+{
+    Devices *pdev = pmach->_devices;
+
+    if (pdev == NULL || adresse < DEV_BASE || adresse >= DEV_BASE + DEV_NREGS)
+        error(ERR_SEGDATA, addr);
+    if (adresse - DEV_BASE != DEV_OUT)
+        error(ERR_DEVICE, addr); // registre en lecture seule
+
+    if (ring_space(&pdev->_out) == 0 && pdev->_drain != NULL)
+        pdev->_drain(pdev);
+    if (ring_put(&pdev->_out, &value, 1) == 0)
+        error(ERR_DEVICE, addr); // personne pour vider la file
+}
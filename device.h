@@ -0,0 +1,185 @@
+#ifndef _DEVICE_H_
+#define _DEVICE_H_
+
+/*!
+ * \file device.h
+ * \brief Périphériques projetés en mémoire (entrées-sorties avec l'hôte).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "instruction.h"
+
+struct Machine;
+
+//! Adresse de base de la zone réservée aux périphériques
+/*!
+ * Les derniers mots de l'espace d'adressage absolu (20 bits) du segment de
+ * données sont réservés aux périphériques. Les instructions qui lisent ou
+ * écrivent une donnée (\c LOAD, \c STORE, \c ADD, \c SUB, \c PUSH, \c POP...)
+ * sont aiguillées vers le périphérique correspondant lorsque l'adresse tombe
+ * dans cette zone.
+ *
+ * \note Si le segment de données est assez grand pour recouvrir cette zone,
+ * c'est la mémoire qui l'emporte : les périphériques deviennent inaccessibles.
+ */
+#define DEV_BASE 0xFFFF0
+
+//! Registres des périphériques (déplacement par rapport à \c DEV_BASE)
+typedef enum
+{
+    DEV_IN = 0,		//!< Lecture : mot suivant de la file d'entrée (0 si vide)
+    DEV_INCOUNT,	//!< Lecture : nombre de mots disponibles en entrée (0 = fin)
+    DEV_OUT,		//!< Écriture : ajout d'un mot dans la file de sortie
+    DEV_OUTSPACE,	//!< Lecture : place libre dans la file de sortie
+    DEV_CYCLES_LO,	//!< Lecture : compteur de cycles (32 bits de poids faible)
+    DEV_CYCLES_HI,	//!< Lecture : compteur de cycles (32 bits de poids fort)
+} Device_Register;
+
+//! Nombre de registres de périphériques
+#define DEV_NREGS (DEV_CYCLES_HI + 1)
+
+//! Capacité par défaut (en mots) des files d'entrée et de sortie
+#define DEV_RINGSIZE (1u << 16)
+
+//! Tampon circulaire de mots
+/*!
+ * La capacité est une puissance de 2 ; les indices \c _head (lecture) et \c
+ * _tail (écriture) croissent indéfiniment et sont réduits modulo la capacité
+ * lors de l'accès au tampon. Le nombre de mots présents est donc simplement
+ * \c _tail - \c _head.
+ */
+typedef struct
+{
+    Word *_buf;			//!< Mémoire du tampon
+    unsigned _capacity;		//!< Capacité (puissance de 2)
+    uint64_t _head;		//!< Indice du prochain mot à lire
+    uint64_t _tail;		//!< Indice du prochain mot à écrire
+} Ring;
+
+//! Ensemble des périphériques attachés à une machine
+/*!
+ * L'hôte remplit la file d'entrée et vide la file de sortie par blocs. Il
+ * peut le faire entre deux exécutions (devices_feed(), devices_collect()) ou
+ * bien à la demande de la machine simulée grâce aux fonctions \c _fill
+ * (appelée quand la file d'entrée est vide) et \c _drain (appelée quand la
+ * file de sortie est pleine, et à la fin de l'exécution).
+ *
+ * Les périphériques appartiennent à l'appelant, qui les attache à une
+ * machine (\c _devices) : machine_free() ne les libère pas. Il les libère
+ * par devices_free() quand plus aucune machine ne les utilise.
+ */
+typedef struct Devices
+{
+    Ring _in;			//!< File d'entrée (hôte -> machine)
+    Ring _out;			//!< File de sortie (machine -> hôte)
+
+    //! Remplissage de la file d'entrée par l'hôte
+    void (*_fill)(struct Devices *pdev);
+    //! Vidage de la file de sortie par l'hôte
+    void (*_drain)(struct Devices *pdev);
+
+    int _infd;			//!< Descripteur d'entrée (devices_bind_fds())
+    int _outfd;			//!< Descripteur de sortie (devices_bind_fds())
+    unsigned _inbytes;		//!< Octets déjà lus du mot incomplet qui suit la file d'entrée
+    unsigned _outbytes;		//!< Octets déjà écrits du mot en tête de la file de sortie
+} Devices;
+
+//! Nombre de mots présents dans un tampon circulaire
+static inline unsigned ring_count(const Ring *pring)
+{
+    return (unsigned) (pring->_tail - pring->_head);
+}
+
+//! Place libre dans un tampon circulaire
+static inline unsigned ring_space(const Ring *pring)
+{
+    return pring->_capacity - ring_count(pring);
+}
+
+//! Ajout d'un bloc de mots dans un tampon circulaire
+/*!
+ * \param pring le tampon
+ * \param words les mots à ajouter
+ * \param n leur nombre
+ * \return le nombre de mots effectivement ajoutés (limité par la place libre)
+ */
+unsigned ring_put(Ring *pring, const Word *words, unsigned n);
+
+//! Retrait d'un bloc de mots d'un tampon circulaire
+/*!
+ * \param pring le tampon
+ * \param words où ranger les mots retirés
+ * \param n le nombre de mots demandés
+ * \return le nombre de mots effectivement retirés
+ */
+unsigned ring_get(Ring *pring, Word *words, unsigned n);
+
+//! Initialisation des périphériques
+/*!
+ * \param pdev les périphériques
+ * \param ringsize capacité des files (arrondie à la puissance de 2 supérieure)
+ */
+void devices_init(Devices *pdev, unsigned ringsize);
+
+//! Libération des périphériques
+/*!
+ * Les files sont libérées et les descripteurs branchés par
+ * devices_bind_fds() fermés. La file de sortie n'est pas vidée (voir
+ * devices_flush()).
+ *
+ * \param pdev les périphériques
+ */
+void devices_free(Devices *pdev);
+
+//! Branchement des files sur des descripteurs de fichier de l'hôte
+/*!
+ * Les mots (32 bits, ordre des octets de l'hôte) sont lus et écrits par blocs
+ * aussi grands que la place disponible dans les files ; un mot coupé par une
+ * lecture ou une écriture courte est complété par la suivante. Un
+ * descripteur négatif laisse la file correspondante sans fonction de
+ * remplissage ou de vidage. Les descripteurs sont ensuite fermés par
+ * devices_free().
+ *
+ * \param pdev les périphériques
+ * \param infd descripteur alimentant la file d'entrée
+ * \param outfd descripteur recevant la file de sortie
+ */
+void devices_bind_fds(Devices *pdev, int infd, int outfd);
+
+//! Ajout de données en entrée par l'hôte
+/*!
+ * \return le nombre de mots acceptés
+ */
+unsigned devices_feed(Devices *pdev, const Word *words, unsigned n);
+
+//! Récupération des données produites par la machine
+/*!
+ * \return le nombre de mots récupérés
+ */
+unsigned devices_collect(Devices *pdev, Word *words, unsigned n);
+
+//! Vidage final de la file de sortie (si une fonction de vidage est définie)
+void devices_flush(Devices *pdev);
+
+//! Lecture d'un registre de périphérique
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse de donnée (hors du segment de données)
+ * \param addr adresse de l'instruction en cours
+ * \return la valeur lue ; lève \c ERR_SEGDATA si l'adresse ne correspond à
+ * aucun périphérique
+ */
+Word device_load(struct Machine *pmach, unsigned adresse, unsigned addr);
+
+//! Écriture dans un registre de périphérique
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse de donnée (hors du segment de données)
+ * \param value la valeur à écrire
+ * \param addr adresse de l'instruction en cours
+ */
+void device_store(struct Machine *pmach, unsigned adresse, Word value, unsigned addr);
+
+#endif
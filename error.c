@@ -38,6 +38,15 @@ void error(Error err, unsigned addr)
 		case ERR_SEGSTACK:
 			printf("Violation de taille du segment de pile at 0x%x\n",addr);
 			exit(EXIT_FAILURE);
+		case ERR_DEVICE:
+			printf("Accès invalide à un périphérique at 0x%x\n",addr);
+			exit(EXIT_FAILURE);
+		case ERR_DIVZERO:
+			printf("Division par zéro at 0x%x\n",addr);
+			exit(EXIT_FAILURE);
+		case ERR_TRAP:
+			printf("Service de l'hôte inconnu at 0x%x\n",addr);
+			exit(EXIT_FAILURE);
 		default:
 			printf("Condition illégale at 0x%x\n", addr);
 			exit(EXIT_FAILURE);
@@ -25,10 +25,13 @@ typedef enum
     ERR_SEGTEXT,	//!< Violation de taille du segment de texte
     ERR_SEGDATA,	//!< Violation de taille du segment de données
     ERR_SEGSTACK,	//!< Violation de taille du segment de pile
+    ERR_DEVICE,		//!< Accès invalide à un périphérique
+    ERR_DIVZERO,	//!< Division par zéro
+    ERR_TRAP,		//!< Service de l'hôte inconnu (TRAP)
 } Error; 
 
 //! Dernière valeur possible du code d'erreur
-static const unsigned LAST_ERROR = ERR_SEGSTACK;
+static const unsigned LAST_ERROR = ERR_TRAP;
 
 //! Codes d'avertissement
 /*!
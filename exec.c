@@ -5,7 +5,10 @@
 
 #include <stdio.h>
 #include "machine.h"
+#include "device.h"
 #include "error.h"
+#include "exec.h"
+#include "trap.h"
 
 //! Ensemble des instructions avec opérations
 
@@ -18,6 +21,13 @@ bool call(Machine *pmach, Instruction instr, unsigned addr);
 bool ret(Machine *pmach, Instruction instr, unsigned addr);
 bool push(Machine *pmach, Instruction instr, unsigned addr);
 bool pop(Machine *pmach, Instruction instr, unsigned addr);
+bool xchg(Machine *pmach, Instruction instr, unsigned addr);
+bool fadd(Machine *pmach, Instruction instr, unsigned addr);
+bool alu(Machine *pmach, Instruction instr, unsigned addr);
+bool cmp(Machine *pmach, Instruction instr, unsigned addr);
+bool move(Machine *pmach, Instruction instr, unsigned addr);
+bool fill(Machine *pmach, Instruction instr, unsigned addr);
+bool trap(Machine *pmach, Instruction instr, unsigned addr);
 
 //! Décodage et exécution d'une instruction
 
@@ -42,6 +52,20 @@ bool decode_execute(Machine *pmach, Instruction instr) {
         case PUSH: return push(pmach, instr, addr);
         case POP: return pop(pmach, instr, addr);
         case HALT: return false; // arrêt normal de l'exécution
+        case XCHG: return xchg(pmach, instr, addr);
+        case FADD: return fadd(pmach, instr, addr);
+        case MUL:
+        case DIV:
+        case MOD:
+        case AND:
+        case OR:
+        case XOR:
+        case SHL:
+        case SHR: return alu(pmach, instr, addr);
+        case CMP: return cmp(pmach, instr, addr);
+        case MOVE: return move(pmach, instr, addr);
+        case FILL: return fill(pmach, instr, addr);
+        case TRAP: return trap(pmach, instr, addr);
         default: error(ERR_UNKNOWN, addr);
     }
 }
@@ -59,34 +83,6 @@ unsigned int get_addr(Machine *pmach, Instruction instr) {
     }
 }
 
-//! Met à jour le code condition selon la valeur de registre
-
-/*!
- * \param pmach la machine en cours
- * \param reg le numéro de registre
- */
-void refresh_code_cond(Machine *pmach, unsigned int reg) {
-    if (reg < 0) {
-        pmach->_cc = CC_N; // cc négatif
-    } else if (reg > 0) {
-        pmach->_cc = CC_P; // cc positif
-    } else {
-        pmach->_cc = CC_Z; // cc nul
-    }
-}
-
-//! Vérifie qu'on n'a pas d'erreur de segmentation dans la pile de donnée
-
-/*!
- * \param pmach la machine en cours
- * \param adresse adresse (absolue ou indexée) de l'instruction en cours
- * \param addr adresse réelle
- */
-void check_data_addr(Machine *pmach, unsigned int adresse, unsigned addr) {
-    if (adresse > pmach->_datasize)
-        error(ERR_SEGDATA, addr);
-}
-
 //! Contrôle que l'instruction n'est pas immédiate
 
 /*!
@@ -120,18 +116,6 @@ bool condition_respected(Machine *pmach, Instruction instr, unsigned addr) {
     }
 }
 
-//! Contrôle que le sommet de pile est valide
-
-/*!
- * \param pmach la machine en cours
- * \param addr adresse de l'instruction
- */
-void check_stack_pointer(Machine *pmach, unsigned addr) {
-    if (pmach->_sp < pmach->_dataend || pmach->_sp >= pmach->_datasize) { // dataend>SP>datasize
-        error(ERR_SEGSTACK, addr);
-    }
-}
-
 //! Décodage et éxecution de l'instruction LOAD
 
 /*!
@@ -147,8 +131,7 @@ bool load(Machine *pmach, Instruction instr, unsigned addr) {
         pmach->_registers[instr.instr_generic._regcond] = instr.instr_immediate._value; // R <- Val
     } else { // sinon I = 0, absolu ou indexé
         unsigned int adresse = get_addr(pmach, instr); // on récupère l'adresse réelle
-        check_data_addr(pmach, adresse, addr); // on contrôle qu'on ne dépasse pas la taille de la pile
-        pmach->_registers[instr.instr_generic._regcond] = pmach->_data[adresse]; // R <- Data[Addr]
+        pmach->_registers[instr.instr_generic._regcond] = read_data(pmach, adresse, addr); // R <- Data[Addr]
     }
     //on met à jour le code condition
     refresh_code_cond(pmach, pmach->_registers[instr.instr_generic._regcond]);
@@ -168,8 +151,7 @@ bool load(Machine *pmach, Instruction instr, unsigned addr) {
 bool store(Machine *pmach, Instruction instr, unsigned addr) {
     check_not_immediate(instr, addr); // on contrôle que l'instruction n'est pas immédiate
     unsigned int adresse = get_addr(pmach, instr); // on récupére l'adresse réelle
-    check_data_addr(pmach, adresse, addr); // on contrôle qu'on est dans la pile
-    pmach->_data[adresse] = pmach->_registers[instr.instr_generic._regcond]; // Data[Addr] <- R
+    write_data(pmach, adresse, pmach->_registers[instr.instr_generic._regcond], addr); // Data[Addr] <- R
     return true;
 }
 
@@ -188,8 +170,7 @@ bool add(Machine *pmach, Instruction instr, unsigned addr) {
         pmach->_registers[instr.instr_generic._regcond] += instr.instr_immediate._value; // R <- R + Value
     } else { // sinon I = 0, absolue ou indexée
         unsigned int adresse = get_addr(pmach, instr); // on récupére l'adresse réelle
-        check_data_addr(pmach, adresse, addr); // on contrôle qu'on est dans la pile
-        pmach->_registers[instr.instr_generic._regcond] += pmach->_data[adresse]; // R <- R + Data[Addr]
+        pmach->_registers[instr.instr_generic._regcond] += read_data(pmach, adresse, addr); // R <- R + Data[Addr]
     }
     refresh_code_cond(pmach, pmach->_registers[instr.instr_generic._regcond]); // on met à jour le code condition
     return true;
@@ -210,8 +191,7 @@ bool sub(Machine *pmach, Instruction instr, unsigned addr) {
         pmach->_registers[instr.instr_generic._regcond] -= instr.instr_immediate._value; // R <- R + Value
     } else { // sinon I = 0, absolue ou indexée
         unsigned int adresse = get_addr(pmach, instr); // on récupére l'adresse réelle
-        check_data_addr(pmach, adresse, addr); // on contrôle qu'on est dans la pile
-        pmach->_registers[instr.instr_generic._regcond] -= pmach->_data[adresse]; // R <- R + Data[Addr]
+        pmach->_registers[instr.instr_generic._regcond] -= read_data(pmach, adresse, addr); // R <- R + Data[Addr]
     }
     refresh_code_cond(pmach, pmach->_registers[instr.instr_generic._regcond]); // on met à jour le code condition
     return true;
@@ -289,8 +269,7 @@ bool push(Machine *pmach, Instruction instr, unsigned addr) {
         pmach->_data[pmach->_sp--] = instr.instr_immediate._value; // Data[SP] <- Value puis SP <- SP -1
     } else { // si I = 0, instruction absolue ou indexée
         unsigned int adresse = get_addr(pmach, instr); // on récupère l'adresse de l'instruction
-        check_data_addr(pmach, adresse, addr); // on contrôle qu'on reste dans la pile
-        pmach->_data[pmach->_sp--] = pmach->_data[adresse]; // Data[SP] <- Data[Addr] puis SP <- SP -1
+        pmach->_data[pmach->_sp--] = read_data(pmach, adresse, addr); // Data[SP] <- Data[Addr] puis SP <- SP -1
     }
     return true;
 }
@@ -308,12 +287,284 @@ bool push(Machine *pmach, Instruction instr, unsigned addr) {
 bool pop(Machine *pmach, Instruction instr, unsigned addr) {
     check_not_immediate(instr, addr); // on contrôle que l'adresse n'est pas immédiate
     unsigned int adresse = get_addr(pmach, instr); // on récupère l'adresse de l'instruction
-    check_data_addr(pmach, adresse, addr); // on contrôle qu'on reste dans la pile
     check_stack_pointer(pmach, addr); // on contrôle que le SP est valide (dataend<SP<=datasize-1)
-    pmach->_data[adresse] = pmach->_data[++pmach->_sp]; // SP <- SP +1 puis Data[Addr] <- Data[SP]
+    write_data(pmach, adresse, pmach->_data[++pmach->_sp], addr); // SP <- SP +1 puis Data[Addr] <- Data[SP]
+    return true;
+}
+
+//! Décodage et éxecution de l'instruction XCHG
+
+/*!
+ * Accepte adressage absolu et indexé. L'échange est atomique et
+ * séquentiellement cohérent (voir smp.h).
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool xchg(Machine *pmach, Instruction instr, unsigned addr) {
+    check_not_immediate(instr, addr); // on contrôle que l'adresse n'est pas immédiate
+    Word *pword = atomic_word(pmach, get_addr(pmach, instr), addr); // on récupère le mot visé
+    Word *preg = &pmach->_registers[instr.instr_generic._regcond];
+    *preg = atomic_exchange_word(pword, *preg); // R <-> Data[Addr]
+    refresh_code_cond(pmach, *preg); // code condition selon l'ancienne valeur
+    return true;
+}
+
+//! Décodage et éxecution de l'instruction FADD
+
+/*!
+ * Accepte adressage absolu et indexé. L'addition est atomique et
+ * séquentiellement cohérente (voir smp.h).
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool fadd(Machine *pmach, Instruction instr, unsigned addr) {
+    check_not_immediate(instr, addr); // on contrôle que l'adresse n'est pas immédiate
+    Word *pword = atomic_word(pmach, get_addr(pmach, instr), addr); // on récupère le mot visé
+    Word *preg = &pmach->_registers[instr.instr_generic._regcond];
+    *preg = atomic_fetch_add_word(pword, *preg); // Data[Addr] <- Data[Addr] + R, R <- ancienne valeur
+    refresh_code_cond(pmach, *preg); // code condition selon l'ancienne valeur
+    return true;
+}
+
+//! Valeur de l'opérande d'une instruction arithmétique
+
+/*!
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return la valeur immédiate ou Data[Addr]
+ */
+static Word get_operand(Machine *pmach, Instruction instr, unsigned addr) {
+    if (instr.instr_generic._immediate) // si I = 1, immédiat
+        return instr.instr_immediate._value;
+    return read_data(pmach, get_addr(pmach, instr), addr); // sinon Data[Addr]
+}
+
+//! Décodage et éxecution des instructions MUL, DIV, MOD, AND, OR, XOR, SHL et SHR
+
+/*!
+ * Accepte adressage immédiat, absolu et indexé
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool alu(Machine *pmach, Instruction instr, unsigned addr) {
+    Word *preg = &pmach->_registers[instr.instr_generic._regcond];
+    *preg = alu_compute(instr.instr_generic._cop, *preg, get_operand(pmach, instr, addr), addr); // R <- R op Value
+    refresh_code_cond(pmach, *preg); // on met à jour le code condition
+    return true;
+}
+
+//! Décodage et éxecution de l'instruction CMP
+
+/*!
+ * Accepte adressage immédiat, absolu et indexé. Le code condition est celui
+ * qu'aurait donné SUB, mais le registre n'est pas modifié.
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool cmp(Machine *pmach, Instruction instr, unsigned addr) {
+    Word value = get_operand(pmach, instr, addr);
+    refresh_code_cond(pmach, pmach->_registers[instr.instr_generic._regcond] - value); // CC <- signe de R - Value
     return true;
 }
 
+//! Décodage et éxecution de l'instruction MOVE
+
+/*!
+ * <tt>MOVE Rc, Rd, Rs</tt> : copie de Rc mots de Data[Rs] vers Data[Rd]
+ * (les blocs peuvent se recouvrir). Les registres ne sont pas modifiés.
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool move(Machine *pmach, Instruction instr, unsigned addr) {
+    check_not_immediate(instr, addr); // on contrôle que l'instruction n'est pas immédiate
+    Word *regs = pmach->_registers;
+    block_move(pmach, regs[instr.instr_block._regcond], regs[instr.instr_block._rdest],
+               regs[instr.instr_block._rsrc], addr); // Data[Rd..] <- Data[Rs..]
+    return true;
+}
+
+//! Décodage et éxecution de l'instruction FILL
+
+/*!
+ * <tt>FILL Rc, Rd, Rv</tt> : Rc mots à partir de Data[Rd] reçoivent la
+ * valeur de Rv. Les registres ne sont pas modifiés.
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return true
+ */
+bool fill(Machine *pmach, Instruction instr, unsigned addr) {
+    check_not_immediate(instr, addr); // on contrôle que l'instruction n'est pas immédiate
+    Word *regs = pmach->_registers;
+    block_fill(pmach, regs[instr.instr_block._regcond], regs[instr.instr_block._rdest],
+               regs[instr.instr_block._rsrc], addr); // Data[Rd..] <- Rv
+    return true;
+}
+
+//! Décodage et éxecution de l'instruction TRAP
+
+/*!
+ * <tt>TRAP #n</tt> : appel du service numéro n de l'hôte (voir trap.h).
+ * Seule la forme immédiate existe.
+ * 
+ * \param pmach machine en cours d'éxecution
+ * \param instr instruction en cours
+ * \param addr addresse de l'instruction en cours
+ * \return faux si le service arrête le programme
+ */
+bool trap(Machine *pmach, Instruction instr, unsigned addr) {
+    if (!instr.instr_generic._immediate)
+        error(ERR_ILLEGAL, addr);
+    return trap_call(pmach, instr.instr_immediate._value, addr);
+}
+
+//! Affichage de la trace d'exécution par simul() (vrai par défaut)
+bool trace_enabled = true;
+
+//! Ajout d'un accès à la liste s'il concerne le segment de données
+
+/*!
+ * \param pmach la machine en cours
+ * \param acc la liste des accès
+ * \param n le nombre d'accès déjà dans la liste
+ * \param adresse l'adresse accédée
+ * \param write écriture ?
+ * \return le nouveau nombre d'accès
+ */
+static unsigned add_access(Machine *pmach, Access acc[], unsigned n, unsigned adresse, bool write) {
+    if (adresse < pmach->_datasize) { // les périphériques ne comptent pas
+        acc[n]._addr = adresse;
+        acc[n]._count = 1;
+        acc[n]._write = write;
+        n++;
+    }
+    return n;
+}
+
+//! Accès aux données effectués par une instruction
+
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param instr l'instruction qui va être exécutée
+ * \param acc les accès (au plus \c MAXACCESSES)
+ * \return le nombre d'accès
+ */
+unsigned data_accesses(Machine *pmach, Instruction instr, Access acc[MAXACCESSES]) {
+    bool imm = instr.instr_generic._immediate;
+    unsigned n = 0;
+
+    switch (instr.instr_generic._cop) {
+        case LOAD:
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+        case AND:
+        case OR:
+        case XOR:
+        case SHL:
+        case SHR:
+        case CMP:
+            if (!imm)
+                n = add_access(pmach, acc, n, get_addr(pmach, instr), false); // R <- R op Data[Addr]
+            break;
+        case STORE:
+            n = add_access(pmach, acc, n, get_addr(pmach, instr), true); // Data[Addr] <- R
+            break;
+        case CALL:
+            if (instr.instr_generic._regcond <= LAST_CONDITION
+                && condition_respected(pmach, instr, pmach->_pc))
+                n = add_access(pmach, acc, n, pmach->_sp, true); // Data[SP] <- PC
+            break;
+        case RET:
+            n = add_access(pmach, acc, n, pmach->_sp + 1, false); // PC <- Data[SP + 1]
+            break;
+        case PUSH:
+            if (!imm)
+                n = add_access(pmach, acc, n, get_addr(pmach, instr), false);
+            n = add_access(pmach, acc, n, pmach->_sp, true); // Data[SP] <- Value
+            break;
+        case POP:
+            n = add_access(pmach, acc, n, pmach->_sp + 1, false);
+            n = add_access(pmach, acc, n, get_addr(pmach, instr), true); // Data[Addr] <- Data[SP + 1]
+            break;
+        case MOVE:
+        case FILL:
+        {
+            Word *regs = pmach->_registers;
+            Word count = regs[instr.instr_block._regcond];
+            Word src = regs[instr.instr_block._rsrc], dest = regs[instr.instr_block._rdest];
+            if (count == 0 || (uint64_t) dest + count > pmach->_datasize
+                || (instr.instr_generic._cop == MOVE && (uint64_t) src + count > pmach->_datasize))
+                break; // rien, ou erreur à l'exécution
+            if (instr.instr_generic._cop == MOVE) {
+                acc[n] = (Access) { src, count, false }; // Data[Rs..]
+                n++;
+            }
+            acc[n] = (Access) { dest, count, true }; // Data[Rd..]
+            n++;
+            break;
+        }
+        case XCHG:
+        case FADD:
+            n = add_access(pmach, acc, n, get_addr(pmach, instr), false); // lecture puis écriture atomiques
+            n = add_access(pmach, acc, n, get_addr(pmach, instr), true);
+            break;
+        case TRAP:
+        {
+            const Trap_Service *ps = imm ? trap_service(instr.instr_immediate._value) : NULL;
+            Word *regs = pmach->_registers;
+            if (ps == NULL || ps->_access == TRAP_NOACCESS || regs[2] == 0
+                || (uint64_t) regs[1] + regs[2] > pmach->_datasize)
+                break; // rien, ou erreur à l'exécution
+            acc[n] = (Access) { regs[1], regs[2], ps->_access == TRAP_DATA_WRITE }; // Data[R01..]
+            n++;
+            break;
+        }
+        default:
+            break;
+    }
+    return n;
+}
+
+//! Transfert de contrôle effectué par une instruction
+
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param instr l'instruction qui va être exécutée
+ * \return vrai si le branchement sera pris
+ */
+bool transfer_taken(Machine *pmach, Instruction instr) {
+    switch (instr.instr_generic._cop) {
+        case BRANCH:
+        case CALL:
+            return instr.instr_generic._regcond <= LAST_CONDITION
+                && condition_respected(pmach, instr, pmach->_pc);
+        case RET:
+            return true;
+        default:
+            return false;
+    }
+}
+
 //! Trace de l'exécution
 
 /*!
@@ -6,7 +6,22 @@
  * \brief Exécution d'une instruction.
  */
 
+#include <string.h>
+
 #include "machine.h"
+#include "device.h"
+#include "error.h"
+
+//! Levée d'une erreur par les fonctions d'exécution ci-dessous
+/*!
+ * C'est error() par défaut. Une unité de compilation qui produit un moteur
+ * instrumenté (voir fast_engine.h) peut le redéfinir avant d'inclure ce
+ * fichier pour observer les fautes ; l'expression doit finir par appeler
+ * error().
+ */
+#ifndef EXEC_FAULT
+#define EXEC_FAULT(err, addr) error(err, addr)
+#endif
 
 //! Décodage et exécution d'une instruction
 /*!
@@ -16,6 +31,236 @@
  */
 bool decode_execute(Machine *pmach, Instruction instr);
 
+//! Met à jour le code condition selon la valeur de registre
+/*!
+ * \note Les fonctions suivantes sont partagées par l'interpréteur (exec.c) et
+ * le moteur rapide (fast.c) ; elles sont \c inline car elles sont sur le
+ * chemin critique de l'exécution.
+ *
+ * \param pmach la machine en cours
+ * \param reg la valeur du registre
+ */
+static inline void refresh_code_cond(Machine *pmach, unsigned int reg) {
+    if ((int32_t) reg < 0) { // le registre est interprété en complément à 2
+        pmach->_cc = CC_N; // cc négatif
+    } else if (reg > 0) {
+        pmach->_cc = CC_P; // cc positif
+    } else {
+        pmach->_cc = CC_Z; // cc nul
+    }
+}
+
+//! Calcul d'une opération arithmétique ou logique (MUL, DIV, MOD, AND...)
+/*!
+ * Les opérandes sont des entiers de 32 bits en complément à 2 ; les
+ * dépassements de capacité sont ignorés (résultat modulo 2^32, y compris
+ * pour la division du plus petit entier par -1). Le nombre de positions d'un
+ * décalage est pris modulo 32.
+ *
+ * \param op le code opération
+ * \param a la valeur du registre
+ * \param b l'opérande
+ * \param addr adresse de l'instruction (pour l'erreur de division par zéro)
+ * \return le résultat
+ */
+static inline Word alu_compute(Code_Op op, Word a, Word b, unsigned addr) {
+    switch (op) {
+        case MUL: return a * b;
+        case DIV:
+        case MOD:
+            if (b == 0)
+                EXEC_FAULT(ERR_DIVZERO, addr);
+            if ((int32_t) b == -1) // évite le débordement de INT32_MIN / -1
+                return op == DIV ? -a : 0;
+            return op == DIV ? (Word) ((int32_t) a / (int32_t) b) : (Word) ((int32_t) a % (int32_t) b);
+        case AND: return a & b;
+        case OR: return a | b;
+        case XOR: return a ^ b;
+        case SHL: return a << (b & 31);
+        case SHR: return a >> (b & 31);
+        case CMP:
+        default: return a - b;
+    }
+}
+
+//! Contrôle que le sommet de pile est valide
+/*!
+ * \param pmach la machine en cours
+ * \param addr adresse de l'instruction
+ */
+static inline void check_stack_pointer(Machine *pmach, unsigned addr) {
+    if (pmach->_sp < pmach->_stacklow || pmach->_sp >= pmach->_stackhigh) { // stacklow>SP>stackhigh
+        EXEC_FAULT(ERR_SEGSTACK, addr);
+    }
+}
+
+//! Lecture d'une donnée
+/*!
+ * Les adresses hors du segment de données sont aiguillées vers les
+ * périphériques (voir device.h) ; seul ce chemin (rare) coûte plus qu'une
+ * comparaison.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse réelle de la donnée
+ * \param addr adresse de l'instruction en cours
+ * \return la valeur lue
+ */
+static inline Word read_data(Machine *pmach, unsigned int adresse, unsigned addr) {
+    if (adresse >= pmach->_datasize)
+        return device_load(pmach, adresse, addr); // périphérique ou ERR_SEGDATA
+    return pmach->_data[adresse];
+}
+
+//! Écriture d'une donnée
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse réelle de la donnée
+ * \param value la valeur à écrire
+ * \param addr adresse de l'instruction en cours
+ */
+static inline void write_data(Machine *pmach, unsigned int adresse, Word value, unsigned addr) {
+    if (adresse >= pmach->_datasize)
+        device_store(pmach, adresse, value, addr); // périphérique ou ERR_SEGDATA
+    else
+        pmach->_data[adresse] = value;
+}
+
+//! Accès à un bloc de mots du segment de données
+typedef struct
+{
+    unsigned _addr;		//!< Première adresse
+    unsigned _count;		//!< Nombre de mots
+    bool _write;		//!< Écriture (sinon lecture)
+} Access;
+
+//! Nombre maximal de blocs accédés par une instruction
+#define MAXACCESSES 3
+
+//! Mot de données cible d'une opération atomique (XCHG, FADD)
+/*!
+ * Les opérations atomiques ne s'appliquent qu'au segment de données (pas aux
+ * périphériques).
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param adresse adresse réelle de la donnée
+ * \param addr adresse de l'instruction en cours
+ * \return l'adresse (hôte) du mot
+ */
+static inline Word *atomic_word(Machine *pmach, unsigned int adresse, unsigned addr) {
+    if (adresse >= pmach->_datasize)
+        EXEC_FAULT(ERR_SEGDATA, addr);
+    return &pmach->_data[adresse];
+}
+
+//! Échange atomique (barrière complète, voir smp.h)
+/*!
+ * \param pword le mot de données
+ * \param value la nouvelle valeur
+ * \return l'ancienne valeur
+ */
+static inline Word atomic_exchange_word(Word *pword, Word value) {
+    Word old = __atomic_exchange_n(pword, value, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return old;
+}
+
+//! Addition atomique (barrière complète, voir smp.h)
+/*!
+ * \param pword le mot de données
+ * \param value la valeur à ajouter
+ * \return l'ancienne valeur
+ */
+static inline Word atomic_fetch_add_word(Word *pword, Word value) {
+    Word old = __atomic_fetch_add(pword, value, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return old;
+}
+
+//! Contrôle qu'un bloc de mots est dans le segment de données
+/*!
+ * Un seul contrôle pour tout le bloc (calculé sur 64 bits : pas de
+ * débordement).
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param adresse première adresse du bloc
+ * \param count nombre de mots
+ * \param addr adresse de l'instruction en cours
+ */
+static inline void check_block(Machine *pmach, Word adresse, Word count, unsigned addr) {
+    if ((uint64_t) adresse + count > pmach->_datasize)
+        EXEC_FAULT(ERR_SEGDATA, addr);
+}
+
+//! Copie d'un bloc de mots de données (MOVE)
+/*!
+ * Les blocs peuvent se recouvrir (memmove()).
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param count nombre de mots
+ * \param dest adresse de destination
+ * \param src adresse source
+ * \param addr adresse de l'instruction en cours
+ */
+static inline void block_move(Machine *pmach, Word count, Word dest, Word src, unsigned addr) {
+    check_block(pmach, dest, count, addr);
+    check_block(pmach, src, count, addr);
+    memmove(pmach->_data + dest, pmach->_data + src, (size_t) count * sizeof(Word));
+}
+
+//! Remplissage d'un bloc de mots de données (FILL)
+/*!
+ * memset() quand tous les octets de la valeur sont égaux (0 et -1 en
+ * particulier), sinon une boucle simple que le compilateur vectorise.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param count nombre de mots
+ * \param dest adresse de destination
+ * \param value valeur de remplissage
+ * \param addr adresse de l'instruction en cours
+ */
+static inline void block_fill(Machine *pmach, Word count, Word dest, Word value, unsigned addr) {
+    check_block(pmach, dest, count, addr);
+    Word *p = pmach->_data + dest;
+    if (value == (value & 0xff) * 0x01010101u)
+        memset(p, value & 0xff, (size_t) count * sizeof(Word));
+    else
+        for (Word i = 0; i < count; ++i)
+            p[i] = value;
+}
+
+//! Accès aux données effectués par une instruction
+/*!
+ * Calcul, \e avant son exécution, des lectures et écritures que va faire
+ * l'instruction dans le segment de données (pile comprise). Les accès aux
+ * périphériques ne sont pas comptés. Si l'instruction doit provoquer une
+ * erreur, le résultat n'a pas de sens (l'erreur est fatale).
+ *
+ * Cette fonction sert aux modèles de performance (voir model.h) : elle
+ * permet d'observer la mémoire sans instrumenter les fonctions d'exécution.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param instr l'instruction qui va être exécutée
+ * \param acc les accès (au plus \c MAXACCESSES)
+ * \return le nombre d'accès
+ */
+unsigned data_accesses(Machine *pmach, Instruction instr, Access acc[MAXACCESSES]);
+
+//! Transfert de contrôle effectué par une instruction
+/*!
+ * Calcul, \e avant son exécution, du fait que l'instruction va modifier le
+ * déroulement séquentiel : \c BRANCH ou \c CALL dont la condition est
+ * respectée, \c RET. Comme pour data_accesses(), le résultat n'a pas de sens
+ * si l'instruction doit provoquer une erreur.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param instr l'instruction qui va être exécutée
+ * \return vrai si le branchement sera pris
+ */
+bool transfer_taken(Machine *pmach, Instruction instr);
+
+//! Affichage de la trace d'exécution par simul() (vrai par défaut)
+extern bool trace_enabled;
+
 //! Trace de l'exécution
 /*!
  * On écrit l'adresse et l'instruction sous forme lisible.
@@ -0,0 +1,268 @@
+/*!
+ * \file fast.c
+ * \brief Moteur d'exécution rapide sur texte prédécodé.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fast.h"
+#include "exec.h"
+#include "device.h"
+#include "error.h"
+#include "arena.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+//! Prédécodage d'une instruction à opérande (immédiat, absolu ou indexé)
+/*!
+ * \param instr l'instruction
+ * \param imm code prédécodé de la forme immédiate (ou \c F_IMMERR)
+ * \param abs code prédécodé de la forme absolue
+ * \param idx code prédécodé de la forme indexée
+ * \return la forme prédécodée
+ */
+static Decoded predecode_operand(Instruction instr, Fast_Op imm, Fast_Op abs, Fast_Op idx)
+{
+    Decoded d = { 0, instr.instr_generic._regcond, 0, 0, 0 };
+
+    if (instr.instr_generic._immediate)
+    {
+        d._op = imm;
+        d._operand = instr.instr_immediate._value;
+    }
+    else if (instr.instr_generic._indexed)
+    {
+        d._op = idx;
+        d._rindex = instr.instr_indexed._rindex;
+        d._operand = instr.instr_indexed._offset;
+    }
+    else
+    {
+        d._op = abs;
+        d._operand = instr.instr_absolute._address;
+    }
+    return d;
+}
+
+//! Prédécodage d'une instruction
+/*!
+ * \param instr l'instruction
+ * \return sa forme prédécodée
+ */
+Decoded predecode(Instruction instr)
+{
+    Decoded d = { F_UNKNOWN, 0, 0, 0, 0 };
+
+    switch (instr.instr_generic._cop)
+    {
+        case ILLOP: d._op = F_ILLOP; break;
+        case NOP: d._op = F_NOP; break;
+        case HALT: d._op = F_HALT; break;
+        case RET: d._op = F_RET; break;
+        case LOAD: return predecode_operand(instr, F_LOAD_I, F_LOAD_A, F_LOAD_X);
+        case STORE: return predecode_operand(instr, F_IMMERR, F_STORE_A, F_STORE_X);
+        case ADD: return predecode_operand(instr, F_ADD_I, F_ADD_A, F_ADD_X);
+        case SUB: return predecode_operand(instr, F_SUB_I, F_SUB_A, F_SUB_X);
+        case BRANCH:
+            d = predecode_operand(instr, F_IMMERR, F_BRANCH_A, F_BRANCH_X);
+            if (d._op == F_BRANCH_A && d._reg == NC)
+                d._op = F_JUMP_A;
+            break;
+        case CALL: return predecode_operand(instr, F_IMMERR, F_CALL_A, F_CALL_X);
+        case PUSH: return predecode_operand(instr, F_PUSH_I, F_PUSH_A, F_PUSH_X);
+        case POP: return predecode_operand(instr, F_IMMERR, F_POP_A, F_POP_X);
+        case XCHG: return predecode_operand(instr, F_IMMERR, F_XCHG_A, F_XCHG_X);
+        case FADD: return predecode_operand(instr, F_IMMERR, F_FADD_A, F_FADD_X);
+        case MUL:
+        case DIV:
+        case MOD:
+        case AND:
+        case OR:
+        case XOR:
+        case SHL:
+        case SHR:
+            d = predecode_operand(instr, F_ALU_I, F_ALU_A, F_ALU_X);
+            d._aux = instr.instr_generic._cop;
+            break;
+        case CMP: return predecode_operand(instr, F_CMP_I, F_CMP_A, F_CMP_X);
+        case MOVE:
+        case FILL:
+            d._op = instr.instr_generic._immediate ? F_IMMERR : instr.instr_generic._cop == MOVE ? F_MOVE : F_FILL;
+            d._reg = instr.instr_block._regcond;
+            d._rindex = instr.instr_block._rdest;
+            d._aux = instr.instr_block._rsrc;
+            break;
+        case TRAP:
+            d._op = instr.instr_generic._immediate ? F_TRAP : F_ILLOP;
+            d._operand = instr.instr_immediate._value;
+            break;
+        default: break;
+    }
+    return d;
+}
+
+//! Forme prédécodée rendue par fast_release(), réutilisable par le thread
+static __thread Fast_Text *spare;
+
+//! Libération définitive d'une forme prédécodée
+static void fast_destroy(Fast_Text *pfast)
+{
+    munmap(pfast->_code, pfast->_codelen);
+    free(pfast);
+}
+
+//! Préparation (paresseuse) de la forme prédécodée du texte d'une machine
+/*!
+ * \param pmach la machine
+ * \return la forme prédécodée (également rangée dans \c pmach->_fast)
+ */
+Fast_Text *fast_prepare(Machine *pmach)
+{
+    if (pmach->_fast != NULL)
+        return pmach->_fast;
+
+    // une entrée de plus que le texte pour la sentinelle
+    unsigned npages = (pmach->_textsize + FAST_PAGE_SIZE) >> FAST_PAGE_SHIFT;
+    size_t codelen = (size_t) npages * FAST_PAGE_SIZE * sizeof(Decoded);
+
+    Fast_Text *pfast = spare;
+    if (pfast != NULL && pfast->_codelen >= codelen)
+        spare = NULL; // réservation assez grande (et remise à zéro) : réutilisée
+    else
+    {
+        pfast = (Fast_Text *) malloc(sizeof(Fast_Text));
+        if (pfast == NULL)
+        {
+            perror("fast_prepare.malloc");
+            exit(EXIT_FAILURE);
+        }
+        pfast->_codelen = codelen;
+        pfast->_code = (Decoded *) mmap(NULL, codelen, PROT_READ|PROT_WRITE,
+                                        MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+        if (pfast->_code == MAP_FAILED)
+        {
+            perror("fast_prepare.mmap");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pfast->_textsize = pmach->_textsize;
+    pfast->_npages = npages;
+    pfast->_ndecoded = 0;
+    pfast->_mapped = false;
+    pmach->_fast = pfast;
+    return pfast;
+}
+
+//! Restitution d'une forme prédécodée
+/*!
+ * Les pages décodées sont remises à zéro (\c F_LAZY) : par memset() s'il y
+ * en a peu, sinon en les rendant au système (\c MADV_DONTNEED), qui les
+ * fournira de nouveau remplies de zéros. La forme est ensuite gardée pour
+ * le prochain fast_prepare() du thread (la plus grande des deux est gardée
+ * si une autre l'était déjà). Une table projetée depuis le cache
+ * (pcache.h) est libérée.
+ *
+ * \param pfast la forme prédécodée (ou NULL)
+ */
+void fast_release(Fast_Text *pfast)
+{
+    if (pfast == NULL)
+        return;
+    if (pfast->_mapped)
+    {
+        // projetée par pcache.c, descripteur pris dans la réserve
+        munmap(pfast->_code, pfast->_codelen);
+        arena_release(pfast);
+        return;
+    }
+
+    if (pfast->_ndecoded <= FAST_RESET_PAGES)
+    {
+        for (unsigned page = 0; page < pfast->_npages && pfast->_ndecoded > 0; ++page)
+            if (pfast->_code[page << FAST_PAGE_SHIFT]._op != F_LAZY)
+            {
+                memset(pfast->_code + (page << FAST_PAGE_SHIFT), 0, FAST_PAGE_SIZE * sizeof(Decoded));
+                pfast->_ndecoded--;
+            }
+    }
+    else if (madvise(pfast->_code, pfast->_codelen, MADV_DONTNEED) == -1)
+    {
+        fast_destroy(pfast);
+        return;
+    }
+    pfast->_ndecoded = 0;
+
+    if (spare != NULL && spare->_codelen > pfast->_codelen)
+        fast_destroy(pfast);
+    else
+    {
+        if (spare != NULL)
+            fast_destroy(spare);
+        spare = pfast;
+    }
+}
+
+//! Reconnaissance d'une boucle à compteur fermée par une instruction
+/*!
+ * \param code la table prédécodée
+ * \param i l'adresse du branchement de retour supposé (les trois
+ * instructions précédentes sont décodées)
+ * \return vrai si les instructions \c i-3 à \c i forment une boucle à
+ * compteur (voir fast_decode_page() dans fast.h)
+ */
+static bool counted_loop(const Decoded *code, unsigned i)
+{
+    const Decoded *exit = &code[i - 3];
+    const Decoded *acc = &code[i - 2];
+    const Decoded *ind = &code[i - 1];
+
+    if (code[i]._op != F_JUMP_A || code[i]._operand != (int32_t) (i - 3))
+        return false;
+    if (exit->_op != F_BRANCH_A || exit->_reg < EQ || exit->_reg > LE)
+        return false;
+    if (acc->_op != F_ADD_I && acc->_op != F_ADD_A && acc->_op != F_ADD_X)
+        return false;
+    if ((ind->_op != F_ADD_I && ind->_op != F_SUB_I) || ind->_operand == 0 || ind->_reg == acc->_reg)
+        return false;
+    // l'opérande de l'accumulation ne doit pas dépendre des registres modifiés
+    return acc->_op != F_ADD_X || (acc->_rindex != acc->_reg && acc->_rindex != ind->_reg);
+}
+
+//! Décodage de la page contenant une adresse
+/*!
+ * Les entrées au delà de la fin du texte deviennent des sentinelles. Les
+ * boucles à compteur entièrement contenues dans la page sont reconnues.
+ *
+ * \param pfast la forme prédécodée
+ * \param text le texte d'origine
+ * \param addr une adresse de la page à décoder
+ */
+void fast_decode_page(Fast_Text *pfast, const Instruction *text, unsigned addr)
+{
+    unsigned start = addr & ~(FAST_PAGE_SIZE - 1);
+    unsigned end = start + FAST_PAGE_SIZE;
+    unsigned last = end < pfast->_textsize ? end : pfast->_textsize;
+    Decoded *code = pfast->_code;
+    Decoded sentinel = { F_SEGTEXT, 0, 0, 0, 0 };
+
+    for (unsigned i = start; i < last; ++i)
+        code[i] = predecode(text[i]);
+    for (unsigned i = last < start ? start : last; i < end; ++i)
+        code[i] = sentinel;
+    for (unsigned i = start + 3; i < last; ++i)
+        if (counted_loop(code, i))
+            code[i]._op = F_LOOP_A;
+    pfast->_ndecoded++;
+}
+
+//! Moteur rapide sans crochet (voir fast_engine.h)
+#define FAST_ENGINE simul_fast
+#include "fast_engine.h"
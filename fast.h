@@ -0,0 +1,184 @@
+#ifndef _FAST_H_
+#define _FAST_H_
+
+/*!
+ * \file fast.h
+ * \brief Moteur d'exécution rapide sur texte prédécodé.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+//! Codes opérations prédécodés
+/*!
+ * Chaque instruction est traduite une fois pour toutes dans une forme où le
+ * mode d'adressage est intégré au code opération et où les erreurs
+ * détectables statiquement (valeur immédiate interdite, instruction
+ * illégale...) sont remplacées par une opération qui lève l'erreur au moment
+ * de l'exécution, exactement comme le ferait decode_execute().
+ *
+ * \note La valeur 0 (\c F_LAZY) est celle d'une entrée pas encore décodée :
+ * la table prédécodée peut ainsi être allouée en mémoire anonyme (remplie de
+ * zéros à la demande par le système) sans initialisation explicite.
+ */
+typedef enum
+{
+    F_LAZY = 0,		//!< Page pas encore décodée
+    F_SEGTEXT,		//!< Au delà de la fin du texte
+    F_ILLOP,		//!< Instruction illégale
+    F_UNKNOWN,		//!< Code opération inconnu
+    F_IMMERR,		//!< Valeur immédiate interdite
+    F_NOP,		//!< Instruction sans effet
+    F_HALT,		//!< Arrêt du programme
+    F_LOAD_I,		//!< LOAD immédiat
+    F_LOAD_A,		//!< LOAD absolu
+    F_LOAD_X,		//!< LOAD indexé
+    F_STORE_A,		//!< STORE absolu
+    F_STORE_X,		//!< STORE indexé
+    F_ADD_I,		//!< ADD immédiat
+    F_ADD_A,		//!< ADD absolu
+    F_ADD_X,		//!< ADD indexé
+    F_SUB_I,		//!< SUB immédiat
+    F_SUB_A,		//!< SUB absolu
+    F_SUB_X,		//!< SUB indexé
+    F_JUMP_A,		//!< BRANCH NC absolu (inconditionnel)
+    F_BRANCH_A,		//!< BRANCH conditionnel absolu
+    F_BRANCH_X,		//!< BRANCH indexé
+    F_CALL_A,		//!< CALL absolu
+    F_CALL_X,		//!< CALL indexé
+    F_RET,		//!< RET
+    F_PUSH_I,		//!< PUSH immédiat
+    F_PUSH_A,		//!< PUSH absolu
+    F_PUSH_X,		//!< PUSH indexé
+    F_POP_A,		//!< POP absolu
+    F_POP_X,		//!< POP indexé
+    F_XCHG_A,		//!< XCHG absolu
+    F_XCHG_X,		//!< XCHG indexé
+    F_FADD_A,		//!< FADD absolu
+    F_FADD_X,		//!< FADD indexé
+    F_ALU_I,		//!< MUL, DIV... immédiat (opération dans \c _aux)
+    F_ALU_A,		//!< MUL, DIV... absolu
+    F_ALU_X,		//!< MUL, DIV... indexé
+    F_CMP_I,		//!< CMP immédiat
+    F_CMP_A,		//!< CMP absolu
+    F_CMP_X,		//!< CMP indexé
+    F_MOVE,		//!< MOVE (nombre dans \c _reg, destination \c _rindex, source \c _aux)
+    F_FILL,		//!< FILL (nombre dans \c _reg, destination \c _rindex, valeur \c _aux)
+    F_TRAP,		//!< TRAP immédiat (numéro du service dans \c _operand)
+    F_LOOP_A,		//!< BRANCH NC absolu fermant une boucle à compteur (voir fast_decode_page())
+} Fast_Op;
+
+//! Dernière valeur possible d'un code opération prédécodé
+static const unsigned LAST_FAST_OP = F_LOOP_A;
+
+//! Instruction prédécodée
+/*!
+ * Structure compacte (8 octets) et sans pointeur : une page de texte
+ * prédécodée peut être copiée ou sauvegardée telle quelle.
+ */
+typedef struct
+{
+    uint8_t _op;		//!< Code opération prédécodé (Fast_Op)
+    uint8_t _reg;		//!< Numéro de registre ou condition
+    uint8_t _rindex;		//!< Registre d'index
+    uint8_t _aux;		//!< Code opération d'origine (F_ALU_*), registre source (F_MOVE, F_FILL)
+    int32_t _operand;		//!< Valeur immédiate, adresse absolue ou déplacement
+} Decoded;
+
+//! Log2 du nombre d'instructions par page prédécodée
+#define FAST_PAGE_SHIFT 9
+
+//! Nombre d'instructions par page prédécodée (une page de 4 Kio)
+#define FAST_PAGE_SIZE (1u << FAST_PAGE_SHIFT)
+
+//! Forme prédécodée d'un segment de texte
+/*!
+ * La table \c _code a une entrée par instruction, plus au moins une entrée
+ * sentinelle (\c F_SEGTEXT) après la dernière instruction. Elle est réservée
+ * en mémoire anonyme : seules les pages effectivement décodées occupent de
+ * la mémoire physique. Une page est décodée (et la page correspondante du
+ * texte, éventuellement projeté depuis le fichier, est lue) la première fois
+ * que le compteur ordinal y entre.
+ *
+ * La table peut aussi être projetée depuis un fichier du cache des formes
+ * prédécodées (voir pcache.h) : elle est alors entièrement décodée.
+ */
+typedef struct Fast_Text
+{
+    Decoded *_code;		//!< Table prédécodée
+    size_t _codelen;		//!< Taille de la réservation (en octets)
+    unsigned _textsize;		//!< Taille du texte
+    unsigned _npages;		//!< Nombre de pages de la table
+    unsigned _ndecoded;		//!< Nombre de pages déjà décodées
+    bool _mapped;		//!< Table projetée depuis le cache (pas recyclée)
+} Fast_Text;
+
+//! Prédécodage d'une instruction
+/*!
+ * \param instr l'instruction
+ * \return sa forme prédécodée
+ */
+Decoded predecode(Instruction instr);
+
+//! Préparation (paresseuse) de la forme prédécodée du texte d'une machine
+/*!
+ * Rien n'est décodé ici : la table est seulement réservée (ou reprise d'une
+ * forme rendue par fast_release() sur le même thread). Sans effet si la
+ * machine possède déjà une forme prédécodée.
+ *
+ * \param pmach la machine
+ * \return la forme prédécodée (également rangée dans \c pmach->_fast)
+ */
+Fast_Text *fast_prepare(Machine *pmach);
+
+//! Nombre maximal de pages décodées remises à zéro une à une par fast_release()
+#define FAST_RESET_PAGES 16
+
+//! Restitution d'une forme prédécodée (machine_free())
+/*!
+ * La forme est remise à zéro et gardée pour être réutilisée par le prochain
+ * fast_prepare() du même thread ; une table projetée depuis le cache est
+ * simplement libérée.
+ *
+ * \param pfast la forme prédécodée (ou NULL)
+ */
+void fast_release(Fast_Text *pfast);
+
+//! Décodage de la page contenant une adresse
+/*!
+ * Les boucles à compteur de la page sont reconnues au passage : une boucle
+ * de la forme
+ * \code
+ * H:   BRANCH cond, sortie   (EQ, NE, GT, GE, LT ou LE)
+ *      ADD    rA, opérande   (immédiat, absolu ou indexé par un autre registre)
+ *      SUB/ADD rI, #k        (rI différent de rA, k non nul)
+ *      BRANCH NC, H
+ * \endcode
+ * voit son branchement de retour prédécodé en \c F_LOOP_A. Quand il est
+ * exécuté, simul_fast() calcule directement le nombre d'itérations restantes
+ * et l'état (registres, \c _cc, \c _pc, \c _icount) à l'arrivée sur le
+ * branchement de sortie ; si une hypothèse n'est pas vérifiée (opérande dans
+ * un périphérique, compteur qui déborderait, code condition qui n'est pas
+ * celui du compteur...), c'est un branchement ordinaire.
+ *
+ * \param pfast la forme prédécodée
+ * \param text le texte d'origine
+ * \param addr une adresse de la page à décoder
+ */
+void fast_decode_page(Fast_Text *pfast, const Instruction *text, unsigned addr);
+
+//! Simulation avec le moteur rapide
+/*!
+ * Même sémantique que simul() (mêmes erreurs, mêmes périphériques) mais sur
+ * la forme prédécodée, sans trace ni mise au point. Les adresses de
+ * branchement sont contrôlées (erreur \c ERR_SEGTEXT) au moment où le
+ * branchement est pris ; le passage séquentiel au delà de la dernière
+ * instruction est détecté par l'entrée sentinelle.
+ *
+ * \param pmach la machine en cours d'exécution
+ */
+void simul_fast(Machine *pmach);
+
+#endif
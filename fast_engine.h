@@ -0,0 +1,559 @@
+/*!
+ * \file fast_engine.h
+ * \brief Boucle du moteur rapide, spécialisée à la compilation par des crochets.
+ *
+ * Ce fichier est un modèle : chaque inclusion produit une fonction
+ * d'exécution <tt>void FAST_ENGINE(Machine *pmach)</tt> sur le texte
+ * prédécodé (voir fast.h), avec la sémantique de simul_fast(). Avant
+ * l'inclusion, on définit \c FAST_ENGINE (le nom de la fonction) et
+ * éventuellement des crochets, qui sont des macros :
+ *
+ * <dl>
+ *   <dt>FAST_HOOK_BEFORE(pmach, addr, d)</dt><dd>avant chaque instruction
+ *   (\c d : sa forme prédécodée, \c addr : son adresse) ;</dd>
+ *
+ *   <dt>FAST_HOOK_READ(pmach, adresse, count)</dt><dd>après une lecture de
+ *   \c count mots du segment de données ou d'un périphérique, pile comprise
+ *   (mêmes accès que data_accesses()) ;</dd>
+ *
+ *   <dt>FAST_HOOK_WRITE(pmach, adresse, count)</dt><dd>après une écriture ;</dd>
+ *
+ *   <dt>FAST_HOOK_TRANSFER(pmach, from, to)</dt><dd>avant un transfert de
+ *   contrôle effectif (branchement pris, \c CALL, \c RET) de l'instruction
+ *   \c from vers \c to, une fois la destination contrôlée.</dd>
+ * </dl>
+ *
+ * Si \c FAST_GUARDED est défini, les lectures et écritures de données et les
+ * branchements ne sont pas contrôlés : le segment de données, le texte et la
+ * table prédécodée doivent être placés dans des zones gardées (voir
+ * guard.h), où un accès hors limites provoque une faute de l'hôte, et la
+ * machine ne doit pas avoir de périphérique. Les contrôles de la pile et des
+ * blocs restent.
+ *
+ * Si \c FAST_ATOMIC est défini, le segment de données est partagé avec
+ * d'autres threads (voir smp.h) : chaque accès à un mot, pile et blocs (\c
+ * MOVE, \c FILL) compris, est un accès atomique relâché (\c
+ * __atomic_load_n(), \c __atomic_store_n()), jamais fusionné, coupé ni
+ * déplacé hors de la boucle par le compilateur, et la forme close des boucles
+ * à compteur n'est pas utilisée (le mot lu peut changer entre deux
+ * itérations). Les autres moteurs gardent des accès ordinaires.
+ *
+ * Les fautes passent par \c EXEC_FAULT(err, addr) (voir exec.h), qu'une unité
+ * de compilation peut redéfinir avant d'inclure exec.h : ce crochet est donc
+ * commun à tous les moteurs de l'unité. Les erreurs levées par les
+ * périphériques (device.c) n'y passent pas.
+ *
+ * Un crochet absent ne produit aucun code : le moteur sans crochet
+ * (simul_fast(), dans fast.c) est exactement la boucle d'origine, sans test
+ * par instruction. Les crochets n'ont pas d'argument de contexte : ils
+ * utilisent des variables de leur unité de compilation (voir simul_watch.c).
+ * Les macros sont oubliées (\c #undef) après chaque inclusion, qui peut donc
+ * être répétée dans une même unité pour produire plusieurs moteurs.
+ *
+ * \note L'exécution en forme close des boucles à compteur (\c F_LOOP_A, voir
+ * fast_decode_page()) saute des instructions : elle n'est faite que si aucun
+ * crochet d'instruction, d'accès ou de transfert n'est défini.
+ */
+
+#ifndef _FAST_ENGINE_H_
+#define _FAST_ENGINE_H_
+
+#include "fast.h"
+#include "exec.h"
+#include "device.h"
+#include "error.h"
+#include "trap.h"
+
+//! Table de vérité des conditions
+/*!
+ * Indexée par la condition (champ \c _regcond) puis par le code condition.
+ * La valeur 2 signale une condition illégale (erreur \c ERR_CONDITION).
+ */
+static const uint8_t cond_table[16][CC_N + 1] = {
+//    U  Z  P  N
+    { 1, 1, 1, 1 },	// NC
+    { 0, 1, 0, 0 },	// EQ
+    { 1, 0, 1, 1 },	// NE
+    { 0, 0, 1, 0 },	// GT
+    { 0, 1, 1, 0 },	// GE
+    { 0, 0, 0, 1 },	// LT
+    { 0, 1, 0, 1 },	// LE
+    { 2, 2, 2, 2 }, { 2, 2, 2, 2 }, { 2, 2, 2, 2 }, { 2, 2, 2, 2 },
+    { 2, 2, 2, 2 }, { 2, 2, 2, 2 }, { 2, 2, 2, 2 }, { 2, 2, 2, 2 },
+    { 2, 2, 2, 2 },
+};
+
+//! Évaluation d'une condition de branchement
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param cond la condition
+ * \return vrai si la condition est respectée
+ */
+static inline bool cond_holds(Machine *pmach, unsigned cond)
+{
+    uint8_t v = cond_table[cond][pmach->_cc];
+    if (v > 1)
+        EXEC_FAULT(ERR_CONDITION, pmach->_pc);
+    return v;
+}
+
+//! Exécution en forme close des itérations restantes d'une boucle à compteur
+/*!
+ * Appelée sur le branchement de retour (\c F_LOOP_A), quand le corps vient
+ * d'être exécuté. Le compteur \c rI varie de \c s à chaque itération et la
+ * boucle s'arrête au premier passage sur le branchement de sortie où la
+ * condition est respectée ; le nombre \c m d'itérations restantes est
+ * calculé sur la valeur signée du compteur, seulement quand celui-ci atteint
+ * la condition de sortie sans déborder.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param code la table prédécodée
+ * \param head l'adresse de la tête de boucle (branchement de sortie)
+ * \return vrai si les itérations ont été exécutées : la machine est alors
+ * sur le branchement de sortie, qui sera pris ; faux si la boucle doit être
+ * exécutée normalement
+ */
+static inline bool counted_loop_run(Machine *pmach, const Decoded *code, unsigned head)
+{
+    const Decoded *acc = &code[head + 1];
+    const Decoded *ind = &code[head + 2];
+    Word *regs = pmach->_registers;
+    int64_t x = (int32_t) regs[ind->_reg];
+    int64_t s = ind->_op == F_SUB_I ? -(int64_t) ind->_operand : ind->_operand;
+    int64_t m = 0;
+
+    // arrivée directe sur le branchement de retour : le code condition
+    // n'est pas forcément celui du compteur
+    unsigned cc = pmach->_cc;
+    refresh_code_cond(pmach, regs[ind->_reg]);
+    if (pmach->_cc != cc)
+    {
+        pmach->_cc = cc;
+        return false;
+    }
+
+    switch (code[head]._reg)
+    {
+        case EQ: if (x != 0 && (x < 0) == (s > 0) && x % s == 0) m = -x / s; break;
+        case NE: if (x == 0) m = 1; break;
+        case GT: if (s > 0 && x <= 0) m = -x / s + 1; break;
+        case GE: if (s > 0 && x < 0) m = (-x + s - 1) / s; break;
+        case LT: if (s < 0 && x >= 0) m = x / -s + 1; break;
+        case LE: if (s < 0 && x > 0) m = (x - s - 1) / -s; break;
+        default: break;
+    }
+    if (m == 0)
+        return false; // sortie au prochain passage, ou compteur qui déborderait
+
+    Word value;
+    switch (acc->_op)
+    {
+        case F_ADD_I: value = acc->_operand; break;
+        case F_ADD_A:
+        case F_ADD_X:
+        {
+            Word adresse = acc->_operand + (acc->_op == F_ADD_X ? regs[acc->_rindex] : 0);
+            if (adresse >= pmach->_datasize)
+                return false; // périphérique : chaque lecture compte
+            value = pmach->_data[adresse];
+            break;
+        }
+        default: return false;
+    }
+
+    regs[acc->_reg] += (Word) ((uint64_t) m * value);
+    regs[ind->_reg] = (Word) (x + m * s);
+    refresh_code_cond(pmach, regs[ind->_reg]);
+    pmach->_icount += 4 * (uint64_t) m;
+    pmach->_pc = head;
+    return true;
+}
+
+//! Nom d'une fonction auxiliaire propre au moteur produit
+#define FAST_LOCAL(name) FAST_CAT(FAST_ENGINE, name)
+#define FAST_CAT(a, b) FAST_CAT_(a, b)
+#define FAST_CAT_(a, b) a ## _ ## b
+
+#endif
+
+#ifndef FAST_ENGINE
+#error "FAST_ENGINE (nom du moteur à produire) doit être défini avant d'inclure fast_engine.h"
+#endif
+
+#if !defined(FAST_HOOK_BEFORE) && !defined(FAST_HOOK_READ) && !defined(FAST_HOOK_WRITE) \
+    && !defined(FAST_HOOK_TRANSFER) && !defined(FAST_ATOMIC)
+#define FAST_CLOSED_FORM
+#endif
+#ifdef FAST_ATOMIC
+#define FAST_LOAD(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+#define FAST_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#else
+#define FAST_LOAD(p) (*(p))
+#define FAST_STORE(p, v) (*(p) = (v))
+#endif
+#ifndef FAST_HOOK_READ
+#define FAST_HOOK_READ(pmach, adresse, count) ((void) 0)
+#endif
+#ifndef FAST_HOOK_WRITE
+#define FAST_HOOK_WRITE(pmach, adresse, count) ((void) 0)
+#endif
+#ifndef FAST_HOOK_TRANSFER
+#define FAST_HOOK_TRANSFER(pmach, from, to) ((void) 0)
+#endif
+
+//! Lecture d'une donnée (crochet \c FAST_HOOK_READ)
+static inline Word FAST_LOCAL(read)(Machine *pmach, unsigned adresse)
+{
+#if defined(FAST_GUARDED)
+    Word value = FAST_LOAD(&pmach->_data[adresse]); // hors limites : faute dans la zone gardée
+#elif defined(FAST_ATOMIC)
+    Word value = adresse < pmach->_datasize ? FAST_LOAD(&pmach->_data[adresse])
+        : device_load(pmach, adresse, pmach->_pc); // périphérique ou ERR_SEGDATA
+#else
+    Word value = read_data(pmach, adresse, pmach->_pc);
+#endif
+    FAST_HOOK_READ(pmach, adresse, 1);
+    return value;
+}
+
+//! Écriture d'une donnée (crochet \c FAST_HOOK_WRITE)
+static inline void FAST_LOCAL(write)(Machine *pmach, unsigned adresse, Word value)
+{
+#if defined(FAST_GUARDED)
+    FAST_STORE(&pmach->_data[adresse], value);
+#elif defined(FAST_ATOMIC)
+    if (adresse < pmach->_datasize)
+        FAST_STORE(&pmach->_data[adresse], value);
+    else
+        device_store(pmach, adresse, value, pmach->_pc); // périphérique ou ERR_SEGDATA
+#else
+    write_data(pmach, adresse, value, pmach->_pc);
+#endif
+    FAST_HOOK_WRITE(pmach, adresse, 1);
+}
+
+//! Empilement (SP contrôlé par l'appelant)
+static inline void FAST_LOCAL(push)(Machine *pmach, Word value)
+{
+    FAST_STORE(&pmach->_data[pmach->_sp], value);
+    FAST_HOOK_WRITE(pmach, pmach->_sp, 1);
+    pmach->_sp--;
+}
+
+//! Dépilement (SP contrôlé par l'appelant)
+static inline Word FAST_LOCAL(pop)(Machine *pmach)
+{
+    Word value = FAST_LOAD(&pmach->_data[++pmach->_sp]);
+    FAST_HOOK_READ(pmach, pmach->_sp, 1);
+    return value;
+}
+
+//! Copie d'un bloc de mots de données (MOVE)
+static inline void FAST_LOCAL(move)(Machine *pmach, Word count, Word dest, Word src)
+{
+#ifdef FAST_ATOMIC
+    // mot à mot, dans le sens de memmove()
+    check_block(pmach, dest, count, pmach->_pc);
+    check_block(pmach, src, count, pmach->_pc);
+    Word *data = pmach->_data;
+    if (dest <= src)
+        for (Word i = 0; i < count; ++i)
+            FAST_STORE(&data[dest + i], FAST_LOAD(&data[src + i]));
+    else
+        for (Word i = count; i-- > 0; )
+            FAST_STORE(&data[dest + i], FAST_LOAD(&data[src + i]));
+#else
+    block_move(pmach, count, dest, src, pmach->_pc);
+#endif
+}
+
+//! Remplissage d'un bloc de mots de données (FILL)
+static inline void FAST_LOCAL(fill)(Machine *pmach, Word count, Word dest, Word value)
+{
+#ifdef FAST_ATOMIC
+    check_block(pmach, dest, count, pmach->_pc);
+    for (Word i = 0; i < count; ++i)
+        FAST_STORE(&pmach->_data[dest + i], value);
+#else
+    block_fill(pmach, count, dest, value, pmach->_pc);
+#endif
+}
+
+//! Branchement vers une adresse du texte
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param target l'adresse de destination
+ */
+static inline void FAST_LOCAL(jump)(Machine *pmach, unsigned target)
+{
+#ifndef FAST_GUARDED // sinon : sentinelle ou faute dans la zone gardée de la table
+    if (target >= pmach->_textsize)
+        EXEC_FAULT(ERR_SEGTEXT, target);
+#endif
+    FAST_HOOK_TRANSFER(pmach, pmach->_pc - 1, target);
+    pmach->_pc = target;
+}
+
+//! Opération atomique XCHG ou FADD sur un mot de données
+static inline Word FAST_LOCAL(atomic)(Machine *pmach, bool fadd, unsigned adresse, Word value)
+{
+    Word *pword = atomic_word(pmach, adresse, pmach->_pc);
+    value = fadd ? atomic_fetch_add_word(pword, value) : atomic_exchange_word(pword, value);
+    FAST_HOOK_READ(pmach, adresse, 1);
+    FAST_HOOK_WRITE(pmach, adresse, 1);
+    return value;
+}
+
+//! Appel d'un service de l'hôte (TRAP)
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param number le numéro du service
+ * \return faux si le service arrête le programme
+ */
+static inline bool FAST_LOCAL(trap)(Machine *pmach, Word number)
+{
+    const Trap_Service *ps = trap_service(number);
+    if (ps == NULL)
+        EXEC_FAULT(ERR_TRAP, pmach->_pc);
+    Word adresse = pmach->_registers[1], count = pmach->_registers[2];
+    bool running = trap_call(pmach, number, pmach->_pc);
+    if (count > 0 && ps->_access == TRAP_DATA_READ)
+        FAST_HOOK_READ(pmach, adresse, count);
+    if (count > 0 && ps->_access == TRAP_DATA_WRITE)
+        FAST_HOOK_WRITE(pmach, adresse, count);
+    (void) adresse;
+    return running;
+}
+
+//! Simulation avec le moteur rapide
+/*!
+ * Comme dans decode_execute(), \c _pc désigne l'instruction suivante
+ * pendant l'exécution d'une instruction, et c'est cette adresse qui est
+ * signalée en cas d'erreur.
+ *
+ * \param pmach la machine en cours d'exécution
+ */
+void FAST_ENGINE(Machine *pmach)
+{
+    Fast_Text *pfast = fast_prepare(pmach);
+    const Decoded *code = pfast->_code;
+    Word *regs = pmach->_registers;
+
+    for (;;)
+    {
+        const Decoded *d = &code[pmach->_pc++];
+        pmach->_icount++;
+#ifdef FAST_HOOK_BEFORE
+        if (d->_op != F_LAZY)
+            FAST_HOOK_BEFORE(pmach, pmach->_pc - 1, d);
+#endif
+
+        switch (d->_op)
+        {
+            case F_LAZY: // première entrée dans la page : on la décode et on recommence
+                pmach->_pc--;
+                pmach->_icount--;
+                fast_decode_page(pfast, pmach->_text, pmach->_pc);
+                break;
+            case F_SEGTEXT: EXEC_FAULT(ERR_SEGTEXT, pmach->_pc - 1);
+            case F_ILLOP: EXEC_FAULT(ERR_ILLEGAL, pmach->_pc);
+            case F_IMMERR: EXEC_FAULT(ERR_IMMEDIATE, pmach->_pc);
+            case F_NOP: break;
+            case F_HALT:
+                if (pmach->_devices != NULL)
+                    devices_flush(pmach->_devices);
+                return;
+
+            case F_LOAD_I:
+                regs[d->_reg] = d->_operand;
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_LOAD_A:
+                regs[d->_reg] = FAST_LOCAL(read)(pmach, d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_LOAD_X:
+                regs[d->_reg] = FAST_LOCAL(read)(pmach, regs[d->_rindex] + d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+
+            case F_STORE_A:
+                FAST_LOCAL(write)(pmach, d->_operand, regs[d->_reg]);
+                break;
+            case F_STORE_X:
+                FAST_LOCAL(write)(pmach, regs[d->_rindex] + d->_operand, regs[d->_reg]);
+                break;
+
+            case F_ADD_I:
+                regs[d->_reg] += d->_operand;
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_ADD_A:
+                regs[d->_reg] += FAST_LOCAL(read)(pmach, d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_ADD_X:
+                regs[d->_reg] += FAST_LOCAL(read)(pmach, regs[d->_rindex] + d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+
+            case F_SUB_I:
+                regs[d->_reg] -= d->_operand;
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_SUB_A:
+                regs[d->_reg] -= FAST_LOCAL(read)(pmach, d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_SUB_X:
+                regs[d->_reg] -= FAST_LOCAL(read)(pmach, regs[d->_rindex] + d->_operand);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+
+            case F_JUMP_A:
+                FAST_LOCAL(jump)(pmach, d->_operand);
+                break;
+            case F_LOOP_A:
+#ifdef FAST_CLOSED_FORM
+                if (counted_loop_run(pmach, code, d->_operand))
+                    break;
+#endif
+                FAST_LOCAL(jump)(pmach, d->_operand);
+                break;
+            case F_BRANCH_A:
+                if (cond_holds(pmach, d->_reg))
+                    FAST_LOCAL(jump)(pmach, d->_operand);
+                break;
+            case F_BRANCH_X:
+                if (cond_holds(pmach, d->_reg))
+                    FAST_LOCAL(jump)(pmach, regs[d->_rindex] + d->_operand);
+                break;
+
+            case F_CALL_A:
+                check_stack_pointer(pmach, pmach->_pc);
+                if (cond_holds(pmach, d->_reg))
+                {
+                    FAST_LOCAL(push)(pmach, pmach->_pc);
+                    FAST_LOCAL(jump)(pmach, d->_operand);
+                }
+                break;
+            case F_CALL_X:
+                check_stack_pointer(pmach, pmach->_pc);
+                if (cond_holds(pmach, d->_reg))
+                {
+                    FAST_LOCAL(push)(pmach, pmach->_pc);
+                    FAST_LOCAL(jump)(pmach, regs[d->_rindex] + d->_operand);
+                }
+                break;
+            case F_RET:
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(jump)(pmach, FAST_LOCAL(pop)(pmach));
+                break;
+
+            case F_PUSH_I:
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(push)(pmach, d->_operand);
+                break;
+            case F_PUSH_A:
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(push)(pmach, FAST_LOCAL(read)(pmach, d->_operand));
+                break;
+            case F_PUSH_X:
+            {
+                unsigned adresse = regs[d->_rindex] + d->_operand; // avant la mise à jour de SP
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(push)(pmach, FAST_LOCAL(read)(pmach, adresse));
+                break;
+            }
+
+            case F_POP_A:
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(write)(pmach, d->_operand, FAST_LOCAL(pop)(pmach));
+                break;
+            case F_POP_X:
+            {
+                unsigned adresse = regs[d->_rindex] + d->_operand; // avant la mise à jour de SP
+                check_stack_pointer(pmach, pmach->_pc);
+                FAST_LOCAL(write)(pmach, adresse, FAST_LOCAL(pop)(pmach));
+                break;
+            }
+
+            case F_XCHG_A:
+                regs[d->_reg] = FAST_LOCAL(atomic)(pmach, false, d->_operand, regs[d->_reg]);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_XCHG_X:
+                regs[d->_reg] = FAST_LOCAL(atomic)(pmach, false, regs[d->_rindex] + d->_operand, regs[d->_reg]);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_FADD_A:
+                regs[d->_reg] = FAST_LOCAL(atomic)(pmach, true, d->_operand, regs[d->_reg]);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_FADD_X:
+                regs[d->_reg] = FAST_LOCAL(atomic)(pmach, true, regs[d->_rindex] + d->_operand, regs[d->_reg]);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+
+            case F_ALU_I:
+                regs[d->_reg] = alu_compute(d->_aux, regs[d->_reg], d->_operand, pmach->_pc);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_ALU_A:
+                regs[d->_reg] = alu_compute(d->_aux, regs[d->_reg], FAST_LOCAL(read)(pmach, d->_operand), pmach->_pc);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+            case F_ALU_X:
+                regs[d->_reg] = alu_compute(d->_aux, regs[d->_reg],
+                                            FAST_LOCAL(read)(pmach, regs[d->_rindex] + d->_operand), pmach->_pc);
+                refresh_code_cond(pmach, regs[d->_reg]);
+                break;
+
+            case F_CMP_I:
+                refresh_code_cond(pmach, regs[d->_reg] - d->_operand);
+                break;
+            case F_CMP_A:
+                refresh_code_cond(pmach, regs[d->_reg] - FAST_LOCAL(read)(pmach, d->_operand));
+                break;
+            case F_CMP_X:
+                refresh_code_cond(pmach, regs[d->_reg] - FAST_LOCAL(read)(pmach, regs[d->_rindex] + d->_operand));
+                break;
+
+            case F_MOVE:
+                FAST_LOCAL(move)(pmach, regs[d->_reg], regs[d->_rindex], regs[d->_aux]);
+                if (regs[d->_reg] > 0)
+                {
+                    FAST_HOOK_READ(pmach, regs[d->_aux], regs[d->_reg]);
+                    FAST_HOOK_WRITE(pmach, regs[d->_rindex], regs[d->_reg]);
+                }
+                break;
+            case F_FILL:
+                FAST_LOCAL(fill)(pmach, regs[d->_reg], regs[d->_rindex], regs[d->_aux]);
+                if (regs[d->_reg] > 0)
+                    FAST_HOOK_WRITE(pmach, regs[d->_rindex], regs[d->_reg]);
+                break;
+
+            case F_TRAP:
+                if (!FAST_LOCAL(trap)(pmach, d->_operand))
+                {
+                    if (pmach->_devices != NULL)
+                        devices_flush(pmach->_devices);
+                    return;
+                }
+                break;
+
+            default: EXEC_FAULT(ERR_UNKNOWN, pmach->_pc);
+        }
+    }
+}
+
+#undef FAST_ENGINE
+#undef FAST_CLOSED_FORM
+#undef FAST_HOOK_BEFORE
+#undef FAST_HOOK_READ
+#undef FAST_HOOK_WRITE
+#undef FAST_HOOK_TRANSFER
+#undef FAST_GUARDED
+#undef FAST_ATOMIC
+#undef FAST_LOAD
+#undef FAST_STORE
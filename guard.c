@@ -0,0 +1,293 @@
+/*!
+ * \file guard.c
+ * \brief Contrôle des limites des segments par pages de garde.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "guard.h"
+#include "fast.h"
+#include "error.h"
+
+//! Machines protégées (lues par le gestionnaire de fautes)
+static Guard *volatile guards[GUARD_MAX];
+
+//! Verrou de la table des machines protégées
+static pthread_mutex_t guards_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//! Traitement d'origine de SIGSEGV
+static struct sigaction previous;
+
+//! Gestionnaire installé ?
+static bool installed;
+
+//! Point de reprise de l'exécution protégée en cours dans ce thread (ou NULL)
+static __thread sigjmp_buf *guard_env;
+
+//! Erreur relevée par le gestionnaire de fautes
+static __thread Error guard_err;
+
+//! Adresse de cette erreur
+static __thread unsigned guard_addr;
+
+//! Faute dans une zone gardée ?
+static inline bool guard_in(const char *fault, const char *base, size_t len)
+{
+    return fault >= base && fault < base + len;
+}
+
+//! Faute de dépilement d'une pile vide ?
+/*!
+ * POP et RET contrôlent SP avant de l'incrémenter : sur une pile vide, ils
+ * lisent le mot qui suit le segment. SP (de type Word, comme les données)
+ * est rangé en mémoire avant cette lecture et vaut alors \c _datasize.
+ *
+ * \param pmach la machine
+ * \param fault l'adresse fautive
+ */
+static bool guard_stack_fault(const Machine *pmach, const char *fault)
+{
+    if (pmach->_pc == 0 || pmach->_pc > pmach->_textsize)
+        return false; // hors exécution
+    Code_Op op = pmach->_text[pmach->_pc - 1].instr_generic._cop;
+    return (op == POP || op == RET) && pmach->_sp == pmach->_datasize
+        && fault == (const char *) (pmach->_data + pmach->_datasize);
+}
+
+//! Gestionnaire de SIGSEGV : traduction d'une faute en erreur du simulateur
+/*!
+ * Rien n'est affiché ici (stdio et exit() ne sont pas utilisables dans un
+ * gestionnaire de signal) : l'erreur est notée et l'exécution reprend dans
+ * guard_run(), qui la signale par error(). Une faute dans une zone gardée
+ * hors de guard_run() termine le simulateur par _exit().
+ */
+static void guard_handler(int sig, siginfo_t *info, void *context)
+{
+    (void) sig;
+    (void) context;
+    const char *fault = (const char *) info->si_addr;
+    for (unsigned i = 0; i < GUARD_MAX; ++i)
+    {
+        const Guard *pg = guards[i];
+        if (pg == NULL)
+            continue;
+        const Machine *pmach = pg->_pmach;
+        bool caught = true;
+        if (guard_in(fault, pg->_database, pg->_datalen))
+        {
+            guard_err = guard_stack_fault(pmach, fault) ? ERR_SEGSTACK : ERR_SEGDATA;
+            guard_addr = pmach->_pc;
+        }
+        else if (guard_in(fault, pg->_textbase, pg->_textlen))
+        {
+            guard_err = ERR_SEGTEXT;
+            guard_addr = (fault - (const char *) pmach->_text) / sizeof(Instruction);
+        }
+        else if (guard_in(fault, pg->_codebase, pg->_codelen))
+        {
+            guard_err = ERR_SEGTEXT;
+            guard_addr = (fault - (const char *) pmach->_fast->_code) / sizeof(Decoded);
+        }
+        else
+            caught = false;
+        if (caught)
+        {
+            if (guard_env != NULL)
+                siglongjmp(*guard_env, 1);
+            static const char msg[] = "guard: fault in a guarded zone outside the simulation\n";
+            write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            _exit(EXIT_FAILURE);
+        }
+    }
+
+    // faute étrangère aux zones gardées : traitement d'origine (l'instruction recommence)
+    sigaction(SIGSEGV, &previous, NULL);
+}
+
+//! Réservation d'une zone gardée
+/*!
+ * \param used taille utile (octets), placée juste avant la première page gardée
+ * \param eltsize taille d'un élément : tout indice de 32 bits reste dans la zone
+ * \param plen où ranger la taille de la zone
+ * \param pstart où ranger le début de la partie utile
+ * \return le début de la zone
+ */
+static char *guard_reserve(size_t used, size_t eltsize, size_t *plen, void *pstart)
+{
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t rounded = (used + pagesize - 1) / pagesize * pagesize;
+    size_t len = rounded + ((size_t) 1 << 32) * eltsize;
+
+    char *base = (char *) mmap(NULL, len, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        perror("guard_reserve.mmap");
+        exit(EXIT_FAILURE);
+    }
+    if (rounded > 0 && mprotect(base, rounded, PROT_READ|PROT_WRITE) == -1)
+    {
+        perror("guard_reserve.mprotect");
+        exit(EXIT_FAILURE);
+    }
+    *plen = len;
+    *(char **) pstart = base + rounded - used;
+    return base;
+}
+
+//! Placement des segments d'une machine dans des zones gardées
+/*!
+ * \param pmach la machine, chargée
+ */
+void guard_protect(Machine *pmach)
+{
+    Guard *pg = (Guard *) malloc(sizeof(Guard));
+    Fast_Text *pfast = (Fast_Text *) malloc(sizeof(Fast_Text));
+    if (pg == NULL || pfast == NULL)
+    {
+        perror("guard_protect.malloc");
+        exit(EXIT_FAILURE);
+    }
+    pg->_pmach = pmach;
+
+    // données
+    Word *data;
+    pg->_database = guard_reserve((size_t) pmach->_datasize * sizeof(Word), sizeof(Word),
+                                  &pg->_datalen, &data);
+    memcpy(data, pmach->_data, (size_t) pmach->_datasize * sizeof(Word));
+
+    // texte (en lecture seule)
+    Instruction *text;
+    size_t textlen = (size_t) pmach->_textsize * sizeof(Instruction);
+    pg->_textbase = guard_reserve(textlen, sizeof(Instruction), &pg->_textlen, &text);
+    memcpy(text, pmach->_text, textlen);
+    if (textlen > 0 && mprotect(pg->_textbase, (char *) text + textlen - pg->_textbase, PROT_READ) == -1)
+    {
+        perror("guard_protect.mprotect");
+        exit(EXIT_FAILURE);
+    }
+
+    // table prédécodée : pages déjà décodées reprises, les autres à la demande
+    pfast->_npages = (pmach->_textsize + FAST_PAGE_SIZE) >> FAST_PAGE_SHIFT;
+    pfast->_codelen = (size_t) pfast->_npages * FAST_PAGE_SIZE * sizeof(Decoded);
+    pfast->_textsize = pmach->_textsize;
+    pfast->_ndecoded = 0;
+    pfast->_mapped = true; // pas recyclée par fast_release()
+    pg->_codebase = guard_reserve(pfast->_codelen, sizeof(Decoded), &pg->_codelen, &pfast->_code);
+    if (pmach->_fast != NULL)
+    {
+        memcpy(pfast->_code, pmach->_fast->_code, pfast->_codelen);
+        pfast->_ndecoded = pmach->_fast->_ndecoded;
+    }
+
+    // abandon des originaux, mise en place des copies
+    unsigned textsize = pmach->_textsize, datasize = pmach->_datasize, dataend = pmach->_dataend;
+    machine_free(pmach);
+    pmach->_text = text;
+    pmach->_textsize = textsize;
+    pmach->_data = data;
+    pmach->_datasize = datasize;
+    pmach->_dataend = dataend;
+    pmach->_fast = pfast;
+    pmach->_guard = pg;
+
+    // enregistrement pour le gestionnaire de fautes
+    pthread_mutex_lock(&guards_lock);
+    if (!installed)
+    {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = guard_handler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGSEGV, &sa, &previous) == -1)
+        {
+            perror("guard_protect.sigaction");
+            exit(EXIT_FAILURE);
+        }
+        installed = true;
+    }
+    unsigned i = 0;
+    while (i < GUARD_MAX && guards[i] != NULL)
+        ++i;
+    if (i == GUARD_MAX)
+    {
+        fprintf(stderr, "guard_protect: more than %d guarded machines\n", GUARD_MAX);
+        exit(EXIT_FAILURE);
+    }
+    guards[i] = pg;
+    pthread_mutex_unlock(&guards_lock);
+}
+
+//! Libération des zones gardées d'une machine
+/*!
+ * \param pmach la machine
+ */
+void guard_release(Machine *pmach)
+{
+    Guard *pg = pmach->_guard;
+
+    pthread_mutex_lock(&guards_lock);
+    for (unsigned i = 0; i < GUARD_MAX; ++i)
+        if (guards[i] == pg)
+            guards[i] = NULL;
+    pthread_mutex_unlock(&guards_lock);
+
+    munmap(pg->_database, pg->_datalen);
+    munmap(pg->_textbase, pg->_textlen);
+    munmap(pg->_codebase, pg->_codelen);
+    free(pmach->_fast);
+    free(pg);
+    pmach->_fast = NULL;
+    pmach->_text = NULL;
+    pmach->_data = NULL;
+    pmach->_guard = NULL;
+}
+
+// Moteur rapide sans contrôle des accès ni des branchements
+#define FAST_ENGINE guard_engine
+#define FAST_GUARDED
+#include "fast_engine.h"
+
+//! Exécution d'une machine protégée, les fautes étant signalées par error()
+/*!
+ * \param pmach la machine
+ * \param fast moteur rapide (sinon interpréteur)
+ * \param debug mode de mise au point de l'interpréteur
+ */
+static void guard_run(Machine *pmach, bool fast, bool debug)
+{
+    sigjmp_buf env;
+    if (sigsetjmp(env, 1) != 0)
+    {
+        guard_env = NULL;
+        error(guard_err, guard_addr); // reprise après une faute (guard_handler())
+    }
+    guard_env = &env;
+    if (fast)
+        guard_engine(pmach);
+    else
+        simul(pmach, debug);
+    guard_env = NULL;
+}
+
+//! Simulation par le moteur rapide sans contrôle de limites
+void simul_guard(Machine *pmach)
+{
+    guard_run(pmach, true, false);
+}
+
+//! Simulation d'une machine protégée par l'interpréteur
+void guard_simul(Machine *pmach, bool debug)
+{
+    guard_run(pmach, false, debug);
+}
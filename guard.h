@@ -0,0 +1,93 @@
+#ifndef _GUARD_H_
+#define _GUARD_H_
+
+/*!
+ * \file guard.h
+ * \brief Contrôle des limites des segments par pages de garde.
+ *
+ * Le segment de données, le segment de texte et la table prédécodée du
+ * moteur rapide d'une machine sont recopiés chacun dans une zone réservée
+ * de l'espace d'adressage de l'hôte, assez grande pour que tout indice de
+ * 32 bits y tombe : le segment en occupe le début, aligné pour finir
+ * exactement sur une fin de page, et le reste de la zone est inaccessible
+ * (\c PROT_NONE, sans mémoire associée). La table prédécodée garde ses
+ * sentinelles (\c F_SEGTEXT) jusqu'à la fin de sa dernière page. Le texte
+ * n'est accessible qu'en lecture.
+ *
+ * Un accès hors limites provoque donc une faute (\c SIGSEGV) que le
+ * gestionnaire installé par guard_protect() traduit en erreur du
+ * simulateur, signalée par error() au retour dans simul_guard() ou
+ * guard_simul() :
+ *
+ *   - \c ERR_SEGDATA dans la zone des données, à l'adresse de l'instruction
+ *   en cours (\c _pc), ou \c ERR_SEGSTACK pour le dépilement (\c POP, \c
+ *   RET) d'une pile vide ;
+ *
+ *   - \c ERR_SEGTEXT dans la zone du texte ou de la table, à l'adresse
+ *   fautive du compteur ordinal.
+ *
+ * Une faute hors de ces zones garde son traitement d'origine.
+ *
+ * L'interpréteur (simul()) contrôle ainsi son compteur ordinal sans
+ * comparaison. Le moteur simul_guard() est le moteur rapide sans contrôle
+ * des lectures, écritures et branchements (voir \c FAST_GUARDED dans
+ * fast_engine.h) ; les contrôles de la pile restent, la pile étant
+ * contiguë aux données statiques.
+ */
+
+#include <stddef.h>
+
+#include "machine.h"
+
+//! Nombre maximal de machines protégées en même temps
+#define GUARD_MAX 64
+
+//! Zones gardées d'une machine
+typedef struct Guard
+{
+    Machine *_pmach;		//!< La machine
+    char *_database;		//!< Zone des données
+    size_t _datalen;		//!< Taille de cette zone (octets)
+    char *_textbase;		//!< Zone du texte
+    size_t _textlen;		//!< Taille de cette zone (octets)
+    char *_codebase;		//!< Zone de la table prédécodée
+    size_t _codelen;		//!< Taille de cette zone (octets)
+} Guard;
+
+//! Placement des segments d'une machine dans des zones gardées
+/*!
+ * Les segments (et la forme prédécodée éventuelle) sont recopiés puis les
+ * originaux libérés comme par machine_free(). La machine ne doit plus être
+ * déplacée en mémoire (le gestionnaire de fautes la désigne) ; elle est
+ * rendue à l'état ordinaire par machine_free().
+ *
+ * \param pmach la machine, chargée
+ */
+void guard_protect(Machine *pmach);
+
+//! Libération des zones gardées d'une machine (appelé par machine_free())
+/*!
+ * \param pmach la machine
+ */
+void guard_release(Machine *pmach);
+
+//! Simulation par le moteur rapide sans contrôle de limites
+/*!
+ * Même sémantique que simul_fast() pour une machine protégée par
+ * guard_protect() et sans périphérique.
+ *
+ * \param pmach la machine en cours d'exécution
+ */
+void simul_guard(Machine *pmach);
+
+//! Simulation d'une machine protégée par l'interpréteur
+/*!
+ * simul() sous le contrôle du gestionnaire de fautes : une faute dans une
+ * zone gardée est signalée par error() une fois sorti du gestionnaire.
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param debug mode de mise au point
+ */
+void guard_simul(Machine *pmach, bool debug);
+
+#endif
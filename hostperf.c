@@ -0,0 +1,313 @@
+/*!
+ * \file hostperf.c
+ * \brief Compteurs matériels de l'hôte pendant une simulation.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "hostperf.h"
+#include "instruction.h"
+
+//! Nombre de catégories d'échantillons : codes opération (6 bits), puis hors texte
+#define HOSTPERF_NOPS 65
+
+//! Signal de débordement des compteurs
+#define HOSTPERF_SIGNAL SIGIO
+
+//! Description d'un compteur
+typedef struct
+{
+    const char *_name;		//!< Nom affiché
+    uint32_t _type;		//!< Type (\c PERF_TYPE_...)
+    uint64_t _config;		//!< Compteur dans ce type
+    uint64_t _period;		//!< Période d'échantillonnage (événements)
+} Event_Desc;
+
+//! Compteurs, dans l'ordre de Hostperf_Event
+static const Event_Desc event_descs[HOSTPERF_NEVENTS] =
+{
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1000000 },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1000000 },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 10000 },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 10000 },
+    { "task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 1000000 },
+};
+
+//! État de la mesure (partagé avec le gestionnaire de signal)
+static struct
+{
+    const Machine *volatile _target; //!< Machine observée (NULL : pas d'échantillonnage)
+    int _fd[HOSTPERF_NEVENTS];	//!< Descripteurs des compteurs (-1 : indisponible)
+    int _errno[HOSTPERF_NEVENTS]; //!< Raison de l'indisponibilité
+    bool _open[HOSTPERF_NEVENTS]; //!< Compteur mesuré ?
+    bool _sampled[HOSTPERF_NEVENTS]; //!< Débordements signalés (sinon comptage seul) ?
+    uint64_t _value[HOSTPERF_NEVENTS]; //!< Totaux (extrapolés si multiplexés)
+    bool _scaled[HOSTPERF_NEVENTS]; //!< Total extrapolé ?
+    uint64_t _samples[HOSTPERF_NEVENTS][HOSTPERF_NOPS]; //!< Échantillons par code opération
+    struct sigaction _oldaction; //!< Gestionnaire de HOSTPERF_SIGNAL précédent
+} hp;
+
+//! Gestionnaire des débordements
+/*!
+ * Relève le code opération en cours, puis réarme le compteur pour un
+ * débordement : pas d'appel de bibliothèque, pas d'allocation.
+ */
+static void hostperf_handler(int sig, siginfo_t *info, void *context)
+{
+    (void) sig;
+    (void) context;
+    const Machine *pmach = hp._target;
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+        if (hp._fd[e] != -1 && hp._fd[e] == info->si_fd)
+        {
+            if (pmach != NULL)
+            {
+                unsigned pc = pmach->_pc;
+                unsigned op = pc > 0 && pc <= pmach->_textsize
+                    ? (unsigned) pmach->_text[pc - 1].instr_generic._cop : HOSTPERF_NOPS - 1;
+                __atomic_fetch_add(&hp._samples[e][op], 1, __ATOMIC_RELAXED);
+                ioctl(info->si_fd, PERF_EVENT_IOC_REFRESH, 1);
+            }
+            return;
+        }
+}
+
+//! Ouverture d'un compteur, avec signal de débordement si possible
+/*!
+ * Si le signal ne peut être mis en place, le compteur est rouvert sans
+ * période d'échantillonnage : il ne compte alors que le total (un compteur
+ * échantillonné sans signal s'arrêterait au premier débordement).
+ *
+ * \param e le compteur
+ * \param psampled où ranger vrai si les débordements sont signalés
+ * \return le descripteur, -1 si le compteur est indisponible (errno)
+ */
+static int hostperf_open(Hostperf_Event e, bool *psampled)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event_descs[e]._type;
+    attr.config = event_descs[e]._config;
+    attr.sample_period = event_descs[e]._period;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.wakeup_events = 1;
+
+    // thread appelant, sur n'importe quel processeur
+    *psampled = false;
+    int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    // débordements signalés à ce thread
+    struct f_owner_ex owner = { F_OWNER_TID, (pid_t) syscall(SYS_gettid) };
+    if (fcntl(fd, F_SETFL, O_ASYNC | O_NONBLOCK) != -1
+        && fcntl(fd, F_SETSIG, HOSTPERF_SIGNAL) != -1
+        && fcntl(fd, F_SETOWN_EX, &owner) != -1)
+    {
+        *psampled = true;
+        return fd;
+    }
+
+    // sinon, comptage seul
+    close(fd);
+    attr.sample_period = 0;
+    attr.wakeup_events = 0;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+//! Début de la mesure
+/*!
+ * \param pmach la machine observée
+ */
+void hostperf_start(const Machine *pmach)
+{
+    memset(hp._samples, 0, sizeof(hp._samples));
+    hp._target = pmach;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = hostperf_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(HOSTPERF_SIGNAL, &action, &hp._oldaction) == -1)
+    {
+        perror("hostperf_start.sigaction");
+        exit(EXIT_FAILURE);
+    }
+
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+    {
+        hp._value[e] = 0;
+        hp._scaled[e] = false;
+        hp._fd[e] = hostperf_open(e, &hp._sampled[e]);
+        hp._errno[e] = hp._fd[e] == -1 ? errno : 0;
+        hp._open[e] = hp._fd[e] != -1;
+    }
+
+    // départ aussi simultané que possible (compteur échantillonné armé pour un débordement)
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+        if (hp._fd[e] != -1)
+        {
+            if (hp._sampled[e])
+                ioctl(hp._fd[e], PERF_EVENT_IOC_REFRESH, 1);
+            else
+                ioctl(hp._fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+//! Fin de la mesure
+void hostperf_stop(void)
+{
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+        if (hp._fd[e] != -1)
+            ioctl(hp._fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    hp._target = NULL;
+
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+    {
+        if (hp._fd[e] == -1)
+            continue;
+
+        // valeur, temps d'activation, temps de comptage
+        uint64_t values[3];
+        if (read(hp._fd[e], values, sizeof(values)) == sizeof(values))
+        {
+            hp._value[e] = values[0];
+            if (values[2] > 0 && values[2] < values[1])
+            {
+                hp._value[e] = (uint64_t) ((double) values[0] * values[1] / values[2]);
+                hp._scaled[e] = true;
+            }
+        }
+        else
+        {
+            hp._errno[e] = errno;
+            hp._open[e] = false;
+        }
+        close(hp._fd[e]);
+        hp._fd[e] = -1;
+    }
+    sigaction(HOSTPERF_SIGNAL, &hp._oldaction, NULL);
+}
+
+//! Nombre d'échantillons d'un compteur
+static uint64_t hostperf_nsamples(Hostperf_Event e)
+{
+    uint64_t n = 0;
+    for (unsigned op = 0; op < HOSTPERF_NOPS; ++op)
+        n += hp._samples[e][op];
+    return n;
+}
+
+//! Affichage des mesures
+/*!
+ * \param out le flot de sortie
+ * \param pmach la machine observée
+ */
+void hostperf_report(FILE *out, const Machine *pmach)
+{
+    uint64_t icount = pmach->_icount;
+    uint64_t nsamples[HOSTPERF_NEVENTS];
+    bool any = false;
+
+    fprintf(out, "\n*** HOST COUNTERS ***\n");
+    fprintf(out, "%llu simulated instructions\n\n", (unsigned long long) icount);
+    fprintf(out, "%-14s %16s %12s %9s\n", "event", "total", "per instr", "samples");
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+    {
+        nsamples[e] = hostperf_nsamples(e);
+        if (!hp._open[e])
+        {
+            fprintf(out, "%-14s unavailable (%s)\n", event_descs[e]._name, strerror(hp._errno[e]));
+            continue;
+        }
+        any = true;
+        fprintf(out, "%-14s %16llu %12.3f %9llu%s\n", event_descs[e]._name,
+                (unsigned long long) hp._value[e],
+                icount > 0 ? (double) hp._value[e] / icount : 0.0,
+                (unsigned long long) nsamples[e], hp._scaled[e] ? "  (multiplexed, scaled)" : "");
+    }
+    if (!any)
+    {
+        fprintf(out, "no host counter available (see /proc/sys/kernel/perf_event_paranoid)\n\n");
+        return;
+    }
+
+    bool ipc = hp._open[HOSTPERF_CYCLES] && hp._open[HOSTPERF_INSTRUCTIONS]
+        && hp._value[HOSTPERF_CYCLES] > 0;
+    if (ipc)
+        fprintf(out, "host IPC %.3f\n", (double) hp._value[HOSTPERF_INSTRUCTIONS] / hp._value[HOSTPERF_CYCLES]);
+
+    // compteur de référence pour l'ordre des lignes : le premier échantillonné
+    int ref = -1;
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS && ref < 0; ++e)
+        if (nsamples[e] > 0)
+            ref = e;
+    if (ref < 0)
+    {
+        putc('\n', out);
+        return;
+    }
+    ipc = ipc && nsamples[HOSTPERF_CYCLES] > 0 && nsamples[HOSTPERF_INSTRUCTIONS] > 0;
+
+    // codes opération par part décroissante du compteur de référence
+    unsigned order[HOSTPERF_NOPS];
+    for (unsigned op = 0; op < HOSTPERF_NOPS; ++op)
+        order[op] = op;
+    for (unsigned i = 1; i < HOSTPERF_NOPS; ++i)
+        for (unsigned j = i; j > 0 && hp._samples[ref][order[j]] > hp._samples[ref][order[j - 1]]; --j)
+        {
+            unsigned t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+
+    fprintf(out, "\nShare of samples by opcode:\n%-14s", "opcode");
+    for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+        if (nsamples[e] > 0)
+            fprintf(out, " %14s", event_descs[e]._name);
+    if (ipc)
+        fprintf(out, " %8s", "IPC");
+    putc('\n', out);
+    for (unsigned i = 0; i < HOSTPERF_NOPS; ++i)
+    {
+        unsigned op = order[i];
+        bool seen = false;
+        for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+            seen = seen || hp._samples[e][op] > 0;
+        if (!seen)
+            continue;
+
+        if (op == HOSTPERF_NOPS - 1)
+            fprintf(out, "%-14s", "(out of text)");
+        else if (op <= LAST_COP)
+            fprintf(out, "%-14s", cop_names[op]);
+        else
+            fprintf(out, "op %-11u", op);
+        for (unsigned e = 0; e < HOSTPERF_NEVENTS; ++e)
+            if (nsamples[e] > 0)
+                fprintf(out, " %13.2f%%", 100.0 * hp._samples[e][op] / nsamples[e]);
+        if (ipc && hp._samples[HOSTPERF_CYCLES][op] > 0)
+            fprintf(out, " %8.3f",
+                    (double) hp._samples[HOSTPERF_INSTRUCTIONS][op] * event_descs[HOSTPERF_INSTRUCTIONS]._period
+                    / ((double) hp._samples[HOSTPERF_CYCLES][op] * event_descs[HOSTPERF_CYCLES]._period));
+        putc('\n', out);
+    }
+    putc('\n', out);
+}
@@ -0,0 +1,87 @@
+#ifndef _HOSTPERF_H_
+#define _HOSTPERF_H_
+
+/*!
+ * \file hostperf.h
+ * \brief Compteurs matériels de l'hôte pendant une simulation.
+ *
+ * Pour comparer des moteurs (ou des versions d'un moteur), il faut savoir
+ * pourquoi l'un est plus rapide : IPC, branchements mal prédits dans la
+ * répartition des instructions, défauts de cache... Les compteurs de
+ * performance de l'hôte (\c perf_event_open de Linux, en mode utilisateur et
+ * pour le seul thread appelant) sont lus autour de l'exécution :
+ *
+ *   - cycles, instructions, branchements mal prédits, défauts de cache ;
+ *
+ *   - temps processeur (\c task-clock, compteur logiciel du noyau).
+ *
+ * Les totaux sont ramenés à l'instruction simulée (\c _icount). Chaque
+ * compteur est de plus échantillonné : tous les \c _period événements, le
+ * noyau envoie un signal dont le gestionnaire relève le code opération de
+ * l'instruction simulée en cours (comme profile.h, d'après le compteur
+ * ordinal rangé en mémoire). La part des échantillons de chaque code
+ * opération estime sa part de l'événement ; l'IPC de l'hôte par code
+ * opération s'en déduit quand cycles et instructions sont disponibles.
+ *
+ * Dans un conteneur ou une machine virtuelle, les compteurs matériels sont
+ * souvent absents, ou interdits par \c /proc/sys/kernel/perf_event_paranoid :
+ * chaque compteur est ouvert séparément, ceux qui manquent sont signalés
+ * (avec la raison) et les autres utilisés. Le temps processeur reste
+ * d'ordinaire disponible et donne au moins la répartition du temps par code
+ * opération. Sans aucun compteur, la simulation se déroule normalement.
+ *
+ * \note Les compteurs matériels sont multiplexés par le noyau quand ils sont
+ * plus nombreux que les registres de l'hôte ; les totaux sont alors
+ * extrapolés (temps d'activation sur temps de comptage).
+ *
+ * \attention Une seule machine est observée à la fois, par le thread qui
+ * appelle hostperf_start() (les signaux lui sont adressés) : pas de
+ * mesure en multiprocesseur.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+//! Compteurs de l'hôte
+typedef enum
+{
+    HOSTPERF_CYCLES = 0,	//!< Cycles
+    HOSTPERF_INSTRUCTIONS,	//!< Instructions exécutées
+    HOSTPERF_BRANCH_MISSES,	//!< Branchements mal prédits
+    HOSTPERF_CACHE_MISSES,	//!< Défauts de cache (dernier niveau)
+    HOSTPERF_TASK_CLOCK,	//!< Temps processeur (nanosecondes)
+    HOSTPERF_NEVENTS		//!< Nombre de compteurs
+} Hostperf_Event;
+
+//! Début de la mesure
+/*!
+ * Les compteurs disponibles sont ouverts, le gestionnaire de signal est
+ * installé et le comptage commence.
+ *
+ * \param pmach la machine observée (elle doit le rester jusqu'à
+ * hostperf_stop())
+ */
+void hostperf_start(const Machine *pmach);
+
+//! Fin de la mesure
+/*!
+ * Les compteurs sont arrêtés et lus, puis fermés ; le gestionnaire de
+ * signal précédent est rétabli. Les résultats sont gardés pour
+ * hostperf_report().
+ */
+void hostperf_stop(void);
+
+//! Affichage des mesures
+/*!
+ * Totaux de chaque compteur (ou raison de son absence) et valeur par
+ * instruction simulée, IPC de l'hôte, puis, pour chaque code opération
+ * échantillonné, sa part de chaque compteur.
+ *
+ * \param out le flot de sortie
+ * \param pmach la machine observée
+ */
+void hostperf_report(FILE *out, const Machine *pmach);
+
+#endif
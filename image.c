@@ -0,0 +1,668 @@
+/*!
+ * \file image.c
+ * \brief Format d'image binaire versionné, portable et projetable.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "image.h"
+
+//! Ordre des octets de l'hôte
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_ENDIAN IMAGE_BIG
+#else
+#define HOST_ENDIAN IMAGE_LITTLE
+#endif
+
+//! L'hôte utilise-t-il le codage canonique des instructions ?
+/*!
+ * Les champs de bits sont alloués à partir des poids faibles sur une machine
+ * petit-boutiste, des poids forts sur une machine gros-boutiste.
+ */
+static const bool host_canonical = HOST_ENDIAN == IMAGE_LITTLE;
+
+//! État d'un calcul de somme de contrôle (Fletcher 64 bits)
+typedef struct
+{
+    uint64_t _a;		//!< Somme des mots
+    uint64_t _b;		//!< Somme des sommes partielles
+} Fletcher;
+
+//! Ajout d'une suite de mots à une somme de contrôle
+/*!
+ * Les deux sommes sont calculées modulo 2^32 - 1 ; la réduction n'est faite
+ * que tous les \c CHUNK mots (les accumulateurs de 64 bits ne peuvent pas
+ * déborder avant). Le résultat ne dépend pas du découpage de la suite en
+ * plusieurs appels.
+ */
+static void fletcher_update(Fletcher *pf, const uint32_t *words, size_t n)
+{
+    enum { CHUNK = 65536 };
+    uint64_t a = pf->_a, b = pf->_b;
+
+    while (n > 0)
+    {
+        size_t chunk = n < CHUNK ? n : CHUNK;
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            a += words[i];
+            b += a;
+        }
+        a %= 0xffffffffu;
+        b %= 0xffffffffu;
+        words += chunk;
+        n -= chunk;
+    }
+    pf->_a = a;
+    pf->_b = b;
+}
+
+//! Valeur d'une somme de contrôle
+static uint64_t fletcher_sum(const Fletcher *pf)
+{
+    return pf->_b << 32 | pf->_a;
+}
+
+//! Somme de contrôle d'une suite de mots (Fletcher 64 bits)
+uint64_t image_checksum(const uint32_t *words, size_t n)
+{
+    Fletcher f = { 0, 0 };
+    fletcher_update(&f, words, n);
+    return fletcher_sum(&f);
+}
+
+//! Retournement de l'ordre des octets d'une suite de mots
+void image_swap_words(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__GNUC__)
+    // 4 mots à la fois : une seule permutation d'octets (pshufb, tbl...)
+    typedef uint8_t Bytes16 __attribute__((vector_size(16)));
+    for (; i + 4 <= n; i += 4)
+    {
+        Bytes16 v;
+        memcpy(&v, src + i, sizeof(v));
+#if defined(__clang__)
+        v = __builtin_shufflevector(v, v, 3, 2, 1, 0, 7, 6, 5, 4,
+                                    11, 10, 9, 8, 15, 14, 13, 12);
+#else
+        const Bytes16 mask = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+        v = __builtin_shuffle(v, mask);
+#endif
+        memcpy(dst + i, &v, sizeof(v));
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        uint32_t w = src[i];
+        dst[i] = w >> 24 | (w >> 8 & 0xff00) | (w << 8 & 0xff0000) | w << 24;
+    }
+}
+
+//! Retournement d'un entier de 64 bits
+static uint64_t swap64(uint64_t x)
+{
+    uint32_t half[2] = { (uint32_t) (x >> 32), (uint32_t) x };
+    image_swap_words(half, half, 2);
+    return (uint64_t) half[1] << 32 | half[0];
+}
+
+//! Retournement des champs d'un en-tête
+static void swap_header(Image_Header *phdr)
+{
+    image_swap_words(&phdr->_magic, &phdr->_magic, 1);
+    phdr->_version = (uint16_t) (phdr->_version >> 8 | phdr->_version << 8);
+    image_swap_words(&phdr->_nsections, &phdr->_nsections, 6); // _nsections.._flags
+    phdr->_checksum = swap64(phdr->_checksum);
+}
+
+//! Retournement des champs d'une entrée de la table de sections
+static void swap_section(Image_Section *psect)
+{
+    image_swap_words(&psect->_type, &psect->_type, 2);
+    psect->_offset = swap64(psect->_offset);
+    psect->_size = swap64(psect->_size);
+    psect->_checksum = swap64(psect->_checksum);
+}
+
+//! Ajout des champs d'un en-tête à une somme de contrôle
+/*!
+ * La somme porte sur la valeur des champs (hors \c _checksum),
+ * indépendamment de l'ordre des octets et de la disposition en mémoire des
+ * structures.
+ */
+static void header_words(Fletcher *pf, const Image_Header *phdr)
+{
+    uint32_t words[8] = {
+        phdr->_magic,
+        phdr->_version | (uint32_t) phdr->_endian << 16 | (uint32_t) phdr->_reserved << 24,
+        phdr->_nsections, phdr->_textsize, phdr->_datasize, phdr->_dataend,
+        phdr->_align, phdr->_flags
+    };
+    fletcher_update(pf, words, 8);
+}
+
+//! Ajout des champs d'une entrée de la table de sections à une somme de contrôle
+static void section_words(Fletcher *pf, const Image_Section *psect)
+{
+    uint32_t words[8] = {
+        psect->_type, psect->_flags,
+        (uint32_t) psect->_offset, (uint32_t) (psect->_offset >> 32),
+        (uint32_t) psect->_size, (uint32_t) (psect->_size >> 32),
+        (uint32_t) psect->_checksum, (uint32_t) (psect->_checksum >> 32)
+    };
+    fletcher_update(pf, words, 8);
+}
+
+//! Somme de contrôle de l'en-tête et de la table de sections
+static uint64_t header_checksum(const Image_Header *phdr, const Image_Section sects[])
+{
+    Fletcher f = { 0, 0 };
+
+    header_words(&f, phdr);
+    for (unsigned i = 0; i < phdr->_nsections; ++i)
+        section_words(&f, &sects[i]);
+    return fletcher_sum(&f);
+}
+
+//! Lecture d'une entrée de la table de sections, dans l'ordre de l'hôte
+static Image_Section read_section(const Image *pimg, const void *map, unsigned i)
+{
+    Image_Section sect;
+
+    memcpy(&sect, (const char *) map + sizeof(Image_Header) + i * sizeof(Image_Section),
+           sizeof(sect));
+    if (pimg->_swap)
+        swap_section(&sect);
+    return sect;
+}
+
+//! Reconnaissance d'une image
+bool image_probe(const void *start, size_t len)
+{
+    uint32_t magic;
+
+    if (len < sizeof(magic))
+        return false;
+    memcpy(&magic, start, sizeof(magic));
+    return magic == IMAGE_MAGIC || magic == (IMAGE_MAGIC >> 24 | (IMAGE_MAGIC >> 8 & 0xff00)
+                                              | (IMAGE_MAGIC << 8 & 0xff0000) | IMAGE_MAGIC << 24);
+}
+
+//! Analyse et vérification de l'en-tête et de la table de sections
+/*!
+ * \param pimg la description à remplir (\c _textsum et \c _datasum compris)
+ * \param map la projection du fichier
+ * \param len sa taille
+ * \param psects où ranger une copie de la table de sections (allouée, dans
+ * l'ordre de l'hôte) ; peut être NULL, la table est alors lue en place
+ * \return NULL si l'image est valide, sinon la description de l'erreur
+ */
+static const char *image_parse(Image *pimg, const void *map, size_t len, Image_Section **psects)
+{
+    Image_Header *phdr = &pimg->_header;
+
+    if (psects != NULL)
+        *psects = NULL;
+    if (len < sizeof(Image_Header) || !image_probe(map, len))
+        return "not an image";
+
+    memcpy(phdr, map, sizeof(Image_Header));
+    pimg->_swap = phdr->_magic != IMAGE_MAGIC;
+    if (pimg->_swap)
+        swap_header(phdr);
+
+    if (phdr->_version < 1 || phdr->_version > IMAGE_VERSION)
+        return "unsupported image version";
+    if (phdr->_endian != (pimg->_swap ? (HOST_ENDIAN ^ 3) : HOST_ENDIAN))
+        return "inconsistent byte order";
+    if (phdr->_align < sizeof(uint32_t) || (phdr->_align & (phdr->_align - 1)) != 0)
+        return "bad section alignment";
+    if (phdr->_dataend > phdr->_datasize)
+        return "bad data size";
+    if ((len - sizeof(Image_Header)) / sizeof(Image_Section) < phdr->_nsections)
+        return "truncated section table";
+
+    // somme de l'en-tête et de la table, lue en place dans la projection
+    const char *err = NULL;
+    Fletcher f = { 0, 0 };
+    header_words(&f, phdr);
+    for (unsigned i = 0; i < phdr->_nsections; ++i)
+    {
+        Image_Section sect = read_section(pimg, map, i);
+        section_words(&f, &sect);
+    }
+    if (fletcher_sum(&f) != phdr->_checksum)
+        err = "bad header checksum";
+
+    // sections connues
+    pimg->_text = pimg->_data = NULL;
+    for (unsigned i = 0; err == NULL && i < phdr->_nsections; ++i)
+    {
+        Image_Section sect = read_section(pimg, map, i);
+        const Image_Section *psect = &sect;
+        if (psect->_offset % phdr->_align != 0 || psect->_size % sizeof(uint32_t) != 0
+            || psect->_offset > len || psect->_size > len - psect->_offset)
+            err = "bad section bounds";
+        else if (psect->_type == SECT_TEXT && pimg->_text == NULL)
+        {
+            if (psect->_size != (uint64_t) phdr->_textsize * sizeof(uint32_t))
+                err = "bad text section size";
+            pimg->_text = (const uint32_t *) ((const char *) map + psect->_offset);
+            pimg->_textsum = psect->_checksum;
+        }
+        else if (psect->_type == SECT_DATA_EXTENTS && phdr->_version < 2)
+            err = "data extents in a version 1 image";
+        else if ((psect->_type == SECT_DATA || psect->_type == SECT_DATA_EXTENTS)
+                 && pimg->_data == NULL)
+        {
+            if (psect->_type == SECT_DATA
+                && psect->_size != (uint64_t) phdr->_datasize * sizeof(uint32_t))
+                err = "bad data section size";
+            pimg->_data = (const uint32_t *) ((const char *) map + psect->_offset);
+            pimg->_datalen = psect->_size / sizeof(uint32_t);
+            pimg->_datatype = psect->_type;
+            pimg->_datasum = psect->_checksum;
+        }
+    }
+    if (err == NULL && (pimg->_text == NULL || pimg->_data == NULL))
+        err = "missing text or data section";
+
+    if (psects != NULL)
+    {
+        size_t tablelen = phdr->_nsections * sizeof(Image_Section);
+        *psects = (Image_Section *) malloc(tablelen > 0 ? tablelen : 1);
+        if (*psects == NULL)
+        {
+            perror("image_parse.malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (unsigned i = 0; i < phdr->_nsections; ++i)
+            (*psects)[i] = read_section(pimg, map, i);
+    }
+    return err;
+}
+
+//! Ouverture d'une image projetée en mémoire
+void image_open(Image *pimg, const void *map, size_t len, const char *programfile)
+{
+    const char *err = image_parse(pimg, map, len, NULL);
+    if (err != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", programfile, err);
+        exit(EXIT_FAILURE);
+    }
+}
+
+//! Le texte de l'image est-il utilisable sans copie ?
+bool image_text_shareable(const Image *pimg)
+{
+    return !pimg->_swap && host_canonical;
+}
+
+//! Vérification de la somme de contrôle du texte (erreur fatale)
+/*!
+ * \param words le texte, dans l'ordre des octets de l'hôte
+ * \param n son nombre de mots
+ * \param pimg l'image
+ * \param programfile le nom du fichier (messages d'erreur)
+ */
+static void check_text(const uint32_t *words, size_t n, const Image *pimg, const char *programfile)
+{
+    if (image_checksum(words, n) != pimg->_textsum)
+    {
+        fprintf(stderr, "%s: bad text checksum\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+}
+
+//! Vérification du texte utilisé en place dans la projection
+void image_verify_text(const Image *pimg, const char *programfile)
+{
+    check_text(pimg->_text, pimg->_header._textsize, pimg, programfile);
+}
+
+//! Conversion d'une instruction du codage canonique vers celui de l'hôte
+static Instruction instr_from_canonical(uint32_t w)
+{
+    Instruction instr;
+    Code_Op cop = w & 0x3f;
+    bool immediate = w >> 6 & 1, indexed = w >> 7 & 1;
+
+    instr._raw = 0;
+    instr.instr_generic._cop = cop;
+    instr.instr_generic._immediate = immediate;
+    instr.instr_generic._indexed = indexed;
+    instr.instr_generic._regcond = w >> 8 & 0xf;
+    if (cop == MOVE || cop == FILL)
+    {
+        instr.instr_block._rdest = w >> 12 & 0xf;
+        instr.instr_block._rsrc = w >> 16 & 0xf;
+        instr.instr_block._pad = w >> 20;
+    }
+    else if (indexed && !immediate)
+    {
+        instr.instr_indexed._rindex = w >> 12 & 0xf;
+        instr.instr_indexed._offset = (int16_t) (w >> 16);
+    }
+    else
+        instr.instr_absolute._address = w >> 12;
+    return instr;
+}
+
+//! Conversion d'une instruction du codage de l'hôte vers le codage canonique
+static uint32_t instr_to_canonical(Instruction instr)
+{
+    Code_Op cop = instr.instr_generic._cop;
+    bool immediate = instr.instr_generic._immediate, indexed = instr.instr_generic._indexed;
+    uint32_t w = (cop & 0x3f) | (uint32_t) immediate << 6 | (uint32_t) indexed << 7
+        | (uint32_t) instr.instr_generic._regcond << 8;
+
+    if (cop == MOVE || cop == FILL)
+        w |= (uint32_t) instr.instr_block._rdest << 12 | (uint32_t) instr.instr_block._rsrc << 16
+            | (uint32_t) instr.instr_block._pad << 20;
+    else if (indexed && !immediate)
+        w |= (uint32_t) instr.instr_indexed._rindex << 12
+            | (uint32_t) (uint16_t) instr.instr_indexed._offset << 16;
+    else
+        w |= (uint32_t) instr.instr_absolute._address << 12;
+    return w;
+}
+
+//! Copie du segment de texte d'une image
+void image_copy_text(const Image *pimg, Instruction *text, const char *programfile)
+{
+    uint32_t *words = (uint32_t *) text;
+    size_t n = pimg->_header._textsize;
+
+    if (pimg->_swap)
+        image_swap_words(words, pimg->_text, n);
+    else
+        memcpy(words, pimg->_text, n * sizeof(uint32_t));
+
+    check_text(words, n, pimg, programfile);
+
+    if (!host_canonical)
+        for (size_t i = 0; i < n; ++i)
+            text[i] = instr_from_canonical(words[i]);
+}
+
+//! Copie de mots de l'image, retournés si nécessaire
+static void copy_words(const Image *pimg, uint32_t *dst, const uint32_t *src, size_t n)
+{
+    if (pimg->_swap)
+        image_swap_words(dst, src, n);
+    else
+        memcpy(dst, src, n * sizeof(uint32_t));
+}
+
+//! Chargement du segment de données d'une image
+void image_load_data(const Image *pimg, Word *data, const char *programfile)
+{
+    size_t datasize = pimg->_header._datasize;
+    Fletcher f = { 0, 0 };
+
+    if (pimg->_datatype == SECT_DATA)
+    {
+        copy_words(pimg, data, pimg->_data, datasize);
+        fletcher_update(&f, data, datasize);
+    }
+    else
+    {
+        // extensions : (début, nombre) puis le contenu, écrit en place ; les
+        // intervalles entre extensions sont remis à zéro au passage
+        const uint32_t *p = pimg->_data, *end = p + pimg->_datalen;
+        size_t next = 0;
+        while (p < end)
+        {
+            uint32_t ext[2];
+            if (end - p < 2)
+                break;
+            copy_words(pimg, ext, p, 2);
+            p += 2;
+            if (ext[0] < next || ext[0] > datasize || ext[1] > datasize - ext[0]
+                || ext[1] > end - p)
+                break;
+            memset(data + next, 0, (ext[0] - next) * sizeof(Word));
+            copy_words(pimg, data + ext[0], p, ext[1]);
+            fletcher_update(&f, ext, 2);
+            fletcher_update(&f, data + ext[0], ext[1]);
+            p += ext[1];
+            next = ext[0] + ext[1];
+        }
+        if (p != end)
+        {
+            fprintf(stderr, "%s: bad data extents\n", programfile);
+            exit(EXIT_FAILURE);
+        }
+        memset(data + next, 0, (datasize - next) * sizeof(Word));
+    }
+
+    if (fletcher_sum(&f) != pimg->_datasum)
+    {
+        fprintf(stderr, "%s: bad data checksum\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+}
+
+//! Codage d'un segment de données par extensions non nulles
+/*!
+ * Une extension commence et finit par un mot non nul et ne contient pas plus
+ * de \c IMAGE_EXTENT_GAP mots nuls consécutifs.
+ *
+ * \param data le segment
+ * \param n sa taille
+ * \param out où ranger le codage (NULL pour en calculer seulement la taille)
+ * \return la taille du codage (en mots)
+ */
+static size_t encode_extents(const Word *data, size_t n, uint32_t *out)
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < n; )
+    {
+        if (data[i] == 0)
+        {
+            ++i;
+            continue;
+        }
+
+        // fin de l'extension : dernier mot non nul suivi de plus de
+        // IMAGE_EXTENT_GAP zéros (ou de la fin du segment)
+        size_t start = i, stop = i + 1;
+        for (i = stop; i < n && i - stop < IMAGE_EXTENT_GAP + 1; ++i)
+            if (data[i] != 0)
+                stop = i + 1;
+        i = stop;
+
+        if (out != NULL)
+        {
+            out[len] = start;
+            out[len + 1] = stop - start;
+            memcpy(out + len + 2, data + start, (stop - start) * sizeof(Word));
+        }
+        len += 2 + stop - start;
+    }
+    return len;
+}
+
+//! Arrondi d'une position au multiple supérieur de l'alignement
+static uint64_t align_up(uint64_t offset)
+{
+    return (offset + IMAGE_ALIGN - 1) & ~(uint64_t) (IMAGE_ALIGN - 1);
+}
+
+//! Écriture d'un bloc à une position donnée du fichier
+static void write_at(int fd, const void *buf, size_t n, uint64_t offset, const char *programfile)
+{
+    const char *p = (const char *) buf;
+
+    while (n > 0)
+    {
+        ssize_t nwritten = pwrite(fd, p, n, (off_t) offset);
+        if (nwritten <= 0)
+        {
+            fprintf(stderr, "could not write image in %s\n", programfile);
+            exit(EXIT_FAILURE);
+        }
+        p += nwritten;
+        offset += nwritten;
+        n -= nwritten;
+    }
+}
+
+//! Écriture d'une machine sous forme d'image
+/*!
+ * Les intervalles entre les sections ne sont pas écrits (trous du fichier).
+ */
+void image_write(Machine *pmach, const char *programfile, bool foreign)
+{
+    size_t textsize = pmach->_textsize, datasize = pmach->_datasize;
+
+    // texte dans le codage canonique
+    uint32_t *text = (uint32_t *) malloc(textsize * sizeof(uint32_t));
+    if (text == NULL && textsize > 0)
+    {
+        perror("image_write.malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < textsize; ++i)
+        text[i] = host_canonical ? pmach->_text[i]._raw : instr_to_canonical(pmach->_text[i]);
+
+    // données telles quelles ou par extensions si c'est plus court
+    size_t datalen = encode_extents(pmach->_data, datasize, NULL);
+    bool sparse = datalen < datasize;
+    uint32_t *data = pmach->_data;
+    if (!sparse)
+        datalen = datasize; // jamais au delà du segment
+    if (sparse || foreign)
+    {
+        data = (uint32_t *) malloc(datalen * sizeof(uint32_t));
+        if (data == NULL && datalen > 0)
+        {
+            perror("image_write.malloc");
+            exit(EXIT_FAILURE);
+        }
+        if (sparse)
+            encode_extents(pmach->_data, datasize, data);
+        else
+            memcpy(data, pmach->_data, datasize * sizeof(uint32_t));
+    }
+
+    Image_Header hdr = {
+        IMAGE_MAGIC, sparse ? 2 : 1, foreign ? HOST_ENDIAN ^ 3 : HOST_ENDIAN, 0, 2,
+        pmach->_textsize, pmach->_datasize, pmach->_dataend, IMAGE_ALIGN, 0, 0
+    };
+    Image_Section sects[2];
+    uint64_t textoffset = align_up(sizeof(hdr) + sizeof(sects));
+    sects[0] = (Image_Section) { SECT_TEXT, 0, textoffset, textsize * sizeof(uint32_t),
+                                 image_checksum(text, textsize) };
+    uint64_t dataoffset = align_up(textoffset + sects[0]._size);
+    sects[1] = (Image_Section) { sparse ? SECT_DATA_EXTENTS : SECT_DATA, 0, dataoffset,
+                                 datalen * sizeof(uint32_t), image_checksum(data, datalen) };
+    hdr._checksum = header_checksum(&hdr, sects);
+
+    if (foreign)
+    {
+        swap_header(&hdr);
+        swap_section(&sects[0]);
+        swap_section(&sects[1]);
+        image_swap_words(text, text, textsize);
+        image_swap_words(data, data, datalen);
+    }
+
+    int fd = open(programfile, O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IRGRP|S_IROTH|S_IWUSR);
+    if (fd == -1)
+    {
+        perror("image_write.open");
+        exit(EXIT_FAILURE);
+    }
+    write_at(fd, &hdr, sizeof(hdr), 0, programfile);
+    write_at(fd, sects, sizeof(sects), sizeof(hdr), programfile);
+    write_at(fd, text, textsize * sizeof(uint32_t), textoffset, programfile);
+    write_at(fd, data, datalen * sizeof(uint32_t), dataoffset, programfile);
+    if (ftruncate(fd, (off_t) (dataoffset + datalen * sizeof(uint32_t))) == -1)
+    {
+        perror("image_write.ftruncate");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    free(text);
+    if (data != pmach->_data)
+        free(data);
+}
+
+//! Nom d'un type de section
+static const char *section_name(uint32_t type)
+{
+    switch (type)
+    {
+        case SECT_TEXT: return "text";
+        case SECT_DATA: return "data";
+        case SECT_DATA_EXTENTS: return "data (extents)";
+        default: return "?";
+    }
+}
+
+//! Affichage de l'en-tête et de la table de sections d'une image
+bool image_info(FILE *out, const void *map, size_t len)
+{
+    Image img;
+    Image_Section *sects;
+    const char *err = image_parse(&img, map, len, &sects);
+
+    if (sects != NULL)
+    {
+        const Image_Header *phdr = &img._header;
+        fprintf(out, "version %u, %s-endian%s, textsize %u, datasize %u, dataend %u\n",
+                phdr->_version, phdr->_endian == IMAGE_LITTLE ? "little" : "big",
+                img._swap ? " (foreign)" : "", phdr->_textsize, phdr->_datasize, phdr->_dataend);
+
+        for (unsigned i = 0; i < phdr->_nsections; ++i)
+        {
+            const Image_Section *psect = &sects[i];
+            bool ok = true;
+
+            // somme du contenu (si la section est dans le fichier)
+            if (psect->_offset <= len && psect->_size <= len - psect->_offset)
+            {
+                size_t n = psect->_size / sizeof(uint32_t);
+                uint32_t *words = (uint32_t *) malloc(n * sizeof(uint32_t));
+                if (words == NULL && n > 0)
+                {
+                    perror("image_info.malloc");
+                    exit(EXIT_FAILURE);
+                }
+                memcpy(words, (const char *) map + psect->_offset, n * sizeof(uint32_t));
+                if (img._swap)
+                    image_swap_words(words, words, n);
+                ok = image_checksum(words, n) == psect->_checksum;
+                free(words);
+            }
+            else
+                ok = false;
+
+            fprintf(out, "  %-14s offset %8" PRIu64 " size %8" PRIu64 " checksum %016" PRIx64 " %s\n",
+                    section_name(psect->_type), psect->_offset, psect->_size, psect->_checksum,
+                    ok ? "ok" : "BAD");
+            if (!ok && err == NULL)
+                err = "bad section checksum";
+        }
+        free(sects);
+    }
+
+    if (err != NULL)
+        fprintf(out, "error: %s\n", err);
+    return err == NULL;
+}
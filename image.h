@@ -0,0 +1,225 @@
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+/*!
+ * \file image.h
+ * \brief Format d'image binaire versionné, portable et projetable.
+ *
+ * Une image commence par un en-tête (Image_Header) suivi d'une table de
+ * sections (Image_Section). Chaque section commence sur une frontière de
+ * page (\c IMAGE_ALIGN) : le fichier peut donc être projeté tel quel
+ * (\c mmap) et le segment de texte utilisé sans copie.
+ *
+ * Les entiers sont rangés dans l'ordre des octets de la machine qui a écrit
+ * l'image, indiqué par \c _endian (et reconnaissable au nombre magique). À la
+ * lecture d'une image d'ordre étranger, tous les mots sont retournés
+ * (image_swap_words()). Les instructions sont rangées dans leur codage
+ * canonique : celui des champs de bits de gcc sur une machine petit-boutiste
+ * (code opération dans les 6 bits de poids faible...).
+ *
+ * Le segment de données peut être rangé tel quel (\c SECT_DATA) ou, s'il
+ * contient surtout des zéros, sous forme d'une suite d'extensions non nulles
+ * (\c SECT_DATA_EXTENTS) : pour chacune, son adresse de début, son nombre de
+ * mots puis leur contenu ; les mots qui ne sont couverts par aucune extension
+ * sont nuls.
+ *
+ * Chaque section, ainsi que l'en-tête avec sa table, est protégée par une
+ * somme de contrôle (image_checksum()) calculée sur les valeurs des mots,
+ * indépendamment de l'ordre de leurs octets.
+ *
+ * L'ancien format (trois entiers puis le texte et les données, voir
+ * read_program()) reste lisible : read_program() et map_program()
+ * reconnaissent le format au nombre magique.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "machine.h"
+
+//! Nombre magique ("SIMG" lu en petit-boutiste)
+#define IMAGE_MAGIC 0x474d4953u
+
+//! Version courante du format
+/*!
+ * La version 2 ajoute le codage par extensions du segment de données
+ * (\c SECT_DATA_EXTENTS) ; une image qui ne l'utilise pas est écrite en
+ * version 1.
+ */
+#define IMAGE_VERSION 2
+
+//! Alignement des sections dans le fichier (en octets)
+#define IMAGE_ALIGN 4096
+
+//! Ordre des octets d'une image
+typedef enum
+{
+    IMAGE_LITTLE = 1,		//!< Petit-boutiste
+    IMAGE_BIG = 2,		//!< Gros-boutiste
+} Image_Endian;
+
+//! Types de section
+typedef enum
+{
+    SECT_TEXT = 1,		//!< Segment de texte (\c _textsize instructions)
+    SECT_DATA = 2,		//!< Segment de données (\c _datasize mots)
+    SECT_DATA_EXTENTS = 3,	//!< Segment de données codé par extensions
+} Image_Section_Type;
+
+//! Nombre maximal de mots nuls conservés à l'intérieur d'une extension
+/*!
+ * Couper une extension coûte deux mots (début et longueur de la suivante) :
+ * il est inutile de le faire pour un intervalle nul plus court.
+ */
+#define IMAGE_EXTENT_GAP 2
+
+//! En-tête d'une image (40 octets)
+typedef struct
+{
+    uint32_t _magic;		//!< \c IMAGE_MAGIC
+    uint16_t _version;		//!< Version du format
+    uint8_t _endian;		//!< Ordre des octets (Image_Endian)
+    uint8_t _reserved;		//!< Inutilisé (0)
+    uint32_t _nsections;	//!< Nombre d'entrées de la table de sections
+    uint32_t _textsize;		//!< Taille du segment de texte
+    uint32_t _datasize;		//!< Taille du segment de données
+    uint32_t _dataend;		//!< Fin des données statiques
+    uint32_t _align;		//!< Alignement des sections (octets)
+    uint32_t _flags;		//!< Inutilisé (0)
+    uint64_t _checksum;		//!< Somme de l'en-tête (ce champ nul) et de la table
+} Image_Header;
+
+//! Entrée de la table de sections (32 octets)
+/*!
+ * Les sections de type inconnu sont ignorées à la lecture (compatibilité
+ * ascendante).
+ */
+typedef struct
+{
+    uint32_t _type;		//!< Type (Image_Section_Type)
+    uint32_t _flags;		//!< Inutilisé (0)
+    uint64_t _offset;		//!< Position dans le fichier (multiple de \c _align)
+    uint64_t _size;		//!< Taille en octets (multiple de 4)
+    uint64_t _checksum;		//!< Somme de contrôle du contenu
+} Image_Section;
+
+//! Somme de contrôle d'une suite de mots (Fletcher 64 bits)
+/*!
+ * \param words les mots (dans l'ordre des octets de l'hôte)
+ * \param n leur nombre
+ * \return la somme
+ */
+uint64_t image_checksum(const uint32_t *words, size_t n);
+
+//! Retournement de l'ordre des octets d'une suite de mots
+/*!
+ * La boucle principale traite 16 octets à la fois (extensions vectorielles
+ * de gcc) ; \c src et \c dst peuvent être identiques.
+ *
+ * \param dst la destination
+ * \param src la source
+ * \param n le nombre de mots
+ */
+void image_swap_words(uint32_t *dst, const uint32_t *src, size_t n);
+
+//! Reconnaissance d'une image
+/*!
+ * \param start le début du fichier
+ * \param len sa taille
+ * \return vrai si le fichier commence par le nombre magique (dans l'un ou
+ * l'autre ordre des octets)
+ */
+bool image_probe(const void *start, size_t len);
+
+//! Description d'une image ouverte (projetée en mémoire)
+typedef struct
+{
+    Image_Header _header;	//!< En-tête (dans l'ordre des octets de l'hôte)
+    bool _swap;			//!< Image d'ordre étranger ?
+    const uint32_t *_text;	//!< Section de texte (dans la projection)
+    const uint32_t *_data;	//!< Section de données (dans la projection)
+    size_t _datalen;		//!< Taille de la section de données (en mots)
+    uint32_t _datatype;		//!< Type de la section de données (dense ou extensions)
+    uint64_t _textsum;		//!< Somme de contrôle attendue du texte
+    uint64_t _datasum;		//!< Somme de contrôle attendue des données
+} Image;
+
+//! Ouverture d'une image projetée en mémoire
+/*!
+ * L'en-tête, la table de sections et leur somme de contrôle sont vérifiés ;
+ * toute incohérence est une erreur fatale.
+ *
+ * \param pimg la description à remplir
+ * \param map la projection du fichier
+ * \param len sa taille
+ * \param programfile le nom du fichier (messages d'erreur)
+ */
+void image_open(Image *pimg, const void *map, size_t len, const char *programfile);
+
+//! Le texte de l'image est-il utilisable sans copie ?
+/*!
+ * C'est le cas quand l'image est dans l'ordre des octets de l'hôte et que
+ * l'hôte utilise le codage canonique des instructions.
+ */
+bool image_text_shareable(const Image *pimg);
+
+//! Vérification du texte utilisé en place dans la projection
+/*!
+ * La somme de contrôle du texte est calculée sur la projection (erreur
+ * fatale si elle diffère) ; à appeler avant d'exécuter un texte partagé
+ * (image_text_shareable()), image_copy_text() ne s'en chargeant que pour une
+ * copie.
+ *
+ * \param pimg l'image
+ * \param programfile le nom du fichier (messages d'erreur)
+ */
+void image_verify_text(const Image *pimg, const char *programfile);
+
+//! Copie du segment de texte d'une image
+/*!
+ * Les mots sont retournés et convertis dans le codage de l'hôte si
+ * nécessaire, puis la somme de contrôle est vérifiée (erreur fatale).
+ *
+ * \param pimg l'image
+ * \param text la destination (\c _textsize instructions)
+ * \param programfile le nom du fichier (messages d'erreur)
+ */
+void image_copy_text(const Image *pimg, Instruction *text, const char *programfile);
+
+//! Chargement du segment de données d'une image
+/*!
+ * Le contenu est écrit directement dans le segment (retourné au passage si
+ * nécessaire), sans tampon intermédiaire ; avec le codage par extensions,
+ * chaque mot est écrit une seule fois (contenu des extensions ou zéro entre
+ * elles). La somme de contrôle est vérifiée au fil de la copie (erreur
+ * fatale).
+ *
+ * \param pimg l'image
+ * \param data le segment de données, de contenu quelconque (au moins \c
+ * _datasize mots)
+ * \param programfile le nom du fichier (messages d'erreur)
+ */
+void image_load_data(const Image *pimg, Word *data, const char *programfile);
+
+//! Écriture d'une machine sous forme d'image
+/*!
+ * Le segment de données est codé par extensions si c'est plus court.
+ *
+ * \param pmach la machine (texte et état courant des données)
+ * \param programfile le nom du fichier
+ * \param foreign écrire dans l'ordre des octets opposé à celui de l'hôte ?
+ */
+void image_write(Machine *pmach, const char *programfile, bool foreign);
+
+//! Affichage de l'en-tête et de la table de sections d'une image
+/*!
+ * \param out le flot de sortie
+ * \param map la projection du fichier
+ * \param len sa taille
+ * \return vrai si l'image est valide (sommes de contrôle comprises)
+ */
+bool image_info(FILE *out, const void *map, size_t len);
+
+#endif
@@ -8,113 +8,199 @@
 #include "instruction.h"
 
  //! Forme imprimable des codes opérations
-const char *cop_names[] = {"ILLOP",	"NOP", "LOAD", "STORE",	"ADD", "SUB", "BRANCH", "CALL", "RET", "PUSH", "POP", "HALT"};
+const char *cop_names[] = {"ILLOP",	"NOP", "LOAD", "STORE",	"ADD", "SUB", "BRANCH", "CALL", "RET", "PUSH", "POP", "HALT", "XCHG", "FADD",
+			    "MUL", "DIV", "MOD", "AND", "OR", "XOR", "SHL", "SHR", "CMP", "MOVE", "FILL", "TRAP"};
 
 //! Forme imprimable des conditions
 const char *condition_names[] = {"NC", "EQ", "NE", "GT", "GE", "LT","LE"};
 
-//! Impression d'une instruction avec 2 arguments
+//! Formes imprimables des codes opérations suivis d'un espace (préfixe du désassemblage)
+static const char *cop_prefix[] = {"ILLOP", "NOP", "LOAD ", "STORE ", "ADD ", "SUB ", "BRANCH ", "CALL ", "RET", "PUSH ", "POP ", "HALT", "XCHG ", "FADD ",
+				    "MUL ", "DIV ", "MOD ", "AND ", "OR ", "XOR ", "SHL ", "SHR ", "CMP ", "MOVE ", "FILL ", "TRAP "};
+
+//! Formes imprimables des conditions suivies du séparateur d'opérande
+static const char *condition_prefix[] = {"NC, ", "EQ, ", "NE, ", "GT, ", "GE, ", "LT, ", "LE, "};
+
+//! Chiffres hexadécimaux
+static const char hex_digits[] = "0123456789abcdef";
+
+//! Copie d'une chaîne constante dans le tampon
+static inline char *put_str(char *buf, const char *str){
+	while(*str)
+		*buf++ = *str++;
+	return buf;
+}
+
+//! Formatage hexadécimal (équivalent de "%0*x")
 /*!
- * \param instr l'instruction à imprimer
+ * \param buf le tampon de destination
+ * \param value la valeur à formater
+ * \param width nombre minimal de chiffres
+ * \return la position suivant le dernier caractère écrit
  */
-void print_two(Instruction instr){
-	if(instr.instr_generic._immediate == 0){
-		if(instr.instr_generic._indexed == 0 || (instr.instr_generic._indexed == 1 && instr.instr_indexed._offset == 0)){
-			printf("R%02d, @0x%04x", instr.instr_absolute._regcond, instr.instr_absolute._address);
-		}
-		else{
-			printf("R%02d, %d[R%02d]", instr.instr_indexed._regcond, instr.instr_indexed._offset, instr.instr_indexed._rindex);
-		}
-	}
-	else{
-		printf("R%02d, #%d", instr.instr_immediate._regcond, instr.instr_immediate._value);
-	}
+char *format_hex(char *buf, uint32_t value, int width){
+	int ndigits = 1;
+	for(uint32_t v = value >> 4; v != 0; v >>= 4)
+		ndigits++;
+	if(ndigits < width)
+		ndigits = width;
+	for(int i = ndigits - 1; i >= 0; i--, value >>= 4)
+		buf[i] = hex_digits[value & 0xf];
+	return buf + ndigits;
 }
 
-//! Impression d'une instruction avec 1 arguments
+//! Formatage décimal non signé (équivalent de "%u")
 /*!
- * \param instr l'instruction à imprimer
+ * \param buf le tampon de destination
+ * \param value la valeur à formater
+ * \return la position suivant le dernier caractère écrit
  */
- void print_onenimm(Instruction instr){
- 	if(instr.instr_generic._immediate == 0){
-		if(instr.instr_generic._indexed == 0){
-			printf("@0x%04x", instr.instr_absolute._address);
-		}
-		else{
-			printf("%d[R%02d]", instr.instr_indexed._offset, instr.instr_indexed._rindex);
-		}
+char *format_udec(char *buf, uint32_t value){
+	char tmp[10];
+	int n = 0;
+	do{
+		tmp[n++] = '0' + value % 10;
+		value /= 10;
+	} while(value != 0);
+	while(n > 0)
+		*buf++ = tmp[--n];
+	return buf;
+}
+
+//! Formatage décimal signé (équivalent de "%d")
+static inline char *format_dec(char *buf, int32_t value){
+	if(value < 0){
+		*buf++ = '-';
+		return format_udec(buf, -(uint32_t) value);
 	}
- }
+	return format_udec(buf, value);
+}
 
-//! Impression d'une instruction sous forme lisible (désassemblage)
+//! Formatage d'un numéro de registre (équivalent de "R%02d")
+static inline char *format_reg(char *buf, unsigned reg){
+	buf[0] = 'R';
+	buf[1] = '0' + reg / 10;
+	buf[2] = '0' + reg % 10;
+	return buf + 3;
+}
+
+//! Formatage d'une adresse absolue (équivalent de "@0x%04x")
+static inline char *format_abs(char *buf, unsigned address){
+	buf = put_str(buf, "@0x");
+	return format_hex(buf, address, 4);
+}
+
+//! Formatage d'une adresse indexée (équivalent de "%d[R%02d]")
+static inline char *format_idx(char *buf, Instruction instr){
+	buf = format_dec(buf, instr.instr_indexed._offset);
+	*buf++ = '[';
+	buf = format_reg(buf, instr.instr_indexed._rindex);
+	*buf++ = ']';
+	return buf;
+}
+
+//! Formatage d'une instruction avec 2 arguments (registre et opérande)
+static char *format_two(char *buf, Instruction instr){
+	buf = format_reg(buf, instr.instr_generic._regcond);
+	*buf++ = ',';
+	*buf++ = ' ';
+	if(instr.instr_generic._immediate == 0){
+		if(instr.instr_generic._indexed == 0 || instr.instr_indexed._offset == 0)
+			return format_abs(buf, instr.instr_absolute._address);
+		return format_idx(buf, instr);
+	}
+	*buf++ = '#';
+	return format_dec(buf, instr.instr_immediate._value);
+}
+
+//! Formatage d'une instruction avec 1 argument non immédiat
+static char *format_onenimm(char *buf, Instruction instr){
+	if(instr.instr_generic._immediate == 0){
+		if(instr.instr_generic._indexed == 0)
+			return format_abs(buf, instr.instr_absolute._address);
+		return format_idx(buf, instr);
+	}
+	return buf;
+}
+
+//! Désassemblage d'une instruction dans un tampon
 /*!
- * \param instr l'instruction à imprimer
+ * \param buf le tampon (au moins \c DISASM_MAXLEN caractères)
+ * \param instr l'instruction à désassembler
  * \param addr son adresse
+ * \return le nombre de caractères écrits (le tampon n'est pas terminé par
+ * un caractère nul)
  */
-void print_instruction(Instruction instr, unsigned addr){
-	switch(instr.instr_generic._cop){
-		case ILLOP: 
-			printf("%s", cop_names[0]);
-			break;
-		case NOP:
-			printf("%s", cop_names[1]);
-			break;
+size_t format_instruction(char *buf, Instruction instr, unsigned addr){
+	char *p = buf;
+	Code_Op op = instr.instr_generic._cop;
+
+	if(op > LAST_COP)
+		return 0; // code inconnu : rien à afficher
+	p = put_str(p, cop_prefix[op]);
+	switch(op){
 		case LOAD:
-			printf("%s ", cop_names[2]);
-			print_two(instr);
+		case ADD:
+		case SUB:
+		case MUL:
+		case DIV:
+		case MOD:
+		case AND:
+		case OR:
+		case XOR:
+		case SHL:
+		case SHR:
+		case CMP:
+			p = format_two(p, instr);
 			break;
 		case STORE:
-			printf("%s ", cop_names[3]);
+		case XCHG:
+		case FADD:
 			if(instr.instr_generic._immediate == 0){
-				if(instr.instr_generic._indexed == 0){
-					printf("R%02d, @0x%04x", instr.instr_absolute._regcond, instr.instr_absolute._address);
-				}
-				else{
-					printf("R%02d, %d[R%02d]", instr.instr_indexed._regcond, instr.instr_indexed._offset, instr.instr_indexed._rindex);
-				}
+				p = format_reg(p, instr.instr_generic._regcond);
+				*p++ = ',';
+				*p++ = ' ';
+				p = instr.instr_generic._indexed == 0 ? format_abs(p, instr.instr_absolute._address) : format_idx(p, instr);
 			}
 			break;
-		case ADD:
-			printf("%s ", cop_names[4]);
-			print_two(instr);
-			break;
-		case SUB:
-			printf("%s ", cop_names[5]);
-			print_two(instr);
-			break;
 		case BRANCH:
-			printf("%s ", cop_names[6]);
-			printf("%s, ", condition_names[instr.instr_generic._regcond]);
-			print_onenimm(instr);
-			break;
 		case CALL:
-			printf("%s ", cop_names[7]);
-			printf("%s, ", condition_names[instr.instr_generic._regcond]);
-			print_onenimm(instr);
-			break;
-		case RET:
-			printf("%s", cop_names[8]);
+			p = put_str(p, instr.instr_generic._regcond <= LAST_CONDITION ? condition_prefix[instr.instr_generic._regcond] : "??, ");
+			p = format_onenimm(p, instr);
 			break;
 		case PUSH:
-			printf("%s ", cop_names[9]);
-			if(instr.instr_generic._immediate == 0){
-				if(instr.instr_generic._indexed == 0){
-					printf("@0x%04x", instr.instr_absolute._address);
-				}
-				else{
-					printf("%d[R%02d]", instr.instr_indexed._offset, instr.instr_indexed._rindex);
-				}
-			}
+		case TRAP:
+			if(instr.instr_generic._immediate == 0)
+				p = format_onenimm(p, instr);
 			else{
-				printf("#%d", instr.instr_immediate._value);
+				*p++ = '#';
+				p = format_dec(p, instr.instr_immediate._value);
 			}
 			break;
 		case POP:
-			printf("%s ", cop_names[10]);
-			print_onenimm(instr);
+			p = format_onenimm(p, instr);
+			break;
+		case MOVE:
+		case FILL:
+			// nombre, destination, source (ou valeur)
+			p = format_reg(p, instr.instr_block._regcond);
+			p = put_str(p, ", ");
+			p = format_reg(p, instr.instr_block._rdest);
+			p = put_str(p, ", ");
+			p = format_reg(p, instr.instr_block._rsrc);
 			break;
-		case HALT:
-			printf("%s", cop_names[11]);
+		default:
 			break;
 	}
-}
\ No newline at end of file
+	return p - buf;
+}
+
+//! Impression d'une instruction sous forme lisible (désassemblage)
+/*!
+ * \param instr l'instruction à imprimer
+ * \param addr son adresse
+ */
+void print_instruction(Instruction instr, unsigned addr){
+	char buf[DISASM_MAXLEN];
+	fwrite(buf, 1, format_instruction(buf, instr, addr), stdout);
+}
@@ -7,6 +7,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 //! Codes opérations
@@ -24,10 +25,24 @@ typedef enum
     PUSH,	//!< Empilement sur la pile d'exécution 
     POP,	//!< Dépilement de la pile d'exécution
     HALT,	//!< Arrêt (normal) du programme
+    XCHG,	//!< Échange atomique d'un registre et d'un mot de données
+    FADD,	//!< Addition atomique à un mot de données (ancienne valeur dans le registre)
+    MUL,	//!< Multiplication d'un registre
+    DIV,	//!< Division (entière, signée) d'un registre
+    MOD,	//!< Reste de la division (signée) d'un registre
+    AND,	//!< Et bit à bit avec un registre
+    OR,		//!< Ou bit à bit avec un registre
+    XOR,	//!< Ou exclusif bit à bit avec un registre
+    SHL,	//!< Décalage à gauche d'un registre
+    SHR,	//!< Décalage (logique) à droite d'un registre
+    CMP,	//!< Comparaison (soustraction sans modification du registre)
+    MOVE,	//!< Copie d'un bloc de mots de données
+    FILL,	//!< Remplissage d'un bloc de mots de données par une valeur
+    TRAP,	//!< Appel d'un service de l'hôte (voir trap.h)
 } Code_Op;
 
 //! Dernière valeur possible du code opération
-const static unsigned LAST_COP = HALT;
+const static unsigned LAST_COP = TRAP;
 
 
 //! Structure d'une instruction 
@@ -95,6 +110,18 @@ typedef union Instruction
         signed int _offset : 16;//!< Déplacement
     } instr_indexed;
 
+    //! Format d'une instruction sur un bloc de mots (MOVE, FILL)
+    struct 
+    {
+        Code_Op _cop : 6; 	//!< Code opération
+        bool _immediate : 1;	//!< Adressage immédiat ? (interdit)
+        bool _indexed : 1;	//!< Adressage indirect ? (ignoré)
+        unsigned _regcond : 4;	//!< Registre contenant le nombre de mots
+        unsigned _rdest : 4;	//!< Registre contenant l'adresse de destination
+        unsigned _rsrc : 4;	//!< Registre contenant l'adresse source (MOVE) ou la valeur (FILL)
+        unsigned _pad : 12;	//!< Inutilisé
+    } instr_block;
+
 } Instruction;
 
 //! Conditions
@@ -129,6 +156,39 @@ extern const char *cop_names[];
 //! Forme imprimable des conditions
 extern const char *condition_names[];
 
+//! Taille maximale du désassemblage d'une instruction
+#define DISASM_MAXLEN 48
+
+//! Désassemblage d'une instruction dans un tampon
+/*!
+ * C'est le moteur de print_instruction() : les mnémoniques sont précalculés
+ * et les nombres sont formatés à la main, sans passer par \c printf.
+ *
+ * \param buf le tampon (au moins \c DISASM_MAXLEN caractères)
+ * \param instr l'instruction à désassembler
+ * \param addr son adresse
+ * \return le nombre de caractères écrits (le tampon n'est pas terminé par
+ * un caractère nul)
+ */
+size_t format_instruction(char *buf, Instruction instr, unsigned addr);
+
+//! Formatage hexadécimal (équivalent de "%0*x")
+/*!
+ * \param buf le tampon de destination
+ * \param value la valeur à formater
+ * \param width nombre minimal de chiffres
+ * \return la position suivant le dernier caractère écrit
+ */
+char *format_hex(char *buf, uint32_t value, int width);
+
+//! Formatage décimal non signé (équivalent de "%u")
+/*!
+ * \param buf le tampon de destination
+ * \param value la valeur à formater
+ * \return la position suivant le dernier caractère écrit
+ */
+char *format_udec(char *buf, uint32_t value);
+
 //! Impression d'une instruction sous forme lisible (désassemblage)
 /*!
  * \param instr l'instruction à imprimer
@@ -0,0 +1,126 @@
+/*!
+ * \file listing.c
+ * \brief Production rapide du listing (désassemblage) d'un segment de texte.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "listing.h"
+
+//! Nombre maximal de threads de formatage
+#define LISTING_MAXTHREADS 64
+
+//! Formatage d'une ligne de listing
+/*!
+ * \param buf le tampon (au moins \c LISTING_MAXLINE caractères)
+ * \param instr l'instruction
+ * \param addr son adresse
+ * \return le nombre de caractères écrits
+ */
+size_t format_listing_line(char *buf, Instruction instr, unsigned addr)
+{
+    char *p = buf;
+
+    memcpy(p, "\n0x", 3);
+    p = format_hex(p + 3, addr, 4);
+    memcpy(p, ": 0x", 4);
+    p = format_hex(p + 4, instr._raw, 8);
+    *p++ = '\t';
+    return (p - buf) + format_instruction(p, instr, addr);
+}
+
+//! Travail d'un thread de formatage : un bloc d'instructions
+typedef struct
+{
+    const Instruction *_text;	//!< Segment de texte
+    unsigned _start;		//!< Première adresse du bloc
+    unsigned _end;		//!< Adresse suivant la dernière du bloc
+    char *_buf;			//!< Tampon (LISTING_CHUNK lignes)
+    size_t _len;		//!< Longueur formatée
+} Chunk;
+
+//! Formatage d'un bloc d'instructions
+static void *format_chunk(void *arg)
+{
+    Chunk *pchunk = (Chunk *) arg;
+    size_t len = 0;
+
+    for (unsigned addr = pchunk->_start; addr < pchunk->_end; ++addr)
+        len += format_listing_line(pchunk->_buf + len, pchunk->_text[addr], addr);
+    pchunk->_len = len;
+    return NULL;
+}
+
+//! Listing d'un segment de texte
+/*!
+ * On procède par tours : à chaque tour, chaque thread formate un bloc
+ * consécutif, puis les blocs sont écrits dans l'ordre. La mémoire utilisée
+ * est donc bornée par \c nthreads tampons quelle que soit la taille du
+ * segment.
+ *
+ * \param out le flot de sortie
+ * \param text le segment de texte
+ * \param textsize sa taille utile
+ * \param nthreads nombre de threads (0 : choix automatique)
+ */
+void print_listing(FILE *out, const Instruction *text, unsigned textsize, unsigned nthreads)
+{
+    if (nthreads == 0)
+    {
+        long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = textsize >= LISTING_PARALLEL_MIN && ncpus > 1 ? ncpus : 1;
+    }
+    unsigned nchunks = (textsize + LISTING_CHUNK - 1) / LISTING_CHUNK;
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+    if (nthreads > LISTING_MAXTHREADS)
+        nthreads = LISTING_MAXTHREADS;
+    if (nthreads == 0)
+        return;
+
+    Chunk chunks[LISTING_MAXTHREADS];
+    pthread_t threads[LISTING_MAXTHREADS];
+    for (unsigned i = 0; i < nthreads; ++i)
+    {
+        chunks[i]._text = text;
+        chunks[i]._buf = (char *) malloc(LISTING_CHUNK * LISTING_MAXLINE);
+        if (chunks[i]._buf == NULL)
+        {
+            perror("print_listing.malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (unsigned start = 0; start < textsize; start += nthreads * LISTING_CHUNK)
+    {
+        unsigned nactive = 0;
+        bool started[LISTING_MAXTHREADS];
+        for (unsigned i = 0; i < nthreads && start + i * LISTING_CHUNK < textsize; ++i, ++nactive)
+        {
+            chunks[i]._start = start + i * LISTING_CHUNK;
+            chunks[i]._end = textsize - chunks[i]._start > LISTING_CHUNK ? chunks[i]._start + LISTING_CHUNK : textsize;
+            // le thread courant prend le premier bloc ; à défaut de thread, il prend aussi les autres
+            started[i] = i > 0 && pthread_create(&threads[i], NULL, format_chunk, &chunks[i]) == 0;
+        }
+        for (unsigned i = 0; i < nactive; ++i)
+            if (!started[i])
+                format_chunk(&chunks[i]);
+
+        for (unsigned i = 0; i < nactive; ++i)
+        {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            fwrite(chunks[i]._buf, 1, chunks[i]._len, out);
+        }
+    }
+
+    for (unsigned i = 0; i < nthreads; ++i)
+        free(chunks[i]._buf);
+}
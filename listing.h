@@ -0,0 +1,49 @@
+#ifndef _LISTING_H_
+#define _LISTING_H_
+
+/*!
+ * \file listing.h
+ * \brief Production rapide du listing (désassemblage) d'un segment de texte.
+ */
+
+#include <stdio.h>
+
+#include "instruction.h"
+
+//! Nombre d'instructions formatées par bloc avant écriture
+#define LISTING_CHUNK 16384
+
+//! Taille maximale d'une ligne de listing
+#define LISTING_MAXLINE (DISASM_MAXLEN + 24)
+
+//! Taille de segment au delà de laquelle le listing est réparti sur plusieurs threads
+#define LISTING_PARALLEL_MIN (4 * LISTING_CHUNK)
+
+//! Formatage d'une ligne de listing
+/*!
+ * La ligne a la forme "\n0xADDR: 0xRAW\tDÉSASSEMBLAGE" utilisée par
+ * print_program().
+ *
+ * \param buf le tampon (au moins \c LISTING_MAXLINE caractères)
+ * \param instr l'instruction
+ * \param addr son adresse
+ * \return le nombre de caractères écrits
+ */
+size_t format_listing_line(char *buf, Instruction instr, unsigned addr);
+
+//! Listing d'un segment de texte
+/*!
+ * Les lignes sont formatées dans des tampons de \c LISTING_CHUNK
+ * instructions écrits d'un seul bloc. Pour les grands segments, les blocs
+ * peuvent être formatés en parallèle ; ils sont toujours écrits dans l'ordre
+ * des adresses.
+ *
+ * \param out le flot de sortie
+ * \param text le segment de texte
+ * \param textsize sa taille utile
+ * \param nthreads nombre de threads (0 : choix automatique selon la taille
+ * du segment et le nombre de processeurs ; 1 : pas de parallélisme)
+ */
+void print_listing(FILE *out, const Instruction *text, unsigned textsize, unsigned nthreads);
+
+#endif
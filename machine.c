@@ -1,13 +1,24 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "machine.h"
 #include "exec.h"
 #include "debug.h"
+#include "listing.h"
+#include "model.h"
+#include "image.h"
+#include "arena.h"
+#include "fast.h"
+#include "share.h"
+#include "guard.h"
+#include "archive.h"
 
 //! Affichage d'une erreur posix et sortie du programme
 /*!
@@ -21,30 +32,19 @@ void perror_exit(const char *msg)
     exit(EXIT_FAILURE);
 }
 
-//! Chargement d'un programme
+//! Chargement du segment de données et initialisation du processeur
 /*!
- * La machine est réinitialisée et ses segments de texte et de données sont
- * remplacés par ceux fournis en paramètre.
+ * C'est la partie de load_program() commune à tous les modes de chargement
+ * du texte (copie ou projection).
  *
  * \param pmach la machine en cours d'exécution
- * \param textsize taille utile du segment de texte
- * \param text le contenu du segment de texte
  * \param datasize taille utile du segment de données
- * \param data le contenu initial du segment de texte
+ * \param data le contenu initial du segment de données (NULL : rempli par
+ * l'appelant)
  * \param dataend taille des données statiques dans le segment de données
  */
-void load_program(Machine *pmach,
-                  unsigned textsize, Instruction text[textsize],
-                  unsigned datasize, Word data[datasize],  unsigned dataend)
+static void load_data(Machine *pmach, unsigned datasize, const Word data[datasize], unsigned dataend)
 {
-    // textsize
-    pmach->_textsize = textsize;
-
-    // text
-    pmach->_text = (Instruction *) malloc(textsize * sizeof(Instruction)); // + free ?
-    for (int i = 0; i < textsize; ++i)
-        pmach->_text[i] = text[i];
-
     // dataend
     pmach->_dataend = dataend;
 
@@ -53,11 +53,23 @@ void load_program(Machine *pmach,
         pmach->_datasize = datasize;
     else pmach->_datasize = datasize + MINSTACKSIZE;
 
-    // data
-    pmach->_data = (Word *) malloc(pmach->_datasize * sizeof(Word));
-    for (int i = 0; i < datasize; ++i)
-        pmach->_data[i] = data[i];
+    // data (si data est NULL, l'appelant remplit les datasize premiers mots
+    // sur place) ; le bloc peut venir d'un programme précédent : le
+    // complément de pile est remis à zéro
+    pmach->_data = (Word *) arena_alloc(pmach->_datasize * sizeof(Word));
+    if (data != NULL)
+        memcpy(pmach->_data, data, datasize * sizeof(Word));
+    memset(pmach->_data + datasize, 0, (pmach->_datasize - datasize) * sizeof(Word));
+
+    machine_reset(pmach);
+}
 
+//! Réinitialisation du processeur d'une machine chargée
+/*!
+ * \param pmach la machine, dont les segments sont en place
+ */
+void machine_reset(Machine *pmach)
+{
     // initialisation des registres
     for(int i = 0; i < NREGISTERS - 1; i++)
         pmach->_registers[i] = 0;
@@ -68,8 +80,148 @@ void load_program(Machine *pmach,
     // cc
     pmach->_cc = CC_U;
 
-    // sp
+    // sp et limites de la pile
     pmach->_sp = pmach->_datasize - 1;
+    pmach->_stacklow = pmach->_dataend;
+    pmach->_stackhigh = pmach->_datasize;
+
+    // compteur d'instructions, code de retour, périphériques, modèles, forme
+    // prédécodée, image partagée, zones gardées, archive
+    pmach->_icount = 0;
+    pmach->_status = 0;
+    pmach->_devices = NULL;
+    pmach->_models = NULL;
+    pmach->_fast = NULL;
+    pmach->_image = NULL;
+    pmach->_guard = NULL;
+    pmach->_archive = NULL;
+}
+
+//! Chargement d'un programme
+/*!
+ * La machine est réinitialisée et ses segments de texte et de données sont
+ * remplacés par ceux fournis en paramètre. Aucun périphérique n'est attaché.
+ * La machine doit être neuve ou avoir été libérée par machine_free() ; ses
+ * segments sont pris dans la réserve du thread (arena.h).
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param textsize taille utile du segment de texte
+ * \param text le contenu du segment de texte
+ * \param datasize taille utile du segment de données
+ * \param data le contenu initial du segment de texte
+ * \param dataend taille des données statiques dans le segment de données
+ */
+void load_program(Machine *pmach,
+                  unsigned textsize, Instruction text[textsize],
+                  unsigned datasize, Word data[datasize],  unsigned dataend)
+{
+    // textsize
+    pmach->_textsize = textsize;
+
+    // text
+    pmach->_text = (Instruction *) arena_alloc(textsize * sizeof(Instruction));
+    memcpy(pmach->_text, text, textsize * sizeof(Instruction));
+    pmach->_textmap = NULL;
+    pmach->_textmaplen = 0;
+
+    load_data(pmach, datasize, data, dataend);
+}
+
+//! Chargement d'un programme au format image projeté en mémoire
+/*!
+ * \param pmach la machine à simuler
+ * \param map la projection de l'image
+ * \param len sa taille
+ * \param programfile le nom du fichier
+ * \param share utiliser le texte projeté sans copie (si possible) ?
+ * \return vrai si le texte est utilisé dans la projection
+ */
+static bool load_image(Machine *pmach, const void *map, size_t len, const char *programfile, bool share)
+{
+    Image img;
+    image_open(&img, map, len, programfile);
+
+    pmach->_textsize = img._header._textsize;
+    pmach->_textmap = NULL;
+    pmach->_textmaplen = 0;
+    bool inplace = share && image_text_shareable(&img);
+    if (inplace)
+    {
+        image_verify_text(&img, programfile);
+        pmach->_text = (Instruction *) img._text;
+    }
+    else
+    {
+        pmach->_text = (Instruction *) arena_alloc(img._header._textsize * sizeof(Instruction));
+        image_copy_text(&img, pmach->_text, programfile);
+    }
+
+    load_data(pmach, img._header._datasize, NULL, img._header._dataend);
+    image_load_data(&img, pmach->_data, programfile);
+    return inplace;
+}
+
+//! Chargement d'un programme projeté en mémoire
+bool load_mapped(Machine *pmach, const void *start, size_t len, const char *programfile, bool share)
+{
+    const uint32_t *map = (const uint32_t *) start;
+
+    // format image : le texte est utilisé dans la projection si possible
+    if(image_probe(map, len))
+        return load_image(pmach, map, len, programfile, share);
+
+    if(len < 3 * sizeof(uint32_t))
+    {
+        fprintf(stderr, "could not read textsize, datasize or dataend from %s\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+
+    // textsize, datasize, dataend
+    uint32_t textsize = map[0], datasize = map[1], dataend = map[2];
+    if(len < (3 + (size_t) textsize + datasize) * sizeof(uint32_t))
+    {
+        fprintf(stderr, "could not read text or data from %s\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+
+    pmach->_textsize = textsize;
+    pmach->_textmap = NULL;
+    pmach->_textmaplen = 0;
+    if(share)
+        pmach->_text = (Instruction *) (map + 3);
+    else
+    {
+        pmach->_text = (Instruction *) arena_alloc(textsize * sizeof(Instruction));
+        memcpy(pmach->_text, map + 3, textsize * sizeof(Instruction));
+    }
+
+    load_data(pmach, datasize, (const Word *) map + 3 + textsize, dataend);
+    return share;
+}
+
+//! Projection d'un fichier entier en lecture
+/*!
+ * \param fd le descripteur du fichier (fermé au retour)
+ * \param plen où ranger la taille du fichier
+ * \return la projection (NULL pour un fichier vide)
+ */
+static void *map_file(int fd, size_t *plen)
+{
+    struct stat st;
+
+    if(fstat(fd, &st) == -1)
+        perror_exit("map_file.fstat");
+    *plen = st.st_size;
+    if(*plen == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, *plen, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+        perror_exit("map_file.mmap");
+    close(fd);
+    return map;
 }
 
 //! Lecture d'un programme depuis un fichier binaire
@@ -89,6 +241,12 @@ void load_program(Machine *pmach,
  * Tous les entiers font 32 bits et les adresses de chaque segment commencent à
  * 0. La fonction initialise complétement la machine.
  *
+ * Ce format historique n'est ni portable (ordre des octets de l'hôte) ni
+ * vérifiable ; un fichier au format image (voir image.h), reconnu à son
+ * nombre magique, est également accepté. Un nom de la forme \c
+ * archive:membre qui ne désigne aucun fichier est cherché dans une archive
+ * de programmes (voir archive_read_program()).
+ *
  * \param pmach la machine à simuler
  * \param programfile le nom du fichier binaire
  *
@@ -96,11 +254,17 @@ void load_program(Machine *pmach,
 void read_program(Machine *mach, const char *programfile)
 {
     int fd = open(programfile, O_RDONLY);
-    uint32_t textsize, datasize, dataend, *text, *data;
+    uint32_t textsize, datasize, dataend;
 
-    // ouverture du fichier
+    // ouverture du fichier (ou d'un membre d'archive "archive:membre")
     if(fd == -1)
+    {
+        int err = errno;
+        if(archive_read_program(mach, programfile, false))
+            return;
+        errno = err;
         perror_exit("read_program.open");
+    }
 
     // textsize, datasize, dataend
     if(read(fd, &textsize, sizeof(uint32_t)) < sizeof(uint32_t)
@@ -111,68 +275,170 @@ void read_program(Machine *mach, const char *programfile)
         exit(EXIT_FAILURE);
     }
 
-    // text
-    text = (uint32_t *) malloc(textsize * sizeof(uint32_t));
-    if(read(fd, text, textsize * sizeof(uint32_t)) < textsize * sizeof(uint32_t))
+    // format image
+    if(image_probe(&textsize, sizeof(uint32_t)))
+    {
+        size_t len;
+        void *map = map_file(fd, &len);
+        load_image(mach, map, len, programfile, false);
+        munmap(map, len);
+        return;
+    }
+
+    // text (lu directement dans le segment)
+    mach->_textsize = textsize;
+    mach->_text = (Instruction *) arena_alloc(textsize * sizeof(Instruction));
+    mach->_textmap = NULL;
+    mach->_textmaplen = 0;
+    if(read(fd, mach->_text, textsize * sizeof(uint32_t)) < textsize * sizeof(uint32_t))
     {
         fprintf(stderr, "could not read text from %s\n", programfile);
         exit(EXIT_FAILURE);
     }
 
-    // data
-    data = (uint32_t *) malloc(datasize * sizeof(uint32_t));
-    if(read(fd, data, datasize * sizeof(uint32_t)) < datasize * sizeof(uint32_t))
+    // data (idem)
+    load_data(mach, datasize, NULL, dataend);
+    if(read(fd, mach->_data, datasize * sizeof(uint32_t)) < datasize * sizeof(uint32_t))
     {
         fprintf(stderr, "could not read data from %s\n", programfile);
         exit(EXIT_FAILURE);
     }
 
-    load_program(mach, textsize, (Instruction *) text, datasize, data, dataend);
-    free(text);
-    free(data);
     close(fd);
 }
- 
-//! Affichage du programme et des données
+
+//! Projection d'un programme depuis un fichier binaire
 /*!
- * On affiche les instruction et les données en format hexadécimal, sous une
- * forme prête à être coupée-collée dans le simulateur.
+ * Le fichier a l'un des formats acceptés par read_program() mais le segment
+ * de texte n'est pas copié (quand c'est possible pour une image) : il est
+ * projeté en mémoire (\c mmap) et ses pages ne sont lues qu'au moment où
+ * l'on y accède. Le segment de données est copié comme d'habitude puisqu'il
+ * est modifié par l'exécution.
  *
- * Pendant qu'on y est, on produit aussi un dump binaire dans le fichier
- * dump.bin. Le format de ce fichier est compatible avec l'option -b de
- * test_simul.
+ * \param pmach la machine à simuler
+ * \param programfile le nom du fichier binaire
+ */
+void map_program(Machine *pmach, const char *programfile)
+{
+    int fd = open(programfile, O_RDONLY);
+
+    // ouverture du fichier (ou d'un membre d'archive "archive:membre")
+    if(fd == -1)
+    {
+        int err = errno;
+        if(archive_read_program(pmach, programfile, true))
+            return;
+        errno = err;
+        perror_exit("map_program.open");
+    }
+
+    // projection de tout le fichier (les pages ne sont lues qu'à la demande)
+    size_t len;
+    void *map = map_file(fd, &len);
+
+    // le texte est utilisé dans la projection si possible
+    if(load_mapped(pmach, map, len, programfile, true))
+    {
+        pmach->_textmap = map;
+        pmach->_textmaplen = len;
+    }
+    else if(map != NULL)
+        munmap(map, len);
+}
+
+//! Libération des ressources d'une machine
+/*!
+ * Les segments retournent à la réserve du thread courant (arena.h), la
+ * forme prédécodée est gardée pour être réutilisée (fast_release()) et la
+ * projection du texte éventuelle est supprimée. Les périphériques et les
+ * modèles, qui appartiennent à l'appelant, ne sont pas libérés. Une machine
+ * chargée depuis une image partagée (share.h) en est détachée, les zones
+ * gardées d'une machine protégée (guard.h) sont supprimées ; le texte
+ * d'une machine chargée depuis une archive (archive.h) lui reste. La
+ * machine peut ensuite être rechargée.
  *
- * \param pmach la machine en cours d'exécution
+ * \param pmach la machine
  */
-void dump_memory(Machine *pmach)
+void machine_free(Machine *pmach)
 {
-    int fd = open("dump.bin", O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IRGRP|S_IROTH|S_IWUSR);
+    if(pmach->_guard != NULL)
+        guard_release(pmach); // segments et forme prédécodée sont dans les zones gardées
+    else if(pmach->_image != NULL)
+        share_unload(pmach); // le texte et la forme prédécodée restent à l'image
+    else
+    {
+        fast_release(pmach->_fast);
+        if(pmach->_textmap != NULL)
+            munmap(pmach->_textmap, pmach->_textmaplen);
+        else if(pmach->_archive == NULL) // sinon, le texte reste à l'archive
+            arena_release(pmach->_text);
+        arena_release(pmach->_data);
+    }
+
+    pmach->_fast = NULL;
+    pmach->_text = NULL;
+    pmach->_textmap = NULL;
+    pmach->_textmaplen = 0;
+    pmach->_textsize = 0;
+    pmach->_data = NULL;
+    pmach->_datasize = pmach->_dataend = 0;
+    pmach->_archive = NULL;
+}
+
+//! Écriture d'un programme dans un fichier binaire
+/*!
+ * Le fichier produit a le format décrit avec read_program() ; il contient le
+ * segment de texte et le segment de données (dans son état courant).
+ *
+ * \param pmach la machine
+ * \param programfile le nom du fichier binaire
+ */
+void write_program(Machine *pmach, const char *programfile)
+{
+    int fd = open(programfile, O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IRGRP|S_IROTH|S_IWUSR);
+    uint32_t header[3] = { pmach->_textsize, pmach->_datasize, pmach->_dataend };
 
     // ouverture du fichier
     if(fd == -1)
-        perror_exit("dump_memory.open");
+        perror_exit("write_program.open");
 
-    // écriture des sizes
-    if(write(fd, &pmach->_textsize, sizeof(uint32_t)) < sizeof(uint32_t)
-        || write(fd, &pmach->_datasize, sizeof(uint32_t)) < sizeof(uint32_t)
-        || write(fd, &pmach->_dataend, sizeof(uint32_t)) < sizeof(uint32_t))
+    if(write(fd, header, sizeof(header)) < sizeof(header)
+        || write(fd, pmach->_text, pmach->_textsize * sizeof(uint32_t)) < pmach->_textsize * sizeof(uint32_t)
+        || write(fd, pmach->_data, pmach->_datasize * sizeof(uint32_t)) < pmach->_datasize * sizeof(uint32_t))
     {
-        fprintf(stderr, "could not write textsize, datasize or dataend in dump.bin\n");
+        fprintf(stderr, "could not write program in %s\n", programfile);
         exit(EXIT_FAILURE);
     }
+    close(fd);
+}
+
+//! Longueur minimale d'une suite de zéros omise par dump_memory()
+#define DUMP_ZERORUN 64
 
-    // affichage / écriture des instructions
+//! Affichage du programme et des données
+/*!
+ * On affiche les instruction et les données en format hexadécimal, sous une
+ * forme prête à être coupée-collée dans le simulateur. Les longues suites de
+ * mots de données nuls (au moins \c DUMP_ZERORUN) sont omises : le mot
+ * suivant est alors précédé de son indice (désignateur C99) et le dernier
+ * mot est toujours affiché, pour que le tableau garde sa taille.
+ *
+ * Pendant qu'on y est, on produit aussi un dump binaire dans le fichier
+ * dump.bin, au format image (image_write()), où le segment de données est
+ * codé par extensions non nulles s'il contient surtout des zéros. Ce fichier
+ * est lisible avec l'option -b de test_simul.
+ *
+ * \param pmach la machine en cours d'exécution
+ */
+void dump_memory(Machine *pmach)
+{
+    // affichage des instructions
     puts("Instruction text[] = {");
     for (int i = 0; i < pmach->_textsize; ++i)
     {
         if(i % 4 == 0)
             putchar('\t');
-        if(write(fd, &pmach->_text[i]._raw, sizeof(uint32_t)) < sizeof(uint32_t)
-            || printf("0x%08x, ", pmach->_text[i]._raw) < 0)
-        {
-            fprintf(stderr, "could not write text in dump.bin\n");
-            exit(EXIT_FAILURE);
-        }
+        printf("0x%08x, ", pmach->_text[i]._raw);
         if(i % 4 == 3)
             putchar('\n');
     }
@@ -180,27 +446,49 @@ void dump_memory(Machine *pmach)
     // affichage textsize
     printf("\n};\nunsigned textsize = %u\n\n", pmach->_textsize);
 
-    // affichage / écriture des datas
+    // affichage des datas
     puts("Word data[] = {");
-    for (int i = 0; i < pmach->_datasize; ++i)
+    unsigned col = 0, last = pmach->_datasize - 1;
+    for (unsigned i = 0; i < pmach->_datasize; ++i)
     {
-        if(i % 4 == 0)
-            putchar('\t');
-        if(write(fd, &pmach->_data[i], sizeof(uint32_t)) < sizeof(uint32_t)
-            || printf("0x%08x, ", pmach->_data[i]) < 0)
+        bool designated = false;
+        if (pmach->_data[i] == 0)
         {
-            fprintf(stderr, "could not write text in dump.bin\n");
-            exit(EXIT_FAILURE);
+            unsigned run = i;
+            while (run < last && pmach->_data[run] == 0 && run - i < DUMP_ZERORUN)
+                ++run;
+            if (run - i >= DUMP_ZERORUN)
+            {
+                while (run < last && pmach->_data[run] == 0)
+                    ++run;
+                i = run;
+                designated = true;
+            }
         }
-        if(i % 4 == 3)
+
+        if (designated && col != 0)
+        {
             putchar('\n');
+            col = 0;
+        }
+        if (col == 0)
+            putchar('\t');
+        if (designated)
+            printf("[%u] = ", i);
+        printf("0x%08x, ", pmach->_data[i]);
+        if (++col == 4)
+        {
+            putchar('\n');
+            col = 0;
+        }
     }
 
     // affichage datasize, dataend
     printf("\n};\nunsigned datasize = %u\n", pmach->_datasize);
     printf("unsigned dataend = %u\n\n", pmach->_dataend);
 
-    close(fd);
+    // dump binaire
+    image_write(pmach, "dump.bin", false);
 }
 
 //! Affichage des instructions du programme
@@ -212,14 +500,34 @@ void dump_memory(Machine *pmach)
 void print_program(Machine *pmach)
 {
     printf("\n*** PROGRAM (size: %u) ***", pmach->_textsize);
-    for(int i = 0; i < pmach->_textsize; i++)
-    {
-        printf("\n0x%04x: 0x%08x\t", i, pmach->_text[i]._raw);
-        print_instruction(pmach->_text[i], 0);
-    }
+    print_listing(stdout, pmach->_text, pmach->_textsize, 0);
     puts("\n");
 }
 
+//! Taille du tampon d'affichage des données
+#define PRINT_BUFSIZE 65536
+
+//! Longueur maximale d'une ligne produite dans ce tampon
+#define PRINT_MAXLINE 64
+
+//! Formatage d'un mot de données (équivalent de "0x%04x: 0x%08x %u")
+/*!
+ * \param buf le tampon de destination
+ * \param addr l'adresse du mot
+ * \param value sa valeur
+ * \return la position suivant le dernier caractère écrit
+ */
+static char *format_word(char *buf, unsigned addr, Word value)
+{
+    *buf++ = '0';
+    *buf++ = 'x';
+    buf = format_hex(buf, addr, 4);
+    memcpy(buf, ": 0x", 4);
+    buf = format_hex(buf + 4, value, 8);
+    *buf++ = ' ';
+    return format_udec(buf, value);
+}
+
 //! Affichage des données du programme
 /*!
  * Les valeurs sont affichées en format hexadécimal et décimal.
@@ -228,13 +536,23 @@ void print_program(Machine *pmach)
  */
 void print_data(Machine *pmach)
 {
+    char buf[PRINT_BUFSIZE];
+    char *p = buf;
+
     printf("*** DATA (size %u, end = Ox%08x (%u)) ***", pmach->_datasize, pmach->_dataend, pmach->_dataend);
-    for(int i = 0; i < pmach->_datasize; i++)
+    for (unsigned i = 0; i < pmach->_datasize; i++)
     {
-        if(i % 3 == 0)
-            putchar('\n');
-        printf("0x%04x: 0x%08x %u\t", i, pmach->_data[i], pmach->_data[i]);
+        if (p > buf + PRINT_BUFSIZE - PRINT_MAXLINE)
+        {
+            fwrite(buf, 1, p - buf, stdout);
+            p = buf;
+        }
+        if (i % 3 == 0)
+            *p++ = '\n';
+        p = format_word(p, i, pmach->_data[i]); // "0x%04x: 0x%08x %u\t"
+        *p++ = '\t';
     }
+    fwrite(buf, 1, p - buf, stdout);
     puts("\n");
 }
 
@@ -273,22 +591,118 @@ void print_cpu(Machine *pmach)
     puts("\n");
 }
 
+//! Sauvegarde de l'état d'une machine
+/*!
+ * \param pmach la machine
+ * \param pstate l'état à remplir
+ */
+void save_state(Machine *pmach, Machine_State *pstate)
+{
+    pstate->_datasize = pmach->_datasize;
+    pstate->_data = (Word *) malloc(pmach->_datasize * sizeof(Word));
+    if (pstate->_data == NULL)
+        perror_exit("save_state.malloc");
+    memcpy(pstate->_data, pmach->_data, pmach->_datasize * sizeof(Word));
+    pstate->_pc = pmach->_pc;
+    pstate->_cc = pmach->_cc;
+    memcpy(pstate->_registers, pmach->_registers, sizeof(pstate->_registers));
+}
+
+//! Libération d'un état sauvegardé
+void free_state(Machine_State *pstate)
+{
+    free(pstate->_data);
+    pstate->_data = NULL;
+    pstate->_datasize = 0;
+}
+
+//! Nombre de mots comparés d'un coup par print_changes()
+#define CHANGES_BLOCK 256
+
+//! Affichage des différences avec un état sauvegardé
+/*!
+ * \param pmach la machine
+ * \param pstate l'état de référence
+ */
+void print_changes(Machine *pmach, const Machine_State *pstate)
+{
+    static const char cc_names[] = "UZPN";
+    char buf[PRINT_BUFSIZE];
+    char *p = buf;
+    unsigned nregs = 0, nwords = 0;
+
+    printf("\n*** CHANGES ***\n");
+    if (pmach->_pc != pstate->_pc)
+        printf("PC:  Ox%08x -> Ox%08x\n", pstate->_pc, pmach->_pc);
+    if (pmach->_cc != pstate->_cc)
+        printf("CC:  %c -> %c\n", cc_names[pstate->_cc & 3], cc_names[pmach->_cc & 3]);
+    for (unsigned i = 0; i < NREGISTERS; i++)
+        if (pmach->_registers[i] != pstate->_registers[i])
+        {
+            printf("R%02u: 0x%08x %u -> 0x%08x %u\n", i, pstate->_registers[i], pstate->_registers[i],
+                   pmach->_registers[i], pmach->_registers[i]);
+            nregs++;
+        }
+
+    unsigned n = pmach->_datasize < pstate->_datasize ? pmach->_datasize : pstate->_datasize;
+    for (unsigned block = 0; block < n; block += CHANGES_BLOCK)
+    {
+        unsigned end = block + CHANGES_BLOCK < n ? block + CHANGES_BLOCK : n;
+        if (memcmp(pmach->_data + block, pstate->_data + block, (end - block) * sizeof(Word)) == 0)
+            continue;
+        for (unsigned i = block; i < end; i++)
+            if (pmach->_data[i] != pstate->_data[i])
+            {
+                if (p > buf + PRINT_BUFSIZE - PRINT_MAXLINE)
+                {
+                    fwrite(buf, 1, p - buf, stdout);
+                    p = buf;
+                }
+                // "0x%04x: 0x%08x %u -> 0x%08x %u\n"
+                p = format_word(p, i, pstate->_data[i]);
+                memcpy(p, " -> 0x", 6);
+                p = format_hex(p + 6, pmach->_data[i], 8);
+                *p++ = ' ';
+                p = format_udec(p, pmach->_data[i]);
+                *p++ = '\n';
+
+                nwords++;
+            }
+    }
+    fwrite(buf, 1, p - buf, stdout);
+    printf("%u registers and %u of %u data words changed\n\n", nregs, nwords, n);
+}
+
 //! Simulation
 /*!
  * La boucle de simulation est très simple : recherche de l'instruction
  * suivante (pointée par le compteur ordinal \c _pc) puis décodage et exécution
  * de l'instruction.
  *
+ * Si des modèles de performance sont attachés à la machine, la simulation est
+ * confiée à simul_models() : la boucle ordinaire ne paie rien pour eux.
+ *
  * \param pmach la machine en cours d'exécution
  * \param debug mode de mise au point (pas à apas) ?
  */
 void simul(Machine *pmach, bool debug)
 {
+    if(pmach->_models != NULL)
+    {
+        simul_models(pmach, debug);
+        return;
+    }
+
     do
     {
-        trace("Executing", pmach, pmach->_text[pmach->_pc], pmach->_pc);
+        if(trace_enabled)
+            trace("Executing", pmach, pmach->_text[pmach->_pc], pmach->_pc);
         if(debug)
             debug = debug_ask(pmach);
+        pmach->_icount++;
     }
     while(decode_execute(pmach, pmach->_text[pmach->_pc++]));
+
+    if(pmach->_devices != NULL)
+        devices_flush(pmach->_devices);
 }
@@ -7,8 +7,10 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "instruction.h"
+#include "device.h"
 
 //! Nombre de resitres généraux
 #define NREGISTERS 16
@@ -67,7 +69,7 @@ static const unsigned MINSTACKSIZE = 10;
  *   la pile d'exécution : il doit contenir en permanence l'adresse du
  *   sommet de pile (premier élément libre de la pile).
  */
-typedef struct
+typedef struct Machine
 {
     // Segments de mémoire
     Instruction *_text;		//!< Mémoire pour les instructions
@@ -78,11 +80,26 @@ typedef struct
 
     unsigned int _dataend;      //!< Première adresse libre après les données statiques
 
+    unsigned int _stacklow;	//!< Plus petite valeur valide de SP (\c _dataend sauf en multiprocesseur)
+    unsigned int _stackhigh;	//!< Première valeur invalide de SP au delà (\c _datasize sauf en multiprocesseur)
+
+    void *_textmap;		//!< Projection du fichier binaire contenant le texte (ou NULL)
+    size_t _textmaplen;		//!< Taille de cette projection
+    struct Fast_Text *_fast;	//!< Forme prédécodée du texte pour le moteur rapide (ou NULL)
+    struct Shared_Image *_image;//!< Image partagée d'où viennent texte et données (ou NULL, voir share.h)
+    struct Guard *_guard;	//!< Zones gardées contenant les segments (ou NULL, voir guard.h)
+    const struct Archive *_archive;//!< Archive contenant le texte, utilisé sans copie (ou NULL, voir archive.h)
+
     // Registres de l'unité centrale
     unsigned _pc;		//!< Compteur ordinal
     Condition_Code _cc;		//!< Code condition : signe de la dernière opération
     Word _registers[NREGISTERS];//!< Registres généraux (accumulateurs)
 
+    uint64_t _icount;		//!< Nombre d'instructions exécutées
+    Word _status;		//!< Code de retour du programme (service TRAP_EXIT, 0 sinon)
+    struct Devices *_devices;	//!< Périphériques projetés en mémoire (ou NULL)
+    struct Models *_models;	//!< Modèles de performance (ou NULL, voir model.h)
+
 //! Définition de _sp comme synonyme du registre R15    
 #   define _sp _registers[NREGISTERS - 1] 
 } Machine;
@@ -90,7 +107,7 @@ typedef struct
 //! Chargement d'un programme
 /*!
  * La machine est réinitialisée et ses segments de texte et de données sont
- * remplacés par ceux fournis en paramètre.
+ * remplacés par ceux fournis en paramètre. Aucun périphérique n'est attaché.
  *
  * \param pmach la machine en cours d'exécution
  * \param textsize taille utile du segment de texte
@@ -119,19 +136,88 @@ void load_program(Machine *pmach,
  * Tous les entiers font 32 bits et les adresses de chaque segment commencent à
  * 0. La fonction initialise complétement la machine.
  *
+ * Le format image (image.h) est également accepté, ainsi qu'un membre
+ * d'archive désigné par \c archive:membre (archive.h).
+ *
  * \param pmach la machine à simuler
  * \param programfile le nom du fichier binaire
  *
  */
 void read_program(Machine *mach, const char *programfile);  
  
+//! Projection d'un programme depuis un fichier binaire
+/*!
+ * Le fichier a le même format que pour read_program() mais le segment de
+ * texte n'est pas copié : il est projeté en mémoire (\c mmap) et ses pages
+ * ne sont lues qu'au moment où l'on y accède. Le segment de données est
+ * copié comme d'habitude puisqu'il est modifié par l'exécution.
+ *
+ * \param pmach la machine à simuler
+ * \param programfile le nom du fichier binaire
+ */
+void map_program(Machine *pmach, const char *programfile);
+
+//! Chargement d'un programme projeté en mémoire
+/*!
+ * C'est la partie commune à map_program() et au chargement depuis une
+ * archive (archive.h) : \c start contient un programme dans l'un des formats
+ * acceptés par read_program(). Avec \c share, le texte est utilisé dans la
+ * projection quand c'est possible (ce que dit le résultat) : l'appelant doit
+ * alors la garder tant que la machine l'utilise. Le segment de données est
+ * toujours copié.
+ *
+ * \param pmach la machine à simuler
+ * \param start le début du programme
+ * \param len sa taille
+ * \param programfile le nom du fichier (messages d'erreur)
+ * \param share utiliser le texte sans copie si possible ?
+ * \return vrai si le texte est utilisé dans la projection
+ */
+bool load_mapped(Machine *pmach, const void *start, size_t len, const char *programfile, bool share);
+
+//! Réinitialisation du processeur d'une machine chargée
+/*!
+ * Les registres, le compteur ordinal et le code condition sont remis à zéro,
+ * SP au sommet de la pile ; les compteurs, le code de retour, les
+ * périphériques, les modèles, la forme prédécodée, l'image partagée, les
+ * zones gardées et l'archive sont oubliés. Les segments (et \c _datasize,
+ * \c _dataend) doivent être en place.
+ *
+ * \param pmach la machine
+ */
+void machine_reset(Machine *pmach);
+
+//! Libération des ressources d'une machine
+/*!
+ * Rend les segments (et la forme prédécodée) à la réserve du thread courant
+ * pour qu'un chargement suivant les réutilise ; une machine chargée depuis une
+ * image partagée en est seulement détachée, les zones gardées d'une machine
+ * protégée (guard.h) sont supprimées et le texte d'une machine chargée
+ * depuis une archive lui est laissé. La machine peut ensuite être rechargée
+ * par load_program(), read_program(), map_program(), share_load() ou
+ * archive_load().
+ *
+ * \param pmach la machine
+ */
+void machine_free(Machine *pmach);
+
+//! Écriture d'un programme dans un fichier binaire
+/*!
+ * Le fichier produit a le format décrit avec read_program() ; il contient le
+ * segment de texte et le segment de données (dans son état courant).
+ *
+ * \param pmach la machine
+ * \param programfile le nom du fichier binaire
+ */
+void write_program(Machine *pmach, const char *programfile);
+
 //! Affichage du programme et des données
 /*!
  * On affiche les instruction et les données en format hexadécimal, sous une
  * forme prête à être coupée-collée dans le simulateur.
  *
  * Pendant qu'on y est, on produit aussi un dump binaire dans le fichier
- * dump.prog. Le format de ce fichier est compatible avec l'option -b de
+ * dump.bin, au format image. Ce fichier est lisible avec l'option -b de
  * test_simul.
  *
  * \param pmach la machine en cours d'exécution
@@ -148,7 +234,9 @@ void print_program(Machine *pmach);
 
 //! Affichage des données du programme
 /*!
- * Les valeurs sont affichées en format hexadécimal et décimal.
+ * Les valeurs sont affichées en format hexadécimal et décimal. Les lignes
+ * sont formatées à la main dans un tampon écrit par grands blocs, sans
+ * \c printf par mot.
  *
  * \param pmach la machine en cours d'exécution
  */
@@ -162,6 +250,39 @@ void print_data(Machine *pmach);
  */
 void print_cpu(Machine *pmach);
 
+//! État d'une machine gardé pour comparaison (voir print_changes())
+typedef struct
+{
+    Word *_data;		//!< Copie du segment de données
+    unsigned _datasize;		//!< Taille de la copie
+    unsigned _pc;		//!< Compteur ordinal
+    unsigned _cc;		//!< Code condition
+    Word _registers[NREGISTERS];//!< Registres généraux
+} Machine_State;
+
+//! Sauvegarde de l'état d'une machine
+/*!
+ * \param pmach la machine
+ * \param pstate l'état à remplir (à libérer par free_state())
+ */
+void save_state(Machine *pmach, Machine_State *pstate);
+
+//! Libération d'un état sauvegardé
+void free_state(Machine_State *pstate);
+
+//! Affichage des différences avec un état sauvegardé
+/*!
+ * Seuls le compteur ordinal, le code condition, les registres et les mots de
+ * données qui ont changé sont affichés (ancienne et nouvelle valeur), suivis
+ * du nombre de changements. Les zones identiques du segment de données sont
+ * sautées par blocs (memcmp(), vectorisée par la bibliothèque C) : le coût
+ * est celui d'une copie, même pour de très grands segments.
+ *
+ * \param pmach la machine
+ * \param pstate l'état de référence (en général avant l'exécution)
+ */
+void print_changes(Machine *pmach, const Machine_State *pstate);
+
 //! Simulation
 /*!
  * La boucle de simualtion est très simple : recherche de l'instruction
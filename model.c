@@ -0,0 +1,133 @@
+/*!
+ * \file model.c
+ * \brief Modèles de performance branchés sur la boucle de simulation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "model.h"
+#include "exec.h"
+#include "debug.h"
+
+//! Allocation d'un tableau initialisé à 0 (erreur fatale en cas d'échec)
+void *xcalloc(size_t n, size_t size)
+{
+    void *p = calloc(n, size);
+    if (p == NULL)
+    {
+        perror("xcalloc");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+//! Sélection des éléments de plus grande clé
+unsigned model_top(unsigned count, Model_Key key, const void *ctx, unsigned *top, unsigned n)
+{
+    unsigned found = 0;
+    uint64_t last = 0;
+    for (; found < n; ++found)
+    {
+        unsigned best = count;
+        uint64_t best_key = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            uint64_t k;
+            if (!key(ctx, i, &k))
+                continue;
+            // seulement après le précédent (clé décroissante, puis indice croissant)
+            if (found > 0 && (k > last || (k == last && i <= top[found - 1])))
+                continue;
+            if (best == count || k > best_key)
+            {
+                best = i;
+                best_key = k;
+            }
+        }
+        if (best == count)
+            break;
+        top[found] = best;
+        last = best_key;
+    }
+    return found;
+}
+
+//! Présentation des accès aux données d'une instruction aux modèles
+/*!
+ * \param pmodels les modèles
+ * \param pmach la machine en cours d'exécution
+ * \param instr l'instruction qui va être exécutée
+ * \param addr son adresse
+ */
+static void observe(Models *pmodels, Machine *pmach, Instruction instr, unsigned addr)
+{
+    if (pmodels->_cache != NULL)
+    {
+        Access acc[MAXACCESSES];
+        unsigned n = data_accesses(pmach, instr, acc);
+        for (unsigned i = 0; i < n; ++i)
+            for (unsigned w = 0; w < acc[i]._count; ++w)
+            {
+                unsigned missed = cache_access(pmodels->_cache, addr, acc[i]._addr + w, acc[i]._write);
+                if (pmodels->_timing != NULL)
+                    timing_memory(pmodels->_timing, missed);
+            }
+    }
+}
+
+//! Simulation observée par les modèles
+/*!
+ * \param pmach la machine en cours d'exécution
+ * \param debug mode de mise au point (pas à pas) ?
+ */
+void simul_models(Machine *pmach, bool debug)
+{
+    Models *pmodels = pmach->_models;
+    bool running;
+
+    do
+    {
+        unsigned addr = pmach->_pc;
+        Instruction instr = pmach->_text[addr];
+        if (trace_enabled)
+            trace("Executing", pmach, instr, addr);
+        if (debug)
+            debug = debug_ask(pmach);
+        pmach->_icount++;
+        observe(pmodels, pmach, instr, addr);
+
+        bool taken = (pmodels->_bpred != NULL || pmodels->_timing != NULL) && transfer_taken(pmach, instr);
+        running = decode_execute(pmach, pmach->_text[pmach->_pc++]);
+
+        // redirection : mauvaise prédiction, ou tout branchement pris sans prédicteur
+        bool redirect = taken;
+        if (pmodels->_bpred != NULL)
+            redirect = bpred_update(pmodels->_bpred, addr, instr, taken, pmach->_pc);
+        if (pmodels->_timing != NULL)
+            timing_step(pmodels->_timing, instr, taken, redirect, pmach->_pc);
+    }
+    while (running);
+
+    if (pmach->_devices != NULL)
+        devices_flush(pmach->_devices);
+}
+
+//! Affichage des résultats des modèles
+/*!
+ * \param out le flot de sortie
+ * \param pmach la machine (après exécution)
+ */
+void models_report(FILE *out, const Machine *pmach)
+{
+    const Models *pmodels = pmach->_models;
+
+    if (pmodels == NULL)
+        return;
+    if (pmodels->_cache != NULL)
+        cache_report(out, pmodels->_cache, pmach->_text);
+    if (pmodels->_bpred != NULL)
+        bpred_report(out, pmodels->_bpred, pmach->_text, pmach->_icount);
+    if (pmodels->_timing != NULL)
+        timing_report(out, pmodels->_timing);
+}
@@ -0,0 +1,82 @@
+#ifndef _MODEL_H_
+#define _MODEL_H_
+
+/*!
+ * \file model.h
+ * \brief Modèles de performance branchés sur la boucle de simulation.
+ */
+
+#include <stdio.h>
+
+#include "machine.h"
+#include "cache.h"
+#include "bpred.h"
+#include "timing.h"
+
+//! Modèles de performance attachés à une machine
+/*!
+ * Chaque modèle est facultatif (pointeur NULL s'il est absent). Lorsqu'aucun
+ * ensemble de modèles n'est attaché à la machine (\c _models NULL), simul()
+ * n'exécute aucun code d'observation : le coût est nul.
+ */
+typedef struct Models
+{
+    Cache *_cache;		//!< Hiérarchie de caches de données (ou NULL)
+    Bpred *_bpred;		//!< Prédicteur de branchement (ou NULL)
+    Timing *_timing;		//!< Modèle temporel (ou NULL)
+} Models;
+
+//! Simulation observée par les modèles
+/*!
+ * Même sémantique que simul() (trace, mise au point, périphériques) ; avant
+ * l'exécution de chaque instruction, ses accès aux données (voir
+ * data_accesses()) sont présentés aux modèles, et après son exécution
+ * l'adresse de l'instruction suivante est présentée au prédicteur de
+ * branchement. Le modèle temporel reçoit les échecs de cache et les
+ * mauvaises prédictions si ces modèles sont présents (sinon chaque accès est
+ * un succès et chaque branchement pris est une redirection).
+ *
+ * \param pmach la machine en cours d'exécution
+ * \param debug mode de mise au point (pas à pas) ?
+ */
+void simul_models(Machine *pmach, bool debug);
+
+//! Allocation d'un tableau initialisé à 0 (erreur fatale en cas d'échec)
+/*!
+ * \param n le nombre d'éléments
+ * \param size la taille d'un élément
+ * \return le tableau
+ */
+void *xcalloc(size_t n, size_t size);
+
+//! Clé de classement d'un élément (voir model_top())
+/*!
+ * \param ctx le contexte donné à model_top()
+ * \param i l'indice de l'élément
+ * \param pkey où ranger sa clé
+ * \return faux si l'élément n'est pas à classer
+ */
+typedef bool (*Model_Key)(const void *ctx, unsigned i, uint64_t *pkey);
+
+//! Sélection des éléments de plus grande clé (classements des rapports)
+/*!
+ * Sélection simple, sans allocation : une passe sur les éléments par indice
+ * retenu. À clé égale, le plus petit indice passe devant.
+ *
+ * \param count le nombre d'éléments
+ * \param key la clé de chaque élément
+ * \param ctx le contexte de \c key
+ * \param top où ranger les indices retenus, par clé décroissante
+ * \param n le nombre d'indices voulus (taille de \c top)
+ * \return le nombre d'indices rangés (au plus \c n)
+ */
+unsigned model_top(unsigned count, Model_Key key, const void *ctx, unsigned *top, unsigned n);
+
+//! Affichage des résultats des modèles
+/*!
+ * \param out le flot de sortie
+ * \param pmach la machine (après exécution)
+ */
+void models_report(FILE *out, const Machine *pmach);
+
+#endif
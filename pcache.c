@@ -0,0 +1,209 @@
+/*!
+ * \file pcache.c
+ * \brief Cache persistant des formes prédécodées (moteur rapide).
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pcache.h"
+#include "fast.h"
+#include "image.h"
+#include "arena.h"
+
+//! Calcul de la clé d'un fichier de programme
+bool pcache_key(const char *programfile, Pcache_Key *pkey)
+{
+    pkey->_filesize = 0;
+    int fd = open(programfile, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    // les octets au delà du dernier mot complet sont couverts par la taille
+    pkey->_key = image_checksum((const uint32_t *) map, st.st_size / sizeof(uint32_t));
+    pkey->_filesize = st.st_size;
+    munmap(map, st.st_size);
+    return true;
+}
+
+//! En-tête attendu pour une machine et une clé
+static Pcache_Header pcache_header(const Machine *pmach, const Pcache_Key *pkey)
+{
+    Pcache_Header h;
+    memset(&h, 0, sizeof(h));
+    h._magic = PCACHE_MAGIC;
+    h._version = PCACHE_VERSION;
+    h._decodedsize = sizeof(Decoded);
+    h._lastop = LAST_FAST_OP;
+    h._pagesize = FAST_PAGE_SIZE;
+    h._textsize = pmach->_textsize;
+    h._npages = (pmach->_textsize + FAST_PAGE_SIZE) >> FAST_PAGE_SHIFT;
+    h._key = pkey->_key;
+    h._filesize = pkey->_filesize;
+    return h;
+}
+
+//! Projection d'une forme prédécodée depuis le cache
+/*!
+ * \param path le fichier de cache
+ * \param expected l'en-tête attendu
+ * \param pmach la machine (son texte doit être celui de la copie du cache)
+ * \return la forme projetée, ou NULL (fichier absent, autre version, autre
+ * texte...)
+ */
+static Fast_Text *pcache_load(const char *path, const Pcache_Header *expected, const Machine *pmach)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    Pcache_Header h;
+    size_t codelen = (size_t) expected->_npages * FAST_PAGE_SIZE * sizeof(Decoded);
+    struct stat st;
+    size_t textlen = (size_t) expected->_textsize * sizeof(Instruction);
+    if (read(fd, &h, sizeof(h)) != (ssize_t) sizeof(h) || memcmp(&h, expected, sizeof(h)) != 0
+        || fstat(fd, &st) == -1 || (size_t) st.st_size < PCACHE_ALIGN + codelen + textlen)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // même clé ne suffit pas : le texte d'origine de la table doit être celui de la machine
+    char buf[4096];
+    const char *text = (const char *) pmach->_text;
+    off_t pos = (off_t) (PCACHE_ALIGN + codelen);
+    for (size_t done = 0; done < textlen; )
+    {
+        size_t chunk = textlen - done < sizeof(buf) ? textlen - done : sizeof(buf);
+        if (pread(fd, buf, chunk, pos + (off_t) done) != (ssize_t) chunk
+            || memcmp(buf, text + done, chunk) != 0)
+        {
+            close(fd);
+            return NULL;
+        }
+        done += chunk;
+    }
+
+    // projection privée : la table n'est jamais modifiée (toutes les pages sont décodées)
+    void *code = mmap(NULL, codelen, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, PCACHE_ALIGN);
+    close(fd);
+    if (code == MAP_FAILED)
+        return NULL;
+
+    Fast_Text *pfast = (Fast_Text *) arena_alloc(sizeof(Fast_Text));
+    pfast->_code = (Decoded *) code;
+    pfast->_codelen = codelen;
+    pfast->_textsize = expected->_textsize;
+    pfast->_npages = expected->_npages;
+    pfast->_ndecoded = expected->_npages;
+    pfast->_mapped = true;
+    return pfast;
+}
+
+//! Écriture d'une forme entièrement décodée dans le cache
+/*!
+ * Le fichier est écrit sous un nom temporaire puis renommé : un lecteur
+ * concurrent ne voit jamais de fichier partiel. Les erreurs sont ignorées.
+ *
+ * \param path le fichier de cache
+ * \param h l'en-tête
+ * \param pfast la forme prédécodée
+ * \param pmach la machine (son texte est recopié après la table)
+ */
+static void pcache_store(const char *path, const Pcache_Header *h, const Fast_Text *pfast,
+                         const Machine *pmach)
+{
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long) getpid()) >= (int) sizeof(tmp))
+        return;
+    int fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    if (fd == -1)
+        return;
+
+    char head[PCACHE_ALIGN];
+    memset(head, 0, sizeof(head));
+    memcpy(head, h, sizeof(*h));
+    size_t codelen = (size_t) pfast->_npages * FAST_PAGE_SIZE * sizeof(Decoded);
+    bool ok = write(fd, head, sizeof(head)) == (ssize_t) sizeof(head);
+    for (size_t done = 0; ok && done < codelen; )
+    {
+        ssize_t n = write(fd, (const char *) pfast->_code + done, codelen - done);
+        ok = n > 0;
+        done += ok ? (size_t) n : 0;
+    }
+    size_t textlen = (size_t) pmach->_textsize * sizeof(Instruction);
+    for (size_t done = 0; ok && done < textlen; )
+    {
+        ssize_t n = write(fd, (const char *) pmach->_text + done, textlen - done);
+        ok = n > 0;
+        done += ok ? (size_t) n : 0;
+    }
+    if (close(fd) == -1 || !ok || rename(tmp, path) == -1)
+        unlink(tmp);
+}
+
+//! Association d'une forme prédécodée en cache à une machine
+/*!
+ * \param pmach la machine, chargée depuis \c programfile
+ * \param programfile le fichier du programme
+ * \return vrai si la forme a été trouvée dans le cache
+ */
+bool pcache_attach(Machine *pmach, const char *programfile)
+{
+    const char *dir = getenv(PCACHE_ENV);
+    if (dir == NULL || *dir == '\0' || pmach->_fast != NULL)
+        return false;
+
+    Pcache_Key key;
+    return pcache_key(programfile, &key) && pcache_attach_key(pmach, &key);
+}
+
+//! Association d'une forme prédécodée en cache à une machine, clé calculée
+bool pcache_attach_key(Machine *pmach, const Pcache_Key *pkey)
+{
+    const char *dir = getenv(PCACHE_ENV);
+    if (dir == NULL || *dir == '\0' || pmach->_fast != NULL || pkey->_filesize == 0)
+        return false;
+    Pcache_Header h = pcache_header(pmach, pkey);
+
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%016llx-%llx.fpc", dir, (unsigned long long) pkey->_key,
+                 (unsigned long long) pkey->_filesize) >= (int) sizeof(path))
+        return false;
+
+    Fast_Text *pfast = pcache_load(path, &h, pmach);
+    if (pfast != NULL)
+    {
+        pmach->_fast = pfast;
+        return true;
+    }
+
+    // échec : décodage complet et mise en cache pour la prochaine fois
+    pfast = fast_prepare(pmach);
+    for (unsigned page = 0; page < pfast->_npages; ++page)
+        if (pfast->_code[page << FAST_PAGE_SHIFT]._op == F_LAZY)
+            fast_decode_page(pfast, pmach->_text, page << FAST_PAGE_SHIFT);
+    if (mkdir(dir, S_IRWXU|S_IRWXG|S_IRWXO) == 0 || errno == EEXIST)
+        pcache_store(path, &h, pfast, pmach);
+    return false;
+}
@@ -0,0 +1,105 @@
+#ifndef _PCACHE_H_
+#define _PCACHE_H_
+
+/*!
+ * \file pcache.h
+ * \brief Cache persistant des formes prédécodées (moteur rapide).
+ *
+ * La forme prédécodée complète d'un programme (voir fast.h : toutes les
+ * pages, avec les erreurs détectées statiquement et les boucles à compteur
+ * reconnues) est rangée dans un fichier du répertoire de cache, dont le nom
+ * est formé de la somme de contrôle (image_checksum()) et de la taille du
+ * fichier du programme. Aux exécutions suivantes du même programme, ce
+ * fichier est projeté en mémoire (\c mmap) et utilisé tel quel : il n'y a
+ * plus rien à décoder.
+ *
+ * Le fichier de cache commence par un en-tête (Pcache_Header) qui rappelle
+ * la clé et identifie la forme prédécodée (\c PCACHE_VERSION, taille de
+ * Decoded, dernier code prédécodé, taille des pages) ; la table commence à
+ * \c PCACHE_ALIGN octets et est suivie d'une copie du texte dont elle est
+ * issue. La clé (une somme de contrôle) ne fait que nommer le fichier : la
+ * table n'est utilisée que si cette copie est identique au texte de la
+ * machine, une collision de clés ne coûtant qu'un nouveau décodage. Un
+ * fichier absent, d'une autre version ou incohérent est simplement (ré)écrit :
+ * le cache est transparent. L'écriture passe par un fichier temporaire
+ * renommé, et ses échecs sont ignorés.
+ *
+ * Le cache n'est utilisé que si la variable d'environnement \c SIMUL_CACHE
+ * désigne un répertoire (créé si besoin).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "machine.h"
+
+//! Nombre magique d'un fichier de cache ("SPDC" lu en petit-boutiste)
+#define PCACHE_MAGIC 0x43445053u
+
+//! Version du format (à changer avec le prédécodage)
+#define PCACHE_VERSION 2
+
+//! Position de la table prédécodée dans le fichier (octets)
+#define PCACHE_ALIGN 4096
+
+//! Nom de la variable d'environnement désignant le répertoire de cache
+#define PCACHE_ENV "SIMUL_CACHE"
+
+//! En-tête d'un fichier de cache
+typedef struct
+{
+    uint32_t _magic;		//!< \c PCACHE_MAGIC
+    uint16_t _version;		//!< \c PCACHE_VERSION
+    uint8_t _decodedsize;	//!< sizeof(Decoded)
+    uint8_t _lastop;		//!< \c LAST_FAST_OP
+    uint32_t _pagesize;		//!< \c FAST_PAGE_SIZE
+    uint32_t _textsize;		//!< Taille du texte
+    uint32_t _npages;		//!< Nombre de pages de la table
+    uint32_t _reserved;		//!< Inutilisé (0)
+    uint64_t _key;		//!< Somme de contrôle du fichier du programme
+    uint64_t _filesize;		//!< Taille du fichier du programme
+} Pcache_Header;
+
+//! Clé d'un programme
+typedef struct
+{
+    uint64_t _key;		//!< Somme de contrôle du fichier
+    uint64_t _filesize;		//!< Taille du fichier (0 : fichier illisible, pas de cache)
+} Pcache_Key;
+
+//! Calcul de la clé d'un fichier de programme
+/*!
+ * Le fichier est lu en entier : un appelant qui charge plusieurs fois le même
+ * programme calcule sa clé une fois et utilise pcache_attach_key().
+ *
+ * \param programfile le fichier
+ * \param pkey la clé calculée (\c _filesize nul en cas d'échec)
+ * \return faux si le fichier ne peut être lu
+ */
+bool pcache_key(const char *programfile, Pcache_Key *pkey);
+
+//! Association d'une forme prédécodée en cache à une machine
+/*!
+ * Comme pcache_attach(), avec la clé déjà calculée du fichier du programme.
+ *
+ * \param pmach la machine, chargée depuis le fichier de clé \c pkey
+ * \param pkey la clé (pcache_key())
+ * \return vrai si la forme a été trouvée dans le cache
+ */
+bool pcache_attach_key(Machine *pmach, const Pcache_Key *pkey);
+
+//! Association d'une forme prédécodée en cache à une machine
+/*!
+ * Sans effet si le cache n'est pas activé (\c SIMUL_CACHE) ou si la machine
+ * a déjà une forme prédécodée. En cas de succès, \c pmach->_fast désigne la
+ * table projetée depuis le cache ; en cas d'échec du cache, la table est
+ * décodée entièrement puis écrite dans le cache pour les exécutions
+ * suivantes.
+ *
+ * \param pmach la machine, chargée depuis \c programfile
+ * \param programfile le fichier du programme
+ * \return vrai si la forme a été trouvée dans le cache
+ */
+bool pcache_attach(Machine *pmach, const char *programfile);
+
+#endif
@@ -0,0 +1,188 @@
+/*!
+ * \file profile.c
+ * \brief Profilage statistique du compteur ordinal par échantillonnage.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "profile.h"
+#include "instruction.h"
+
+//! Un échantillon
+typedef struct
+{
+    uint32_t _pc;		//!< Compteur ordinal relevé
+    uint32_t _depth;		//!< Nombre de mots occupés dans la pile
+} Sample;
+
+//! Cumul des échantillons d'une adresse
+typedef struct
+{
+    unsigned _pc;		//!< Adresse
+    uint64_t _count;		//!< Nombre d'échantillons
+    uint64_t _depthsum;		//!< Somme des profondeurs
+} Hot_Spot;
+
+//! État de l'échantillonnage (partagé avec le gestionnaire de signal)
+static struct
+{
+    const Machine *volatile _target; //!< Machine observée (NULL : pas d'échantillonnage)
+    Sample *_samples;		//!< Échantillons (\c PROFILE_MAXSAMPLES)
+    unsigned _nsamples;		//!< Échantillons reçus (indice d'écriture, avancé atomiquement)
+    unsigned _period;		//!< Période (microsecondes)
+    struct sigaction _oldaction; //!< Gestionnaire de SIGPROF précédent
+} prof;
+
+//! Gestionnaire de SIGPROF
+/*!
+ * Ne fait qu'un relevé : pas d'appel de bibliothèque, pas d'allocation.
+ */
+static void profile_handler(int sig)
+{
+    (void) sig;
+    const Machine *pmach = prof._target;
+    if (pmach == NULL)
+        return;
+
+    unsigned i = __atomic_fetch_add(&prof._nsamples, 1, __ATOMIC_RELAXED);
+    if (i < PROFILE_MAXSAMPLES)
+    {
+        prof._samples[i]._pc = pmach->_pc;
+        prof._samples[i]._depth = pmach->_stackhigh - 1 - pmach->_sp;
+    }
+}
+
+//! Début de l'échantillonnage
+/*!
+ * \param pmach la machine observée
+ * \param period la période d'échantillonnage en microsecondes (0 : défaut)
+ */
+void profile_start(const Machine *pmach, unsigned period)
+{
+    free(prof._samples);
+    prof._samples = (Sample *) malloc(PROFILE_MAXSAMPLES * sizeof(Sample));
+    if (prof._samples == NULL)
+    {
+        perror("profile_start.malloc");
+        exit(EXIT_FAILURE);
+    }
+    prof._nsamples = 0;
+    prof._period = period > 0 ? period : PROFILE_DEFPERIOD;
+    prof._target = pmach;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profile_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &prof._oldaction) == -1)
+    {
+        perror("profile_start.sigaction");
+        exit(EXIT_FAILURE);
+    }
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = prof._period / 1000000;
+    timer.it_interval.tv_usec = prof._period % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) == -1)
+    {
+        perror("profile_start.setitimer");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//! Fin de l'échantillonnage
+void profile_stop(void)
+{
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    prof._target = NULL;
+    sigaction(SIGPROF, &prof._oldaction, NULL);
+}
+
+//! Comparaison de deux échantillons par adresse (qsort())
+static int cmp_sample_pc(const void *a, const void *b)
+{
+    uint32_t pa = ((const Sample *) a)->_pc, pb = ((const Sample *) b)->_pc;
+    return pa < pb ? -1 : pa > pb;
+}
+
+//! Comparaison de deux points chauds par nombre d'échantillons décroissant (qsort())
+static int cmp_hot_count(const void *a, const void *b)
+{
+    const Hot_Spot *ha = (const Hot_Spot *) a, *hb = (const Hot_Spot *) b;
+    if (ha->_count != hb->_count)
+        return ha->_count > hb->_count ? -1 : 1;
+    return ha->_pc < hb->_pc ? -1 : ha->_pc > hb->_pc;
+}
+
+//! Affichage des points chauds
+/*!
+ * \param out le flot de sortie
+ * \param pmach la machine observée
+ */
+void profile_report(FILE *out, const Machine *pmach)
+{
+    unsigned received = prof._nsamples;
+    unsigned n = received < PROFILE_MAXSAMPLES ? received : PROFILE_MAXSAMPLES;
+
+    fprintf(out, "\n*** PROFILE ***\n");
+    fprintf(out, "%u samples every %u us of CPU time", received, prof._period);
+    if (received > n)
+        fprintf(out, " (%u dropped)", received - n);
+    fputc('\n', out);
+    if (n == 0 || prof._samples == NULL)
+    {
+        free(prof._samples);
+        prof._samples = NULL;
+        return;
+    }
+
+    // regroupement par adresse
+    qsort(prof._samples, n, sizeof(Sample), cmp_sample_pc);
+    Hot_Spot *spots = (Hot_Spot *) malloc(n * sizeof(Hot_Spot));
+    if (spots == NULL)
+    {
+        perror("profile_report.malloc");
+        exit(EXIT_FAILURE);
+    }
+    unsigned nspots = 0;
+    uint32_t maxdepth = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (nspots == 0 || spots[nspots - 1]._pc != prof._samples[i]._pc)
+            spots[nspots++] = (Hot_Spot) { prof._samples[i]._pc, 0, 0 };
+        spots[nspots - 1]._count++;
+        spots[nspots - 1]._depthsum += prof._samples[i]._depth;
+        if (prof._samples[i]._depth > maxdepth)
+            maxdepth = prof._samples[i]._depth;
+    }
+    qsort(spots, nspots, sizeof(Hot_Spot), cmp_hot_count);
+
+    fprintf(out, "%u distinct addresses, maximal stack depth %u\n", nspots, maxdepth);
+    fprintf(out, "\nHot spots (top %d):\n", PROFILE_TOPPC);
+    fprintf(out, "%-8s %10s %8s %7s  %s\n", "pc", "samples", "share", "depth", "instruction");
+    for (unsigned i = 0; i < nspots && i < PROFILE_TOPPC; ++i)
+    {
+        char buf[DISASM_MAXLEN + 1] = "(out of text)";
+        if (spots[i]._pc < pmach->_textsize)
+            buf[format_instruction(buf, pmach->_text[spots[i]._pc], spots[i]._pc)] = '\0';
+        fprintf(out, "0x%04x   %10llu %7.2f%% %7.1f  %s\n", spots[i]._pc,
+                (unsigned long long) spots[i]._count, 100.0 * spots[i]._count / n,
+                (double) spots[i]._depthsum / spots[i]._count, buf);
+    }
+    putc('\n', out);
+
+    free(spots);
+    free(prof._samples);
+    prof._samples = NULL;
+    prof._nsamples = 0;
+}
@@ -0,0 +1,77 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/*!
+ * \file profile.h
+ * \brief Profilage statistique du compteur ordinal par échantillonnage.
+ *
+ * Un minuteur de l'hôte (\c setitimer, \c ITIMER_PROF) envoie périodiquement
+ * le signal \c SIGPROF au processus ; le gestionnaire relève le compteur
+ * ordinal et la profondeur de pile de la machine observée et les range dans
+ * un tableau préalloué, dont l'indice est avancé atomiquement (pas de
+ * verrou, pas d'allocation dans le gestionnaire). La boucle d'exécution
+ * n'est pas modifiée : le coût est celui du gestionnaire, quelques
+ * microsecondes par échantillon, soit bien moins de 1 % à la période par
+ * défaut.
+ *
+ * Les échantillons sont regroupés par adresse à la fin de l'exécution
+ * (profile_report()) : les instructions les plus souvent échantillonnées
+ * sont affichées avec leur désassemblage.
+ *
+ * \note Le compteur ordinal relevé est celui que le moteur a rangé en
+ * mémoire au moment du signal : en général l'adresse de l'instruction qui
+ * suit celle en cours. La profondeur est le nombre de mots occupés dans la
+ * pile (adresses de retour et valeurs empilées) ; elle mesure la profondeur
+ * d'appel des programmes qui n'empilent que des adresses de retour.
+ *
+ * La période effective est arrondie à la résolution de l'horloge du noyau
+ * pour les minuteurs de temps processeur (souvent 1 à 4 ms).
+ *
+ * \attention Une seule machine est observée à la fois, par un seul thread
+ * (le signal est reçu par un thread quelconque du processus) : le profilage
+ * n'est pas disponible en multiprocesseur.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "machine.h"
+
+//! Période d'échantillonnage par défaut (microsecondes de temps processeur)
+#define PROFILE_DEFPERIOD 1000
+
+//! Nombre maximal d'échantillons gardés (les suivants sont comptés, pas rangés)
+#define PROFILE_MAXSAMPLES (1u << 20)
+
+//! Nombre d'instructions affichées par profile_report()
+#define PROFILE_TOPPC 20
+
+//! Début de l'échantillonnage
+/*!
+ * \param pmach la machine observée (elle doit le rester jusqu'à
+ * profile_stop())
+ * \param period la période d'échantillonnage en microsecondes (0 : \c
+ * PROFILE_DEFPERIOD)
+ */
+void profile_start(const Machine *pmach, unsigned period);
+
+//! Fin de l'échantillonnage
+/*!
+ * Le minuteur est arrêté et le gestionnaire de signal précédent rétabli ;
+ * les échantillons sont gardés pour profile_report().
+ */
+void profile_stop(void);
+
+//! Affichage des points chauds
+/*!
+ * Nombre d'échantillons (et d'échantillons perdus), puis les \c
+ * PROFILE_TOPPC adresses les plus échantillonnées avec leur part, la
+ * profondeur de pile moyenne et le désassemblage de l'instruction. Les
+ * échantillons sont ensuite libérés.
+ *
+ * \param out le flot de sortie
+ * \param pmach la machine observée
+ */
+void profile_report(FILE *out, const Machine *pmach);
+
+#endif
@@ -0,0 +1,221 @@
+/*!
+ * \file share.c
+ * \brief Images de programmes partagées entre machines.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "share.h"
+#include "fast.h"
+#include "pcache.h"
+#include "arena.h"
+
+//! Registre des images ouvertes
+static Shared_Image *images;
+
+//! Verrou du registre et des compteurs de références
+static pthread_mutex_t images_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//! Chargement d'une image (hors registre)
+/*!
+ * \param pimage l'image à remplir
+ * \param programfile le fichier du programme
+ */
+static void share_read(Shared_Image *pimage, const char *programfile)
+{
+    Machine *pmodel = &pimage->_model;
+    map_program(pmodel, programfile);
+
+    // données initiales (pile comprise) dans un fichier anonyme
+    pimage->_datasize = pmodel->_datasize;
+    pimage->_dataend = pmodel->_dataend;
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    size_t len = (size_t) pmodel->_datasize * sizeof(Word);
+    pimage->_datalen = (len + pagesize - 1) / pagesize * pagesize;
+    pimage->_datafd = memfd_create("simul-data", MFD_CLOEXEC);
+    if (pimage->_datafd == -1)
+    {
+        perror("share_read.memfd_create");
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(pimage->_datafd, pimage->_datalen) == -1)
+    {
+        perror("share_read.ftruncate");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t done = 0; done < len; )
+    {
+        ssize_t n = pwrite(pimage->_datafd, (const char *) pmodel->_data + done, len - done, done);
+        if (n <= 0)
+        {
+            perror("share_read.pwrite");
+            exit(EXIT_FAILURE);
+        }
+        done += n;
+    }
+
+    // le modèle ne garde que le texte
+    arena_release(pmodel->_data);
+    pmodel->_data = NULL;
+}
+
+//! Destruction d'une image (retirée du registre, plus aucune référence)
+static void share_destroy(Shared_Image *pimage)
+{
+    machine_free(&pimage->_model);
+    close(pimage->_datafd);
+    free(pimage);
+}
+
+//! Ouverture de l'image partagée d'un programme
+/*!
+ * \param programfile le fichier du programme
+ * \param fast préparer la forme prédécodée ?
+ * \return l'image (à fermer par share_close())
+ */
+Shared_Image *share_open(const char *programfile, bool fast)
+{
+    struct stat st;
+    if (stat(programfile, &st) == -1)
+    {
+        perror("share_open.stat");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_mutex_lock(&images_lock);
+    Shared_Image *pimage;
+    for (pimage = images; pimage != NULL; pimage = pimage->_next)
+        if (pimage->_dev == st.st_dev && pimage->_ino == st.st_ino
+            && pimage->_size == st.st_size && pimage->_mtime == st.st_mtime)
+            break;
+
+    if (pimage == NULL)
+    {
+        pimage = (Shared_Image *) malloc(sizeof(Shared_Image));
+        if (pimage == NULL)
+        {
+            perror("share_open.malloc");
+            exit(EXIT_FAILURE);
+        }
+        share_read(pimage, programfile);
+        pimage->_dev = st.st_dev;
+        pimage->_ino = st.st_ino;
+        pimage->_size = st.st_size;
+        pimage->_mtime = st.st_mtime;
+        pimage->_refs = 0;
+        pimage->_next = images;
+        images = pimage;
+    }
+    pimage->_refs++;
+
+    // forme prédécodée complète : les machines la lisent sans jamais la modifier
+    if (fast && pimage->_model._fast == NULL && !pcache_attach(&pimage->_model, programfile))
+    {
+        Fast_Text *pfast = fast_prepare(&pimage->_model);
+        for (unsigned page = 0; page < pfast->_npages; ++page)
+            if (pfast->_code[page << FAST_PAGE_SHIFT]._op == F_LAZY)
+                fast_decode_page(pfast, pimage->_model._text, page << FAST_PAGE_SHIFT);
+    }
+    pthread_mutex_unlock(&images_lock);
+    return pimage;
+}
+
+//! Abandon d'une référence à une image (verrou pris)
+static void share_unref(Shared_Image *pimage)
+{
+    if (--pimage->_refs > 0)
+        return;
+    Shared_Image **pp = &images;
+    while (*pp != pimage)
+        pp = &(*pp)->_next;
+    *pp = pimage->_next;
+    share_destroy(pimage);
+}
+
+//! Fermeture d'une image partagée
+/*!
+ * \param pimage l'image (détruite si plus aucune machine ne l'utilise)
+ */
+void share_close(Shared_Image *pimage)
+{
+    pthread_mutex_lock(&images_lock);
+    share_unref(pimage);
+    pthread_mutex_unlock(&images_lock);
+}
+
+//! Chargement d'une machine depuis une image partagée
+/*!
+ * \param pmach la machine
+ * \param pimage l'image
+ */
+void share_load(Machine *pmach, Shared_Image *pimage)
+{
+    // données : projection privée, copiée page par page à l'écriture
+    Word *data = (Word *) mmap(NULL, pimage->_datalen, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                               pimage->_datafd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("share_load.mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    pmach->_text = pimage->_model._text;
+    pmach->_textsize = pimage->_model._textsize;
+    pmach->_textmap = NULL;
+    pmach->_textmaplen = 0;
+    pmach->_data = data;
+    pmach->_datasize = pimage->_datasize;
+    pmach->_dataend = pimage->_dataend;
+    machine_reset(pmach);
+
+    pthread_mutex_lock(&images_lock);
+    pimage->_refs++;
+    pmach->_fast = pimage->_model._fast;
+    pthread_mutex_unlock(&images_lock);
+    pmach->_image = pimage;
+}
+
+//! Détachement d'une machine de son image partagée
+/*!
+ * \param pmach la machine
+ */
+void share_unload(Machine *pmach)
+{
+    Shared_Image *pimage = pmach->_image;
+    munmap(pmach->_data, pimage->_datalen);
+    pmach->_image = NULL;
+
+    pthread_mutex_lock(&images_lock);
+    if (pmach->_fast != pimage->_model._fast)
+        fast_release(pmach->_fast); // préparée par la machine, pas par share_open()
+    pmach->_fast = NULL;
+    share_unref(pimage);
+    pthread_mutex_unlock(&images_lock);
+}
+
+//! Statistiques du registre
+Share_Stats share_stats(void)
+{
+    Share_Stats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    pthread_mutex_lock(&images_lock);
+    for (Shared_Image *pimage = images; pimage != NULL; pimage = pimage->_next)
+    {
+        stats._images++;
+        stats._textbytes += (size_t) pimage->_model._textsize * sizeof(Instruction);
+        if (pimage->_model._fast != NULL)
+            stats._fastbytes += (size_t) pimage->_model._fast->_npages * FAST_PAGE_SIZE * sizeof(Decoded);
+        stats._databytes += pimage->_datalen;
+    }
+    pthread_mutex_unlock(&images_lock);
+    return stats;
+}
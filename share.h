@@ -0,0 +1,107 @@
+#ifndef _SHARE_H_
+#define _SHARE_H_
+
+/*!
+ * \file share.h
+ * \brief Images de programmes partagées entre machines.
+ *
+ * Quand de nombreuses machines exécutent le même programme, chacune n'a
+ * besoin en propre que de ses registres et des pages de données qu'elle
+ * modifie. Une image partagée (Shared_Image) contient, chargés une seule
+ * fois :
+ *
+ *   - le segment de texte (projeté depuis le fichier, voir map_program()) ;
+ *
+ *   - sa forme prédécodée complète pour le moteur rapide (éventuellement
+ *   projetée depuis le cache, voir pcache.h), jamais modifiée ensuite ;
+ *
+ *   - le contenu initial du segment de données (pile comprise), rangé dans
+ *   un fichier anonyme en mémoire (\c memfd_create).
+ *
+ * Une machine chargée depuis l'image (share_load()) utilise le texte et la
+ * forme prédécodée sans copie ; son segment de données est une projection
+ * privée du contenu initial : ses pages sont partagées tant qu'elles ne sont
+ * que lues et copiées par le système à la première écriture.
+ *
+ * Les images sont rangées dans un registre (protégé par un verrou) où elles
+ * sont identifiées par le fichier du programme (périphérique, inode, taille
+ * et date) : ouvrir deux fois le même fichier donne la même image. Une image
+ * compte ses références (ouvertures et machines chargées) et disparaît avec
+ * la dernière.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "machine.h"
+
+//! Image de programme partagée
+typedef struct Shared_Image
+{
+    Machine _model;		//!< Machine modèle : texte et forme prédécodée (sans données)
+    unsigned _datasize;		//!< Taille du segment de données (pile comprise)
+    unsigned _dataend;		//!< Fin des données statiques
+    int _datafd;		//!< Fichier anonyme contenant les données initiales
+    size_t _datalen;		//!< Taille de ce fichier (octets, multiple de la page)
+    dev_t _dev;			//!< Périphérique du fichier du programme
+    ino_t _ino;			//!< Inode du fichier du programme
+    off_t _size;		//!< Taille du fichier du programme
+    time_t _mtime;		//!< Date de modification du fichier du programme
+    unsigned _refs;		//!< Nombre de références (ouvertures et machines)
+    struct Shared_Image *_next;	//!< Image suivante du registre
+} Shared_Image;
+
+//! Ouverture de l'image partagée d'un programme
+/*!
+ * L'image est cherchée dans le registre, et chargée si elle n'y est pas.
+ * Avec \c fast, sa forme prédécodée est préparée (entièrement) si elle ne
+ * l'est pas encore. Les erreurs de lecture sont fatales, comme pour
+ * read_program().
+ *
+ * \param programfile le fichier du programme
+ * \param fast préparer la forme prédécodée ?
+ * \return l'image (à fermer par share_close())
+ */
+Shared_Image *share_open(const char *programfile, bool fast);
+
+//! Fermeture d'une image partagée
+/*!
+ * \param pimage l'image (détruite si plus aucune machine ne l'utilise)
+ */
+void share_close(Shared_Image *pimage);
+
+//! Chargement d'une machine depuis une image partagée
+/*!
+ * La machine est initialisée comme par read_program() ; elle doit être neuve
+ * ou avoir été libérée par machine_free(), qui la détache de l'image.
+ *
+ * \param pmach la machine
+ * \param pimage l'image
+ */
+void share_load(Machine *pmach, Shared_Image *pimage);
+
+//! Détachement d'une machine de son image partagée (appelé par machine_free())
+/*!
+ * Le segment de données privé est supprimé ; le texte et la forme
+ * prédécodée de l'image lui restent. Une forme prédécodée construite par la
+ * machine elle-même (image ouverte sans forme prédécodée) est rendue par
+ * fast_release().
+ *
+ * \param pmach la machine
+ */
+void share_unload(Machine *pmach);
+
+//! Statistiques du registre
+typedef struct
+{
+    unsigned _images;		//!< Nombre d'images ouvertes
+    size_t _textbytes;		//!< Taille cumulée des textes (octets)
+    size_t _fastbytes;		//!< Taille cumulée des formes prédécodées (octets)
+    size_t _databytes;		//!< Taille cumulée des données initiales (octets)
+} Share_Stats;
+
+//! Statistiques du registre
+Share_Stats share_stats(void);
+
+#endif
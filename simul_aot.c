@@ -0,0 +1,504 @@
+/*!
+ * \file simul_aot.c
+ * \brief Traduction d'un programme binaire (.bin) en un source C autonome
+ *
+ * Le programme est lu par read_program() puis chacune de ses instructions
+ * est prédécodée (predecode()). Chaque bloc de base devient une suite
+ * d'instructions C sur un banc de registres local (\c R[], \c cc) ; les
+ * branchements à adresse absolue deviennent des \c goto, les branchements
+ * indexés et les \c RET passent par un \c switch sur le compteur ordinal.
+ * Tous les contrôles des moteurs d'exécution sont conservés (mêmes appels à
+ * error(), mêmes adresses signalées, même compteur d'instructions).
+ *
+ * Le source produit contient le texte et les données initiales (sous forme
+ * de tableaux C, seuls les mots de données non nuls étant écrits) et une
+ * fonction main() qui exécute le programme traduit et affiche l'état final
+ * comme test_simul. Il se compile avec les modules du simulateur (\c
+ * -I. et \c $(USEROBJ), voir la règle \c %.aot de la Makefile). Avec
+ * l'option \c -c, l'exécutable produit exécute aussi le programme avec
+ * l'interpréteur (simul()) et compare les deux états finaux.
+ *
+ * \note Une destination dynamique (\c RET, branchement indexé) qui n'est pas
+ * un début de bloc connu est confiée au moteur rapide (simul_fast()), qui
+ * termine l'exécution. Si le programme contient des branchements indexés,
+ * chaque instruction est un début de bloc.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "fast.h"
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_aot input.bin output.c\n");
+    printf("where options are:\n"
+           "\t-h\tprint this help message\n");
+}
+
+//! Expression C d'une condition de branchement (en fonction de \c cc)
+static const char *cond_exprs[] = {
+    "1",				// NC
+    "cc == CC_Z",			// EQ
+    "cc != CC_Z",			// NE
+    "cc == CC_P",			// GT
+    "(cc == CC_P || cc == CC_Z)",	// GE
+    "cc == CC_N",			// LT
+    "(cc == CC_N || cc == CC_Z)",	// LE
+};
+
+//! L'exécution peut-elle continuer en séquence après cette instruction ?
+static bool falls_through(const Decoded *d)
+{
+    switch (d->_op)
+    {
+        case F_ILLOP:
+        case F_UNKNOWN:
+        case F_IMMERR:
+        case F_HALT:
+        case F_RET:
+        case F_JUMP_A:
+            return false;
+        case F_BRANCH_A:
+        case F_BRANCH_X:
+        case F_CALL_A:
+        case F_CALL_X:
+            return d->_reg <= LAST_CONDITION;
+        default:
+            return true;
+    }
+}
+
+//! Calcul des débuts de blocs de base
+/*!
+ * \param code le texte prédécodé
+ * \param textsize sa taille
+ * \param leader les débuts de blocs (résultat)
+ */
+static void find_leaders(const Decoded *code, unsigned textsize, bool leader[])
+{
+    bool indirect = false;
+
+    memset(leader, 0, textsize * sizeof(bool));
+    if (textsize > 0)
+        leader[0] = true;
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        const Decoded *d = &code[i];
+        switch (d->_op)
+        {
+            case F_JUMP_A:
+            case F_BRANCH_A:
+            case F_CALL_A:
+                if ((unsigned) d->_operand < textsize)
+                    leader[d->_operand] = true;
+                break;
+            case F_BRANCH_X:
+            case F_CALL_X:
+                indirect = true;
+                break;
+            default:
+                break;
+        }
+        // après un transfert de contrôle (adresse de retour d'un CALL comprise)
+        // et après TRAP, qui peut arrêter le programme
+        if (i + 1 < textsize && (!falls_through(d) || d->_op == F_BRANCH_A || d->_op == F_BRANCH_X
+                                 || d->_op == F_CALL_A || d->_op == F_CALL_X || d->_op == F_TRAP))
+            leader[i + 1] = true;
+    }
+    if (indirect)
+        for (unsigned i = 0; i < textsize; ++i)
+            leader[i] = true;
+}
+
+//! Production de l'adresse (C) de l'opérande mémoire d'une instruction
+static void print_address(FILE *out, const Decoded *d, bool indexed)
+{
+    if (indexed)
+        fprintf(out, "R[%u] + %d", d->_rindex, d->_operand);
+    else
+        fprintf(out, "%uu", (unsigned) d->_operand);
+}
+
+//! Production de la lecture de l'opérande (immédiat, absolu ou indexé)
+static void print_operand(FILE *out, const Decoded *d, int mode, unsigned next)
+{
+    if (mode == 0)
+        fprintf(out, "(Word) %d", d->_operand);
+    else
+    {
+        fprintf(out, "read_data(pmach, ");
+        print_address(out, d, mode == 2);
+        fprintf(out, ", %u)", next);
+    }
+}
+
+//! Production d'un saut vers une adresse absolue
+static void print_jump(FILE *out, unsigned target, unsigned textsize)
+{
+    if (target < textsize)
+        fprintf(out, "goto pc_%u;", target);
+    else
+        fprintf(out, "error(ERR_SEGTEXT, %u);", target);
+}
+
+//! Traduction d'une instruction
+/*!
+ * \param out le flot de sortie
+ * \param d l'instruction prédécodée
+ * \param addr son adresse
+ * \param textsize la taille du texte
+ */
+static void translate(FILE *out, const Decoded *d, unsigned addr, unsigned textsize)
+{
+    unsigned next = addr + 1; // adresse signalée en cas d'erreur (comme _pc)
+    unsigned r = d->_reg;
+    int mode = -1; // 0 : immédiat, 1 : absolu, 2 : indexé
+
+    switch (d->_op)
+    {
+        case F_LOAD_I: case F_ADD_I: case F_SUB_I: case F_PUSH_I: case F_ALU_I: case F_CMP_I:
+            mode = 0;
+            break;
+        case F_LOAD_X: case F_STORE_X: case F_ADD_X: case F_SUB_X: case F_BRANCH_X: case F_CALL_X:
+        case F_PUSH_X: case F_POP_X: case F_XCHG_X: case F_FADD_X: case F_ALU_X: case F_CMP_X:
+            mode = 2;
+            break;
+        default:
+            mode = 1;
+            break;
+    }
+
+    fprintf(out, "    ");
+    switch (d->_op)
+    {
+        case F_ILLOP: fprintf(out, "error(ERR_ILLEGAL, %u);\n", next); return;
+        case F_IMMERR: fprintf(out, "error(ERR_IMMEDIATE, %u);\n", next); return;
+        case F_UNKNOWN: fprintf(out, "error(ERR_UNKNOWN, %u);\n", next); return;
+        case F_NOP: fprintf(out, "/* NOP */\n"); return;
+        case F_HALT: fprintf(out, "pc = %u; goto halt;\n", next); return;
+
+        case F_LOAD_I: case F_LOAD_A: case F_LOAD_X:
+            fprintf(out, "R[%u] = ", r);
+            print_operand(out, d, mode, next);
+            fprintf(out, "; cc = cc_of(R[%u]);\n", r);
+            return;
+        case F_STORE_A: case F_STORE_X:
+            fprintf(out, "write_data(pmach, ");
+            print_address(out, d, mode == 2);
+            fprintf(out, ", R[%u], %u);\n", r, next);
+            return;
+        case F_ADD_I: case F_ADD_A: case F_ADD_X:
+        case F_SUB_I: case F_SUB_A: case F_SUB_X:
+            fprintf(out, "R[%u] %s= ", r, d->_op >= F_SUB_I ? "-" : "+");
+            print_operand(out, d, mode, next);
+            fprintf(out, "; cc = cc_of(R[%u]);\n", r);
+            return;
+        case F_ALU_I: case F_ALU_A: case F_ALU_X:
+            fprintf(out, "R[%u] = alu_compute(%s, R[%u], ", r, cop_names[d->_aux], r);
+            print_operand(out, d, mode, next);
+            fprintf(out, ", %u); cc = cc_of(R[%u]);\n", next, r);
+            return;
+        case F_CMP_I: case F_CMP_A: case F_CMP_X:
+            fprintf(out, "cc = cc_of(R[%u] - ", r);
+            print_operand(out, d, mode, next);
+            fprintf(out, ");\n");
+            return;
+
+        case F_JUMP_A:
+            print_jump(out, d->_operand, textsize);
+            fprintf(out, "\n");
+            return;
+        case F_BRANCH_A: case F_BRANCH_X:
+        case F_CALL_A: case F_CALL_X:
+        {
+            bool call = d->_op == F_CALL_A || d->_op == F_CALL_X;
+            if (call)
+                fprintf(out, "CHECK_SP(%u); ", next);
+            if (r > LAST_CONDITION)
+            {
+                fprintf(out, "error(ERR_CONDITION, %u);\n", next);
+                return;
+            }
+            fprintf(out, "if (%s) { ", cond_exprs[r]);
+            if (call)
+                fprintf(out, "pmach->_data[R[15]--] = %u; ", next);
+            if (mode == 2)
+                fprintf(out, "pc = R[%u] + %d; goto dispatch; }\n", d->_rindex, d->_operand);
+            else
+            {
+                print_jump(out, d->_operand, textsize);
+                fprintf(out, " }\n");
+            }
+            return;
+        }
+        case F_RET:
+            fprintf(out, "CHECK_SP(%u); pc = pmach->_data[++R[15]]; goto dispatch;\n", next);
+            return;
+
+        case F_PUSH_I: case F_PUSH_A: case F_PUSH_X:
+            fprintf(out, "{ Word v; ");
+            if (mode == 2) // adresse calculée avant le contrôle de SP (comme simul_fast())
+            {
+                fprintf(out, "unsigned a = ");
+                print_address(out, d, true);
+                fprintf(out, "; CHECK_SP(%u); v = read_data(pmach, a, %u); ", next, next);
+            }
+            else
+            {
+                fprintf(out, "CHECK_SP(%u); v = ", next);
+                print_operand(out, d, mode, next);
+                fprintf(out, "; ");
+            }
+            fprintf(out, "pmach->_data[R[15]--] = v; }\n");
+            return;
+        case F_POP_A: case F_POP_X:
+            fprintf(out, "{ unsigned a = ");
+            print_address(out, d, mode == 2);
+            fprintf(out, "; CHECK_SP(%u); write_data(pmach, a, pmach->_data[++R[15]], %u); }\n",
+                    next, next);
+            return;
+
+        case F_XCHG_A: case F_XCHG_X:
+        case F_FADD_A: case F_FADD_X:
+            fprintf(out, "R[%u] = %s(atomic_word(pmach, ", r,
+                    d->_op <= F_XCHG_X ? "atomic_exchange_word" : "atomic_fetch_add_word");
+            print_address(out, d, mode == 2);
+            fprintf(out, ", %u), R[%u]); cc = cc_of(R[%u]);\n", next, r, r);
+            return;
+
+        case F_MOVE:
+        case F_FILL:
+            fprintf(out, "%s(pmach, R[%u], R[%u], R[%u], %u);\n",
+                    d->_op == F_MOVE ? "block_move" : "block_fill", d->_reg, d->_rindex, d->_aux, next);
+            return;
+
+        case F_TRAP: // le service voit et modifie les registres de la machine
+            fprintf(out, "memcpy(pmach->_registers, R, sizeof(R));\n"
+                    "    running = trap_call(pmach, %d, %u);\n"
+                    "    memcpy(R, pmach->_registers, sizeof(R));\n"
+                    "    cc = pmach->_cc;\n"
+                    "    if (!running) { pc = %u; goto halt; }\n", d->_operand, next, next);
+            return;
+
+        default:
+            fprintf(out, "error(ERR_UNKNOWN, %u);\n", next);
+            return;
+    }
+}
+
+//! Prologue du source produit (tout ce qui ne dépend pas du programme)
+static const char prologue[] =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "#include \"machine.h\"\n"
+    "#include \"exec.h\"\n"
+    "#include \"fast.h\"\n"
+    "#include \"trap.h\"\n"
+    "\n"
+    "//! Code condition correspondant à une valeur\n"
+    "static inline unsigned cc_of(Word v)\n"
+    "{\n"
+    "    return (int32_t) v < 0 ? CC_N : v != 0 ? CC_P : CC_Z;\n"
+    "}\n"
+    "\n"
+    "//! Contrôle du pointeur de pile (registre local R[15])\n"
+    "#define CHECK_SP(addr) \\\n"
+    "    do { if (R[15] < pmach->_stacklow || R[15] >= pmach->_stackhigh) error(ERR_SEGSTACK, addr); } while (0)\n"
+    "\n";
+
+//! Comparaison de l'état final avec celui de l'interpréteur
+static const char epilogue[] =
+    "//! Comparaison avec l'état final de l'interpréteur\n"
+    "static int check(Machine *pmach)\n"
+    "{\n"
+    "    Machine ref;\n"
+    "    int diffs = 0;\n"
+    "\n"
+    "    load_program(&ref, textsize, text, datasize, data, dataend);\n"
+    "    trace_enabled = false;\n"
+    "    simul(&ref, false);\n"
+    "\n"
+    "    for (unsigned i = 0; i < NREGISTERS; ++i)\n"
+    "        if (pmach->_registers[i] != ref._registers[i])\n"
+    "            diffs++, printf(\"check: R%02u = 0x%08x, interpreter 0x%08x\\n\", i,\n"
+    "                            pmach->_registers[i], ref._registers[i]);\n"
+    "    if (pmach->_pc != ref._pc || pmach->_cc != ref._cc || pmach->_icount != ref._icount)\n"
+    "        diffs++, printf(\"check: pc %u cc %u icount %llu, interpreter pc %u cc %u icount %llu\\n\",\n"
+    "                        pmach->_pc, pmach->_cc, (unsigned long long) pmach->_icount,\n"
+    "                        ref._pc, ref._cc, (unsigned long long) ref._icount);\n"
+    "    for (unsigned i = 0; i < pmach->_datasize; ++i)\n"
+    "        if (pmach->_data[i] != ref._data[i])\n"
+    "            diffs++, printf(\"check: data[0x%04x] = 0x%08x, interpreter 0x%08x\\n\", i,\n"
+    "                            pmach->_data[i], ref._data[i]);\n"
+    "    printf(\"check: %s\\n\", diffs == 0 ? \"same final state as the interpreter\" : \"MISMATCH\");\n"
+    "    machine_free(&ref);\n"
+    "    return diffs == 0 ? EXIT_SUCCESS : EXIT_FAILURE;\n"
+    "}\n"
+    "\n"
+    "int main(int argc, char *argv[])\n"
+    "{\n"
+    "    Machine mach;\n"
+    "\n"
+    "    load_program(&mach, textsize, text, datasize, data, dataend);\n"
+    "    run(&mach);\n"
+    "\n"
+    "    printf(\"\\n*** Machine state after execution ***\\n\");\n"
+    "    print_cpu(&mach);\n"
+    "    print_data(&mach);\n"
+    "\n"
+    "    int status = (int) mach._status; // code de retour du programme (TRAP_EXIT)\n"
+    "    if (argc > 1 && strcmp(argv[1], \"-c\") == 0)\n"
+    "        status = check(&mach);\n"
+    "    machine_free(&mach);\n"
+    "    return status;\n"
+    "}\n";
+
+//! Production du source C d'un programme
+/*!
+ * \param out le flot de sortie
+ * \param pmach la machine chargée avec le programme
+ * \param name le nom du fichier d'origine (commentaire)
+ */
+static void emit(FILE *out, Machine *pmach, const char *name)
+{
+    unsigned textsize = pmach->_textsize;
+    Decoded *code = (Decoded *) malloc((textsize + 1) * sizeof(Decoded));
+    bool *leader = (bool *) malloc((textsize + 1) * sizeof(bool));
+    if (code == NULL || leader == NULL)
+    {
+        perror("emit.malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned i = 0; i < textsize; ++i)
+        code[i] = predecode(pmach->_text[i]);
+    find_leaders(code, textsize, leader);
+
+    fprintf(out, "/* Traduction de %s par simul_aot */\n\n%s", name, prologue);
+
+    // texte et données initiales
+    fprintf(out, "static const unsigned textsize = %u, datasize = %u, dataend = %u;\n\n",
+            textsize, pmach->_datasize, pmach->_dataend);
+    fprintf(out, "static Instruction text[%u] = {", textsize + 1);
+    for (unsigned i = 0; i < textsize; ++i)
+        fprintf(out, "%s{ 0x%08x }, ", i % 6 == 0 ? "\n    " : "", pmach->_text[i]._raw);
+    fprintf(out, "\n};\n\nstatic Word data[%u] = {", pmach->_datasize + 1);
+    unsigned col = 0;
+    for (unsigned i = 0; i < pmach->_datasize; ++i)
+        if (pmach->_data[i] != 0)
+            fprintf(out, "%s[%u] = 0x%08x, ", col++ % 4 == 0 ? "\n    " : "", i, pmach->_data[i]);
+    fprintf(out, "\n};\n\n");
+
+    // programme traduit
+    fprintf(out, "//! Exécution du programme traduit\n"
+            "static void run(Machine *pmach)\n{\n"
+            "    Word R[NREGISTERS];\n"
+            "    unsigned cc = pmach->_cc;\n"
+            "    unsigned pc = pmach->_pc;\n\n"
+            "    memcpy(R, pmach->_registers, sizeof(R));\n");
+    for (unsigned i = 0; i < textsize; ++i)
+        if (code[i]._op == F_TRAP)
+        {
+            fprintf(out, "    bool running;\n");
+            break;
+        }
+    fprintf(out, "    goto dispatch;\n");
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        if (leader[i])
+        {
+            unsigned len = 1;
+            while (i + len < textsize && !leader[i + len])
+                ++len;
+            fprintf(out, "\npc_%u:\n    pmach->_icount += %u;\n", i, len);
+        }
+        translate(out, &code[i], i, textsize);
+    }
+    fprintf(out, "    error(ERR_SEGTEXT, %u); // sortie séquentielle du texte\n", textsize);
+
+    // destinations dynamiques
+    fprintf(out, "\ndispatch:\n    switch (pc)\n    {\n");
+    for (unsigned i = 0; i < textsize; ++i)
+        if (leader[i])
+            fprintf(out, "        case %u: goto pc_%u;\n", i, i);
+    fprintf(out, "        default:\n"
+            "            if (pc >= textsize)\n"
+            "                error(ERR_SEGTEXT, pc);\n"
+            "            // pas un début de bloc : le moteur rapide termine l'exécution\n"
+            "            memcpy(pmach->_registers, R, sizeof(R));\n"
+            "            pmach->_cc = cc;\n"
+            "            pmach->_pc = pc;\n"
+            "            simul_fast(pmach);\n"
+            "            return;\n"
+            "    }\n");
+
+    // arrêt (seulement si le programme contient HALT : étiquette inutilisée sinon)
+    bool halts = false;
+    for (unsigned i = 0; i < textsize; ++i)
+        halts |= code[i]._op == F_HALT || code[i]._op == F_TRAP;
+    if (halts)
+        fprintf(out, "\nhalt:\n"
+                "    memcpy(pmach->_registers, R, sizeof(R));\n"
+                "    pmach->_cc = cc;\n"
+                "    pmach->_pc = pc;\n"
+                "    if (pmach->_devices != NULL)\n"
+                "        devices_flush(pmach->_devices);\n");
+    fprintf(out, "}\n\n");
+
+    fputs(epilogue, out);
+    free(code);
+    free(leader);
+}
+
+int main(int argc, char *argv[])
+{
+    char *files[2];
+    int nfiles = 0;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] == '-')
+            switch (argv[iarg][1])
+            {
+                case 'h':
+                    usage();
+                    exit(EXIT_SUCCESS);
+                default:
+                    fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                    usage();
+                    exit(EXIT_FAILURE);
+            }
+        else if (nfiles < 2)
+            files[nfiles++] = argv[iarg];
+        else
+            fprintf(stderr, "Trailing options ignored...\n");
+    }
+    if (nfiles != 2)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    Machine mach;
+    read_program(&mach, files[0]);
+
+    FILE *out = fopen(files[1], "w");
+    if (out == NULL)
+    {
+        perror(files[1]);
+        exit(EXIT_FAILURE);
+    }
+    emit(out, &mach, files[0]);
+    if (fclose(out) != 0)
+    {
+        perror(files[1]);
+        exit(EXIT_FAILURE);
+    }
+    machine_free(&mach);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*!
+ * \file simul_batch.c
+ * \brief Exécution d'un lot de programmes binaires sur un même thread
+ *
+ * Chaque programme de la liste est chargé par read_program(), exécuté sans
+ * trace (moteur ordinaire ou, avec \c -f, moteur rapide et cache des formes
+ * prédécodées s'il est activé, voir pcache.h) puis libéré par
+ * machine_free(). La clé de cache de chaque fichier n'est calculée qu'une
+ * fois. La liste est parcourue \c -r fois. Les segments étant
+ * recyclés par la réserve du thread (arena.h), le régime permanent ne fait
+ * plus d'allocation dans le tas : les compteurs de la réserve sont affichés
+ * à la fin.
+ *
+ * Avec \c -s, chaque programme n'est chargé qu'une fois, dans une image
+ * partagée (share.h) : chaque exécution utilise son texte et sa forme
+ * prédécodée sans copie et n'a en propre que les pages de données qu'elle
+ * modifie.
+ *
+ * Avec \c -a, les programmes sont les membres d'une archive (archive.h),
+ * projetée une seule fois : tous, ou ceux que désignent les arguments (nom
+ * ou \c #numéro). Chaque exécution utilise le texte dans la projection sans
+ * ouvrir ni lire de fichier ; le cache des formes prédécodées n'est pas
+ * utilisé.
+ *
+ * \attention Les erreurs d'exécution restent fatales : un programme en
+ * erreur arrête tout le lot.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "machine.h"
+#include "exec.h"
+#include "fast.h"
+#include "pcache.h"
+#include "arena.h"
+#include "share.h"
+#include "archive.h"
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_batch [options] file.bin...\n"
+           "       simul_batch [options] -a archive [member...]\n");
+    printf("where options are:\n"
+           "\t-f\tUse the fast engine\n"
+           "\t-r N\tRun the whole list N times (default 1)\n"
+           "\t-s\tLoad each program once and share its text, predecoded form\n"
+           "\t\tand initial data between runs (copy-on-write data)\n"
+           "\t-a file\tRun the members of an archive (all of them by default)\n"
+           "\t-v\tPrint the instruction count and R00 of each run\n"
+           "\t-h\tprint this help message\n");
+}
+
+int main(int argc, char *argv[])
+{
+    bool fast = false;
+    bool verbose = false;
+    bool share = false;
+    unsigned long repeat = 1;
+    int first = argc;
+    const char *archivefile = NULL;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] != '-')
+        {
+            first = iarg;
+            break;
+        }
+        switch (argv[iarg][1])
+        {
+            case 'f':
+                fast = true;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 's':
+                share = true;
+                break;
+            case 'a':
+                if (iarg + 1 >= argc)
+                {
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                archivefile = argv[++iarg];
+                break;
+            case 'r':
+                if (iarg + 1 >= argc || (repeat = strtoul(argv[iarg + 1], NULL, 0)) == 0)
+                {
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                ++iarg;
+                break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+    if ((first >= argc && archivefile == NULL) || (share && archivefile != NULL))
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    trace_enabled = false;
+
+    // images partagées : un seul chargement par programme
+    Shared_Image **shared = NULL;
+    if (share)
+    {
+        if ((shared = (Shared_Image **) calloc(argc, sizeof(Shared_Image *))) == NULL)
+        {
+            perror("simul_batch.calloc");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = first; i < argc; ++i)
+            shared[i] = share_open(argv[i], fast);
+    }
+
+    // archive : une seule projection, membres désignés ou tous
+    Archive *par = NULL;
+    unsigned *members = NULL;
+    unsigned nprogs = argc - first;
+    if (archivefile != NULL)
+    {
+        par = archive_open(archivefile);
+        if (nprogs == 0)
+            nprogs = par->_count;
+        if ((members = (unsigned *) malloc((nprogs + 1) * sizeof(unsigned))) == NULL)
+        {
+            perror("simul_batch.malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (unsigned k = 0; k < nprogs; ++k)
+        {
+            int index = first < argc ? archive_find(par, argv[first + k]) : (int) k;
+            if (index < 0)
+            {
+                fprintf(stderr, "%s: no member %s\n", archivefile, argv[first + k]);
+                exit(EXIT_FAILURE);
+            }
+            members[k] = index;
+        }
+    }
+
+    // clés du cache des formes prédécodées : chaque fichier n'est lu qu'une fois
+    Pcache_Key *keys = NULL;
+    if (fast && !share && par == NULL && getenv(PCACHE_ENV) != NULL)
+    {
+        if ((keys = (Pcache_Key *) calloc(argc, sizeof(Pcache_Key))) == NULL)
+        {
+            perror("simul_batch.calloc");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = first; i < argc; ++i)
+            pcache_key(argv[i], &keys[i]); // échec : clé nulle, pas de cache
+    }
+
+    Machine mach;
+    unsigned long nruns = 0;
+    unsigned long long icount = 0;
+    for (unsigned long r = 0; r < repeat; ++r)
+        for (unsigned k = 0; k < nprogs; ++k)
+        {
+            int i = first + k;
+            const char *name;
+            if (par != NULL)
+            {
+                archive_load(&mach, par, members[k]);
+                name = archive_name(par, members[k]);
+            }
+            else
+            {
+                if (share)
+                    share_load(&mach, shared[i]);
+                else
+                    read_program(&mach, argv[i]);
+                name = argv[i];
+            }
+            if (fast)
+            {
+                if (keys != NULL)
+                    pcache_attach_key(&mach, &keys[i]);
+                simul_fast(&mach);
+            }
+            else
+                simul(&mach, false);
+
+            if (verbose)
+                printf("%s: %llu instructions, R00 = 0x%08x\n", name,
+                       (unsigned long long) mach._icount, mach._registers[0]);
+            icount += mach._icount;
+            ++nruns;
+            machine_free(&mach);
+        }
+    if (par != NULL)
+    {
+        archive_close(par);
+        free(members);
+    }
+    free(keys);
+
+    Arena_Stats stats = arena_stats();
+    printf("%lu runs, %llu instructions\n", nruns, icount);
+    printf("arena: %llu blocks allocated, %llu reused, %llu freed\n",
+           (unsigned long long) stats._mallocs, (unsigned long long) stats._reuses,
+           (unsigned long long) stats._frees);
+    if (share)
+    {
+        Share_Stats sstats = share_stats();
+        printf("shared: %u images, %zu KiB text, %zu KiB predecoded, %zu KiB initial data\n",
+               sstats._images, sstats._textbytes >> 10, sstats._fastbytes >> 10,
+               sstats._databytes >> 10);
+        for (int i = first; i < argc; ++i)
+            share_close(shared[i]);
+        free(shared);
+    }
+    arena_trim();
+    return EXIT_SUCCESS;
+}
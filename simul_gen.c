@@ -0,0 +1,691 @@
+/*!
+ * \file simul_gen.c
+ * \brief Génération de programmes synthétiques de grande taille
+ *
+ * Les programmes produits sont valides par construction et s'arrêtent
+ * toujours : les seuls branchements arrière ferment des boucles à compteur,
+ * le graphe d'appel est sans cycle (une fonction n'appelle que des fonctions
+ * du niveau suivant), les accès aux données restent dans la zone statique,
+ * la pile est équilibrée dans chaque fonction et les divisions se font par
+ * des constantes non nulles. Le générateur affiche une borne du nombre
+ * d'instructions exécutées et de la profondeur de pile, qui respecte autant
+ * que possible le budget demandé (\c -b) ; avec \c -v il exécute le
+ * programme (moteur rapide) pour le vérifier.
+ *
+ * Organisation des registres :
+ *  - R00 à R09 : registres de calcul (valeurs quelconques) ;
+ *  - R10 à R13 : compteurs des boucles (un par niveau d'imbrication, appels
+ *    compris : une fonction appelée depuis une boucle de niveau \c d ne
+ *    prend que les compteurs suivants) ;
+ *  - R14 : base de l'adressage indexé (constante) ;
+ *  - R15 : pointeur de pile.
+ *
+ * Le mélange d'instructions se règle par des poids (option \c -m) :
+ * \c alu (opérations arithmétiques et logiques, \c CMP), \c mem (\c LOAD,
+ * \c STORE), \c atomic (\c XCHG, \c FADD), \c block (\c MOVE, \c FILL),
+ * \c stack (groupes de \c PUSH puis \c POP), \c skip (branchement
+ * conditionnel en avant), \c loop (boucle à compteur) et \c call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "machine.h"
+#include "instruction.h"
+#include "image.h"
+#include "fast.h"
+
+//! Taille maximale du texte (adresses de branchement sur 20 bits)
+#define GEN_MAXTEXT (1u << 20)
+
+//! Taille maximale de la zone de données statiques (adresses immédiates sur 20 bits signés)
+#define GEN_MAXDATA (1u << 19)
+
+//! Nombre de registres de calcul
+#define GEN_NWORK 10
+
+//! Premier compteur de boucle
+#define GEN_RCOUNT 10
+
+//! Profondeur maximale d'imbrication des boucles (un compteur par niveau)
+#define GEN_MAXLOOP 4
+
+//! Registre de base de l'adressage indexé
+#define GEN_RBASE 14
+
+//! Profondeur maximale d'appel
+#define GEN_MAXCALL 64
+
+//! Nombre de fonctions par niveau d'appel et par niveau de boucle
+#define GEN_PERKEY 2
+
+//! Taille maximale d'un bloc (MOVE, FILL)
+#define GEN_MAXBLOCK 64
+
+//! Marge du budget d'exécution (taille maximale d'un élément simple)
+#define GEN_SLACK 32
+
+//! Classes d'éléments générés
+typedef enum
+{
+    K_ALU, K_MEM, K_ATOMIC, K_BLOCK, K_STACK, K_SKIP, K_LOOP, K_CALL, NKINDS
+} Kind;
+
+//! Noms des classes (option -m)
+static const char *kind_names[NKINDS] = {
+    "alu", "mem", "atomic", "block", "stack", "skip", "loop", "call"
+};
+
+//! Paramètres de génération
+static struct
+{
+    unsigned _textsize;		//!< Taille visée du texte
+    unsigned _dataend;		//!< Taille de la zone de données statiques
+    unsigned _weights[NKINDS];	//!< Poids des classes
+    unsigned _loopdepth;	//!< Imbrication maximale des boucles
+    unsigned _iterations;	//!< Nombre maximal d'itérations d'une boucle
+    unsigned _calldepth;	//!< Profondeur maximale d'appel
+    unsigned _maxpush;		//!< Nombre maximal d'empilements d'un groupe
+    unsigned _indexed;		//!< Pourcentage d'adressage indexé
+    unsigned _funcsize;		//!< Taille maximale du corps d'une fonction
+    unsigned _loopsize;		//!< Taille maximale du corps d'une boucle
+    uint64_t _budget;		//!< Borne voulue du nombre d'instructions exécutées
+} cfg = {
+    4096, 1024, { 40, 25, 2, 2, 5, 8, 6, 4 }, 2, 16, 3, 4, 30, 64, 32, 100000000
+};
+
+//! Une fonction en cours de génération (la fonction 0 est le programme principal)
+typedef struct
+{
+    Instruction *_code;		//!< Instructions
+    unsigned _len;		//!< Nombre d'instructions
+    unsigned _cap;		//!< Capacité de \c _code
+    int *_target;		//!< Par instruction : -1, adresse locale (-2 - a) ou fonction appelée
+    unsigned _level;		//!< Niveau d'appel
+    unsigned _loopbase;		//!< Premier niveau de boucle utilisable
+    uint64_t _cost;		//!< Borne du nombre d'instructions exécutées (RET compris)
+    unsigned _stack;		//!< Borne de la profondeur de pile (adresse de retour comprise)
+    unsigned _addr;		//!< Adresse dans le texte final
+} Func;
+
+//! Fonctions générées
+static Func *funcs;
+
+//! Nombre de fonctions générées
+static unsigned nfuncs;
+
+//! Nombre total d'instructions générées
+static unsigned total;
+
+//! État du générateur pseudo-aléatoire (reproductible d'un hôte à l'autre)
+static uint64_t seed = 0x9E3779B97F4A7C15ull;
+
+//! Base de l'adressage indexé (valeur de R14)
+static unsigned base;
+
+//! Tirage pseudo-aléatoire (xorshift64*)
+static uint64_t next_random(void)
+{
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 0x2545F4914F6CDD1Dull;
+}
+
+//! Tirage uniforme dans [0, n[
+static unsigned pick(unsigned n)
+{
+    return n == 0 ? 0 : (unsigned) (next_random() % n);
+}
+
+//! Tirage uniforme dans [lo, hi]
+static unsigned pick_range(unsigned lo, unsigned hi)
+{
+    return lo + pick(hi - lo + 1);
+}
+
+//! Ajout d'une instruction à une fonction
+/*!
+ * \param f l'indice de la fonction
+ * \param instr l'instruction
+ * \param target -1, adresse locale (-2 - a) ou fonction appelée
+ * \return l'adresse locale de l'instruction
+ */
+static unsigned emit(unsigned f, Instruction instr, int target)
+{
+    Func *pf = &funcs[f];
+    if (pf->_len == pf->_cap)
+    {
+        pf->_cap = pf->_cap == 0 ? 256 : 2 * pf->_cap;
+        pf->_code = (Instruction *) realloc(pf->_code, pf->_cap * sizeof(Instruction));
+        pf->_target = (int *) realloc(pf->_target, pf->_cap * sizeof(int));
+        if (pf->_code == NULL || pf->_target == NULL)
+        {
+            perror("emit.realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pf->_code[pf->_len] = instr;
+    pf->_target[pf->_len] = target;
+    ++total;
+    return pf->_len++;
+}
+
+//! Instruction à valeur immédiate
+static Instruction make_imm(Code_Op cop, unsigned reg, int value)
+{
+    Instruction i = { .instr_immediate = { cop, true, false, reg, value } };
+    return i;
+}
+
+//! Instruction à adressage absolu
+static Instruction make_abs(Code_Op cop, unsigned reg, unsigned address)
+{
+    Instruction i = { .instr_absolute = { cop, false, false, reg, address } };
+    return i;
+}
+
+//! Instruction à adressage indexé
+static Instruction make_idx(Code_Op cop, unsigned reg, unsigned rindex, int offset)
+{
+    Instruction i = { .instr_indexed = { cop, false, true, reg, rindex, offset } };
+    return i;
+}
+
+//! Instruction sans opérande
+static Instruction make_gen(Code_Op cop)
+{
+    Instruction i = { .instr_generic = { cop, false, false, 0, 0 } };
+    return i;
+}
+
+//! Instruction accédant à un mot de la zone statique
+/*!
+ * L'adressage est indexé (par R14 ou, dans une boucle, par un compteur dont
+ * la valeur est comprise entre 1 et le nombre d'itérations) avec la
+ * probabilité demandée, sinon absolu.
+ *
+ * \param cop le code opération
+ * \param reg le registre
+ * \param depth le niveau de boucle courant (compteurs R10 à R10 + depth - 1 actifs)
+ * \return l'instruction
+ */
+static Instruction make_data(Code_Op cop, unsigned reg, unsigned depth)
+{
+    unsigned dataend = cfg._dataend;
+    if (pick(100) >= cfg._indexed)
+        return make_abs(cop, reg, pick(dataend));
+
+    if (depth > 0 && dataend > cfg._iterations + 1 && pick(2) == 0)
+    {
+        unsigned span = dataend - cfg._iterations;
+        return make_idx(cop, reg, GEN_RCOUNT + pick(depth), pick(span < 32768 ? span : 32768));
+    }
+    // base + déplacement dans [-base, dataend - base[ et dans [-32768, 32767]
+    int lo = base < 32768 ? -(int) base : -32768;
+    int hi = dataend - base < 32768 ? (int) (dataend - base) - 1 : 32767;
+    return make_idx(cop, reg, GEN_RBASE, lo + (int) pick(hi - lo + 1));
+}
+
+//! Opération arithmétique ou logique (opérande immédiat, absolu ou indexé)
+static void gen_alu(unsigned f, unsigned depth)
+{
+    static const Code_Op ops[] = { ADD, SUB, MUL, DIV, MOD, AND, OR, XOR, SHL, SHR, CMP };
+    Code_Op cop = ops[pick(sizeof(ops) / sizeof(ops[0]))];
+    unsigned reg = pick(GEN_NWORK);
+
+    // division par une constante non nulle seulement
+    if (cop == DIV || cop == MOD || pick(2) == 0)
+    {
+        int value = (int) pick(1 << 16) - (1 << 15);
+        emit(f, make_imm(cop, reg, value == 0 ? 1 : value), -1);
+    }
+    else
+        emit(f, make_data(cop, reg, depth), -1);
+}
+
+//! Chargement ou rangement
+static void gen_mem(unsigned f, unsigned depth)
+{
+    unsigned reg = pick(GEN_NWORK);
+    switch (pick(4))
+    {
+        case 0: emit(f, make_imm(LOAD, reg, (int) pick(1 << 20) - (1 << 19)), -1); break;
+        case 1: emit(f, make_data(LOAD, reg, depth), -1); break;
+        default: emit(f, make_data(STORE, reg, depth), -1); break;
+    }
+}
+
+//! Élément simple (sans pile ni transfert de contrôle)
+static void gen_simple(unsigned f, unsigned depth)
+{
+    if (pick(cfg._weights[K_ALU] + cfg._weights[K_MEM] + 1) < cfg._weights[K_ALU])
+        gen_alu(f, depth);
+    else
+        gen_mem(f, depth);
+}
+
+//! Opération atomique
+static void gen_atomic(unsigned f, unsigned depth)
+{
+    emit(f, make_data(pick(2) == 0 ? XCHG : FADD, pick(GEN_NWORK), depth), -1);
+}
+
+//! Copie ou remplissage d'un bloc de la zone statique
+static void gen_block(unsigned f)
+{
+    unsigned maxcount = cfg._dataend / 4 < GEN_MAXBLOCK ? cfg._dataend / 4 : GEN_MAXBLOCK;
+    unsigned count = pick_range(1, maxcount > 0 ? maxcount : 1);
+    unsigned rcount = pick(GEN_NWORK);
+    unsigned rdest = (rcount + 1 + pick(GEN_NWORK - 1)) % GEN_NWORK;
+    unsigned rsrc = rcount;
+    while (rsrc == rcount || rsrc == rdest)
+        rsrc = pick(GEN_NWORK);
+    bool move = pick(2) == 0;
+
+    emit(f, make_imm(LOAD, rcount, count), -1);
+    emit(f, make_imm(LOAD, rdest, pick(cfg._dataend - count + 1)), -1);
+    emit(f, make_imm(LOAD, rsrc, move ? (int) pick(cfg._dataend - count + 1) : (int) pick(1 << 16)), -1);
+    Instruction i = { .instr_block = { move ? MOVE : FILL, false, false, rcount, rdest, rsrc, 0 } };
+    emit(f, i, -1);
+}
+
+//! Groupe d'empilements suivis d'autant de dépilements
+/*!
+ * \return le nombre de mots empilés
+ */
+static unsigned gen_stack(unsigned f, unsigned depth)
+{
+    unsigned n = pick_range(1, cfg._maxpush);
+    for (unsigned k = 0; k < n; ++k)
+        if (pick(3) == 0)
+            emit(f, make_imm(PUSH, 0, (int) pick(1 << 16)), -1);
+        else
+            emit(f, make_data(PUSH, 0, depth), -1);
+    for (unsigned k = 0; k < n; ++k)
+        gen_simple(f, depth);
+    for (unsigned k = 0; k < n; ++k)
+        emit(f, make_data(POP, 0, depth), -1);
+    return n;
+}
+
+//! Branchement conditionnel en avant par dessus quelques éléments simples
+static void gen_skip(unsigned f, unsigned depth)
+{
+    unsigned n = pick_range(1, 4);
+    unsigned at = emit(f, make_abs(BRANCH, pick_range(NC, LAST_CONDITION), 0), -1);
+    for (unsigned k = 0; k < n; ++k)
+        gen_simple(f, depth);
+    funcs[f]._target[at] = -2 - (int) funcs[f]._len;
+}
+
+static unsigned gen_body(unsigned f, unsigned depth, unsigned size, uint64_t budget, uint64_t *pcost);
+
+//! Fonction du niveau suivant utilisable depuis un niveau de boucle
+/*!
+ * Les fonctions sont créées à la demande, au plus \c GEN_PERKEY par niveau
+ * d'appel et niveau de boucle.
+ *
+ * \param level le niveau d'appel de la fonction
+ * \param loopbase le niveau de boucle de l'appelant
+ * \param budget borne voulue du nombre d'instructions exécutées par l'appel
+ * \return l'indice de la fonction, ou -1 si aucune ne tient dans le budget
+ */
+static int callee(unsigned level, unsigned loopbase, uint64_t budget)
+{
+    unsigned candidates[GEN_PERKEY], n = 0, nfit = 0;
+    for (unsigned g = 1; g < nfuncs && n < GEN_PERKEY; ++g)
+        if (funcs[g]._level == level && funcs[g]._loopbase == loopbase)
+        {
+            n++;
+            if (funcs[g]._cost < budget)
+                candidates[nfit++] = g;
+        }
+    if (nfit > 0 && (n == GEN_PERKEY || pick(2) == 0))
+        return candidates[pick(nfit)];
+    if (n == GEN_PERKEY || budget < 4 + GEN_SLACK)
+        return -1;
+
+    funcs = (Func *) realloc(funcs, (nfuncs + 1) * sizeof(Func));
+    if (funcs == NULL)
+    {
+        perror("callee.realloc");
+        exit(EXIT_FAILURE);
+    }
+    unsigned g = nfuncs++;
+    memset(&funcs[g], 0, sizeof(Func));
+    funcs[g]._level = level;
+    funcs[g]._loopbase = loopbase;
+
+    unsigned size = pick_range(4, cfg._funcsize);
+    if (size > budget - GEN_SLACK)
+        size = budget - GEN_SLACK;
+    uint64_t cost = 1; // RET
+    unsigned stack = gen_body(g, loopbase, size, budget - 2, &cost);
+    emit(g, make_gen(RET), -1);
+    funcs[g]._cost = cost;
+    funcs[g]._stack = 1 + stack;
+    return (int) g;
+}
+
+//! Génération d'une suite d'éléments
+/*!
+ * Chaque instruction de la suite peut être exécutée une fois ; au delà, le
+ * budget limite les boucles (nombre d'itérations) et les appels (fonctions
+ * assez courtes). La borne calculée est exacte même si le budget est trop
+ * petit pour la taille demandée.
+ *
+ * \param f l'indice de la fonction
+ * \param depth le niveau de boucle courant
+ * \param size le nombre d'instructions visé (pour le corps du programme
+ * principal : taille totale du texte)
+ * \param budget borne voulue du nombre d'instructions exécutées
+ * \param pcost borne du nombre d'instructions exécutées (augmentée)
+ * \return borne de la profondeur de pile atteinte dans la suite
+ */
+static unsigned gen_body(unsigned f, unsigned depth, unsigned size, uint64_t budget, uint64_t *pcost)
+{
+    unsigned weights[NKINDS], sum = 0;
+    unsigned level = funcs[f]._level;
+    unsigned start = funcs[f]._len;
+    unsigned stack = 0;
+    uint64_t cost = 0;
+
+    for (unsigned k = 0; k < NKINDS; ++k)
+        weights[k] = cfg._weights[k];
+    if (depth >= cfg._loopdepth)
+        weights[K_LOOP] = 0;
+    if (level >= cfg._calldepth)
+        weights[K_CALL] = 0;
+    for (unsigned k = 0; k < NKINDS; ++k)
+        sum += weights[k];
+    if (sum == 0)
+        weights[K_ALU] = sum = 1;
+
+    for (;;)
+    {
+        // le programme principal compte aussi les fonctions qu'il a fait créer
+        unsigned done = f == 0 && depth == 0 ? total : funcs[f]._len - start;
+        if (done >= size)
+            break;
+        // budget restant, une fois réservée une exécution du reste de la suite
+        uint64_t reserve = cost + (size - done) + GEN_SLACK;
+        uint64_t avail = budget > reserve ? budget - reserve : 0;
+
+        // le programme principal ne crée plus rien de gros à l'approche de la taille visée
+        bool full = f == 0 && total >= cfg._textsize - cfg._textsize / 16;
+        unsigned before = funcs[f]._len;
+        unsigned r = pick(sum), k = 0;
+        while (r >= weights[k])
+            r -= weights[k++];
+        if ((full || avail == 0) && (k == K_LOOP || k == K_CALL))
+            k = K_ALU;
+        if (f == 0 && depth == 0 && size - done < GEN_SLACK)
+            k = K_ALU; // fin du texte : une instruction à la fois
+
+        switch ((Kind) k)
+        {
+            case K_ALU: gen_alu(f, depth); break;
+            case K_MEM: gen_mem(f, depth); break;
+            case K_ATOMIC: gen_atomic(f, depth); break;
+            case K_BLOCK: gen_block(f); break;
+            case K_STACK:
+            {
+                unsigned n = gen_stack(f, depth);
+                stack = n > stack ? n : stack;
+                break;
+            }
+            case K_SKIP: gen_skip(f, depth); break;
+            case K_LOOP:
+            {
+                // corps généré d'abord, nombre d'itérations ajusté ensuite au budget
+                unsigned rcount = GEN_RCOUNT + depth;
+                uint64_t inner = 0;
+                unsigned load = emit(f, make_imm(LOAD, rcount, 0), -1);
+                unsigned head = funcs[f]._len;
+                unsigned s = gen_body(f, depth + 1, pick_range(2, cfg._loopsize), avail, &inner);
+                stack = s > stack ? s : stack;
+                emit(f, make_imm(SUB, rcount, 1), -1);
+                emit(f, make_abs(BRANCH, GT, 0), -2 - (int) head);
+
+                uint64_t iterations = pick_range(1, cfg._iterations);
+                if (avail / (inner + 2) < iterations)
+                    iterations = avail / (inner + 2) > 0 ? avail / (inner + 2) : 1;
+                funcs[f]._code[load].instr_immediate._value = (int) iterations;
+                cost += 1 + iterations * (inner + 2);
+                continue;
+            }
+            case K_CALL:
+            {
+                int g = callee(level + 1, depth, avail);
+                if (g < 0)
+                {
+                    gen_alu(f, depth);
+                    break;
+                }
+                emit(f, make_abs(CALL, NC, 0), g);
+                stack = funcs[g]._stack > stack ? funcs[g]._stack : stack;
+                cost += 1 + funcs[g]._cost;
+                continue;
+            }
+            default: break;
+        }
+        cost += funcs[f]._len - before;
+    }
+    *pcost += cost;
+    return stack;
+}
+
+//! Assemblage des fonctions en un seul segment de texte
+/*!
+ * \param ptextsize taille du texte (résultat)
+ * \return le texte
+ */
+static Instruction *link_text(unsigned *ptextsize)
+{
+    unsigned addr = 0;
+    for (unsigned f = 0; f < nfuncs; ++f)
+    {
+        funcs[f]._addr = addr;
+        addr += funcs[f]._len;
+    }
+    if (addr > GEN_MAXTEXT)
+    {
+        fprintf(stderr, "Generated text too large (%u instructions), use a smaller -n\n", addr);
+        exit(EXIT_FAILURE);
+    }
+
+    Instruction *text = (Instruction *) malloc(addr * sizeof(Instruction));
+    if (text == NULL)
+    {
+        perror("link_text.malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned f = 0; f < nfuncs; ++f)
+        for (unsigned i = 0; i < funcs[f]._len; ++i)
+        {
+            Instruction instr = funcs[f]._code[i];
+            int target = funcs[f]._target[i];
+            if (target >= 0)
+                instr.instr_absolute._address = funcs[target]._addr;
+            else if (target < -1)
+                instr.instr_absolute._address = funcs[f]._addr + (unsigned) (-2 - target);
+            text[funcs[f]._addr + i] = instr;
+        }
+    *ptextsize = addr;
+    return text;
+}
+
+//! Lecture du mélange d'instructions (option -m)
+/*!
+ * \param spec une liste "classe=poids,..." ; les classes absentes gardent
+ * leur poids par défaut
+ * \return faux si la liste est invalide
+ */
+static bool parse_mix(char *spec)
+{
+    for (char *item = strtok(spec, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        char *eq = strchr(item, '=');
+        if (eq == NULL)
+            return false;
+        *eq = '\0';
+        unsigned k = 0;
+        while (k < NKINDS && strcmp(item, kind_names[k]) != 0)
+            ++k;
+        if (k == NKINDS)
+            return false;
+        cfg._weights[k] = strtoul(eq + 1, NULL, 0);
+    }
+    return true;
+}
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_gen [options] output.bin\n");
+    printf("where options are:\n"
+           "\t-n N\tApproximate text size in instructions (default %u, at most %u)\n"
+           "\t-d N\tStatic data size in words (default %u, at most %u)\n"
+           "\t-m mix\tWeights, e.g. alu=40,mem=25,atomic=2,block=2,stack=5,skip=8,loop=6,call=4\n"
+           "\t-l N\tMaximal loop nesting, calls included (default %u, at most %u)\n"
+           "\t-i N\tMaximal iterations of a loop (default %u)\n"
+           "\t-c N\tMaximal call depth (default %u, at most %u)\n"
+           "\t-k N\tMaximal words pushed by a stack group (default %u)\n"
+           "\t-x P\tPercentage of indexed data accesses (default %u)\n"
+           "\t-b N\tTarget bound on executed instructions (default %llu)\n"
+           "\t-s N\tRandom seed\n"
+           "\t-I\tWrite an image instead of the legacy format\n"
+           "\t-v\tRun the program (fast engine) and check the bounds\n"
+           "\t-h\tprint this help message\n",
+           cfg._textsize, GEN_MAXTEXT, cfg._dataend, GEN_MAXDATA, cfg._loopdepth, GEN_MAXLOOP,
+           cfg._iterations, cfg._calldepth, GEN_MAXCALL, cfg._maxpush, cfg._indexed,
+           (unsigned long long) cfg._budget);
+}
+
+int main(int argc, char *argv[])
+{
+    bool image = false, verify = false;
+    char *outfile = NULL;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] != '-')
+        {
+            if (outfile == NULL)
+                outfile = argv[iarg];
+            else
+                fprintf(stderr, "Trailing options ignored...\n");
+            continue;
+        }
+        char opt = argv[iarg][1];
+        if (strchr("ndmlicksxb", opt) != NULL && iarg + 1 >= argc)
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        switch (opt)
+        {
+            case 'n': cfg._textsize = strtoul(argv[++iarg], NULL, 0); break;
+            case 'd': cfg._dataend = strtoul(argv[++iarg], NULL, 0); break;
+            case 'l': cfg._loopdepth = strtoul(argv[++iarg], NULL, 0); break;
+            case 'i': cfg._iterations = strtoul(argv[++iarg], NULL, 0); break;
+            case 'c': cfg._calldepth = strtoul(argv[++iarg], NULL, 0); break;
+            case 'k': cfg._maxpush = strtoul(argv[++iarg], NULL, 0); break;
+            case 'x': cfg._indexed = strtoul(argv[++iarg], NULL, 0); break;
+            case 'b': cfg._budget = strtoull(argv[++iarg], NULL, 0); break;
+            case 's': seed ^= strtoull(argv[++iarg], NULL, 0) * 0xBF58476D1CE4E5B9ull; break;
+            case 'm':
+                if (!parse_mix(argv[++iarg]))
+                {
+                    fprintf(stderr, "Invalid mix: %s\n", argv[iarg]);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'I': image = true; break;
+            case 'v': verify = true; break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (outfile == NULL || cfg._textsize < 2 || cfg._textsize > GEN_MAXTEXT
+        || cfg._dataend < 4 || cfg._dataend > GEN_MAXDATA || cfg._loopdepth > GEN_MAXLOOP
+        || cfg._iterations == 0 || cfg._iterations >= (1u << 19) || cfg._calldepth > GEN_MAXCALL
+        || cfg._maxpush == 0 || cfg._indexed > 100)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+    if (seed == 0)
+        seed = 1;
+
+    // programme principal : base de l'indexation, corps, arrêt
+    base = cfg._dataend / 2 < 16384 ? cfg._dataend / 2 : 16384;
+    funcs = (Func *) calloc(1, sizeof(Func));
+    if (funcs == NULL)
+    {
+        perror("main.calloc");
+        exit(EXIT_FAILURE);
+    }
+    nfuncs = 1;
+    emit(0, make_imm(LOAD, GEN_RBASE, base), -1);
+    uint64_t cost = 2;
+    unsigned maxstack = gen_body(0, 0, cfg._textsize - 1, cfg._budget > cost ? cfg._budget - cost : 0, &cost);
+    unsigned halt = emit(0, make_gen(HALT), -1);
+
+    unsigned textsize;
+    Instruction *text = link_text(&textsize);
+
+    // données statiques aléatoires, puis la pile
+    unsigned datasize = cfg._dataend + maxstack + 16;
+    Word *data = (Word *) calloc(datasize, sizeof(Word));
+    if (data == NULL)
+    {
+        perror("main.calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned a = 0; a < cfg._dataend; ++a)
+        data[a] = (Word) next_random();
+
+    Machine mach;
+    load_program(&mach, textsize, text, datasize, data, cfg._dataend);
+    if (image)
+        image_write(&mach, outfile, false);
+    else
+        write_program(&mach, outfile);
+
+    printf("%s: %u instructions (%u functions), %u data words (%u static)\n",
+           outfile, textsize, nfuncs - 1, datasize, cfg._dataend);
+    printf("halts at 0x%05x after at most %llu instructions, stack depth at most %u words\n",
+           halt, (unsigned long long) cost, maxstack);
+
+    if (verify)
+    {
+        simul_fast(&mach);
+        bool ok = mach._pc == halt + 1 && mach._icount <= cost;
+        printf("run: %llu instructions, halted at 0x%05x: %s\n", (unsigned long long) mach._icount,
+               mach._pc - 1, ok ? "OK" : "FAILED");
+        if (!ok)
+            exit(EXIT_FAILURE);
+    }
+
+    machine_free(&mach);
+    free(data);
+    free(text);
+    for (unsigned f = 0; f < nfuncs; ++f)
+    {
+        free(funcs[f]._code);
+        free(funcs[f]._target);
+    }
+    free(funcs);
+    return EXIT_SUCCESS;
+}
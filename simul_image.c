@@ -0,0 +1,125 @@
+/*!
+ * \file simul_image.c
+ * \brief Conversion et vérification de fichiers au format image
+ *
+ * Le programme d'entrée est lu par read_program() (ancien format ou image)
+ * puis réécrit au format image (image_write()) ou, avec l'option \c -l, dans
+ * l'ancien format (write_program()). L'option \c -x produit une image dans
+ * l'ordre des octets opposé à celui de l'hôte, ce qui permet d'essayer le
+ * chargement d'images étrangères. L'option \c -i affiche l'en-tête et la
+ * table de sections d'une image et vérifie ses sommes de contrôle.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "machine.h"
+#include "image.h"
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_image [options] input output\n"
+           "       simul_image -i image\n");
+    printf("where options are:\n"
+           "\t-x\tWrite the image in the foreign byte order\n"
+           "\t-l\tWrite the legacy format instead of an image\n"
+           "\t-i\tPrint the header and sections of an image and verify checksums\n"
+           "\t-h\tprint this help message\n");
+}
+
+//! Affichage et vérification d'une image
+/*!
+ * \param file le nom du fichier
+ * \return vrai si l'image est valide
+ */
+static bool info(const char *file)
+{
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    size_t len = st.st_size;
+    void *map = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (map == MAP_FAILED)
+    {
+        perror("info.mmap");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    printf("%s: ", file);
+    bool ok = image_info(stdout, map, len);
+    if (map != NULL)
+        munmap(map, len);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    bool foreign = false;
+    bool legacy = false;
+    bool show = false;
+    char *files[2];
+    int nfiles = 0;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] == '-')
+            switch (argv[iarg][1])
+            {
+                case 'x':
+                    foreign = true;
+                    break;
+                case 'l':
+                    legacy = true;
+                    break;
+                case 'i':
+                    show = true;
+                    break;
+                case 'h':
+                    usage();
+                    exit(EXIT_SUCCESS);
+                default:
+                    fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                    usage();
+                    exit(EXIT_FAILURE);
+            }
+        else if (nfiles < 2)
+            files[nfiles++] = argv[iarg];
+        else
+            fprintf(stderr, "Trailing options ignored...\n");
+    }
+
+    if (show)
+    {
+        if (nfiles != 1)
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        return info(files[0]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (nfiles != 2)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    Machine mach;
+    read_program(&mach, files[0]);
+    if (legacy)
+        write_program(&mach, files[1]);
+    else
+        image_write(&mach, files[1], foreign);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,459 @@
+/*!
+ * \file simul_opt.c
+ * \brief Optimiseur hors ligne de programmes binaires (.bin)
+ *
+ * Le programme est lu par read_program(), son graphe de flot de contrôle est
+ * construit puis les transformations suivantes, qui préservent la
+ * sémantique, sont appliquées :
+ *
+ *   - enchaînement des branchements (<em>jump threading</em>) : un
+ *   branchement vers un \c BRANCH dont la condition est impliquée par la
+ *   sienne est redirigé vers la destination finale ;
+ *
+ *   - repliement des suites d'instructions immédiates sur un même registre
+ *   (\c LOAD/ADD/SUB \c #) à l'intérieur d'un bloc de base ;
+ *
+ *   - suppression du code inaccessible ;
+ *
+ *   - compactage des \c NOP (et des branchements vers l'instruction
+ *   suivante) avec relocation de toutes les adresses de branchement.
+ *
+ * \attention Les adresses de code ne sont supposées apparaître que comme
+ * opérandes absolus de \c BRANCH et \c CALL (et comme adresses de retour
+ * empilées par \c CALL). Si le programme contient un branchement ou un appel
+ * indexé, sa cible n'est pas connue statiquement : les transformations qui
+ * déplacent des instructions sont alors désactivées (comme avec l'option \c
+ * -s), et chaque instruction est considérée comme un début de bloc (pas de
+ * repliement).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "machine.h"
+#include "fast.h"
+#include "image.h"
+
+//! Statistiques de l'optimisation
+typedef struct
+{
+    unsigned _threaded;		//!< Branchements redirigés
+    unsigned _folded;		//!< Instructions immédiates repliées
+    unsigned _unreachable;	//!< Instructions inaccessibles supprimées
+    unsigned _nops;		//!< NOP (ou branchements inutiles) supprimés
+} Opt_Stats;
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_opt [options] input.bin output.bin\n");
+    printf("where options are:\n"
+           "\t-s\tSafe mode: never move instructions (no relocation)\n"
+           "\t-r\tRun both programs with the fast engine and compare\n"
+           "\t\tdynamic instruction counts and final states\n"
+           "\t-h\tprint this help message\n");
+}
+
+//! Ensemble des codes conditions pour lesquels une condition est vraie (bit i : CC i)
+static const unsigned cond_sets[] = {
+    0xf,	// NC
+    1 << CC_Z,	// EQ
+    ~(1u << CC_Z) & 0xf, // NE
+    1 << CC_P,	// GT
+    1 << CC_P | 1 << CC_Z, // GE
+    1 << CC_N,	// LT
+    1 << CC_N | 1 << CC_Z, // LE
+};
+
+//! L'instruction est-elle un branchement (ou un appel) à adresse absolue ?
+static bool is_direct(Instruction instr)
+{
+    Code_Op op = instr.instr_generic._cop;
+    return (op == BRANCH || op == CALL)
+        && !instr.instr_generic._immediate && !instr.instr_generic._indexed
+        && instr.instr_generic._regcond <= LAST_CONDITION;
+}
+
+//! L'instruction est-elle un branchement ou un appel indexé (cible inconnue) ?
+static bool is_indirect(Instruction instr)
+{
+    Code_Op op = instr.instr_generic._cop;
+    return (op == BRANCH || op == CALL)
+        && !instr.instr_generic._immediate && instr.instr_generic._indexed;
+}
+
+//! L'exécution peut-elle continuer en séquence après cette instruction ?
+static bool falls_through(Instruction instr)
+{
+    switch (instr.instr_generic._cop)
+    {
+        case ILLOP:
+        case HALT:
+        case RET:
+            return false;
+        case BRANCH:
+            return instr.instr_generic._regcond != NC || instr.instr_generic._indexed;
+        default:
+            return true;
+    }
+}
+
+//! Enchaînement des branchements
+/*!
+ * Une destination qui est un \c NOP est remplacée par la première
+ * instruction qui n'en est pas un. Le \c BRANCH de destination ne modifie
+ * pas le code condition : si sa condition est vraie chaque fois que celle du
+ * premier l'est, le premier peut sauter directement à la destination finale.
+ */
+static void thread_jumps(Instruction *text, unsigned textsize, Opt_Stats *pstats)
+{
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        if (!is_direct(text[i]))
+            continue;
+        unsigned cond = text[i].instr_generic._regcond;
+        unsigned target = text[i].instr_absolute._address;
+        for (unsigned hops = 0; hops < textsize && target < textsize; ++hops)
+        {
+            // les NOP ne changent rien : on peut viser l'instruction qui les suit
+            while (target + 1 < textsize && text[target].instr_generic._cop == NOP)
+                target++;
+            Instruction next = text[target];
+            if (next.instr_generic._cop != BRANCH || !is_direct(next)
+                || (cond_sets[cond] & ~cond_sets[next.instr_generic._regcond]) != 0
+                || next.instr_absolute._address == target)
+                break;
+            target = next.instr_absolute._address;
+        }
+        if (target != text[i].instr_absolute._address)
+        {
+            text[i].instr_absolute._address = target;
+            pstats->_threaded++;
+        }
+    }
+}
+
+//! Calcul des débuts de blocs de base (cibles de branchements)
+/*!
+ * Avec \c indirect (branchement ou appel indexé dans le programme), toute
+ * instruction peut être une cible : chacune commence un bloc.
+ */
+static void find_leaders(const Instruction *text, unsigned textsize, bool indirect, bool leader[])
+{
+    memset(leader, indirect, textsize * sizeof(bool));
+    if (textsize > 0)
+        leader[0] = true;
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        if (is_direct(text[i]) && text[i].instr_absolute._address < textsize)
+            leader[text[i].instr_absolute._address] = true;
+        if (text[i].instr_generic._cop == CALL && i + 1 < textsize)
+            leader[i + 1] = true; // adresse de retour
+    }
+}
+
+//! Forme immédiate d'une instruction LOAD, ADD ou SUB (sinon faux)
+static bool immediate_op(Instruction instr, Code_Op *pop, unsigned *preg, int32_t *pvalue)
+{
+    Code_Op op = instr.instr_generic._cop;
+    if ((op != LOAD && op != ADD && op != SUB) || !instr.instr_generic._immediate)
+        return false;
+    *pop = op;
+    *preg = instr.instr_generic._regcond;
+    *pvalue = op == SUB ? -(int64_t) instr.instr_immediate._value : instr.instr_immediate._value;
+    return true;
+}
+
+//! Repliement des suites d'instructions immédiates sur un même registre
+/*!
+ * <tt>LOAD|ADD|SUB R, #a</tt> suivi de <tt>ADD|SUB R, #b</tt> (ou de <tt>LOAD
+ * R, #b</tt>) dans un même bloc de base devient une seule instruction suivie
+ * d'un \c NOP (supprimé ensuite par le compactage). Le code condition final
+ * ne dépend que de la valeur finale du registre : il est inchangé.
+ */
+static void fold_immediates(Instruction *text, unsigned textsize, const bool leader[], Opt_Stats *pstats)
+{
+    for (unsigned i = 0; i + 1 < textsize; ++i)
+    {
+        Code_Op op1, op2;
+        unsigned reg1, reg2;
+        int32_t v1, v2;
+
+        if (!immediate_op(text[i], &op1, &reg1, &v1))
+            continue;
+        // on saute les NOP intermédiaires (issus d'un repliement précédent)
+        unsigned j = i + 1;
+        while (j < textsize && !leader[j] && text[j].instr_generic._cop == NOP)
+            j++;
+        if (j >= textsize || leader[j] || !immediate_op(text[j], &op2, &reg2, &v2) || reg1 != reg2)
+            continue;
+
+        int64_t value;
+        Code_Op op;
+        if (op2 == LOAD)
+        {
+            op = LOAD; // la première instruction est inutile
+            value = v2;
+        }
+        else
+        {
+            op = op1 == LOAD ? LOAD : ADD;
+            value = (int64_t) v1 + v2;
+        }
+        if (value < -(1 << 19) || value >= (1 << 19))
+            continue; // ne tient pas dans le champ immédiat de 20 bits
+
+        text[i].instr_immediate._cop = op;
+        text[i].instr_immediate._value = value;
+        text[j]._raw = 0;
+        text[j].instr_generic._cop = NOP;
+        pstats->_folded++;
+        i--; // on essaie de replier encore avec l'instruction suivante
+    }
+}
+
+//! Calcul des instructions accessibles depuis l'adresse 0
+static void find_reachable(const Instruction *text, unsigned textsize, bool reachable[])
+{
+    unsigned *work = (unsigned *) malloc((textsize + 1) * sizeof(unsigned));
+    unsigned nwork = 0;
+
+    memset(reachable, 0, textsize * sizeof(bool));
+    if (textsize > 0)
+    {
+        reachable[0] = true;
+        work[nwork++] = 0;
+    }
+    while (nwork > 0)
+    {
+        unsigned i = work[--nwork];
+        unsigned succ[2], nsucc = 0;
+        if (falls_through(text[i]) && i + 1 < textsize)
+            succ[nsucc++] = i + 1;
+        if (is_direct(text[i]) && text[i].instr_absolute._address < textsize)
+            succ[nsucc++] = text[i].instr_absolute._address;
+        for (unsigned k = 0; k < nsucc; ++k)
+            if (!reachable[succ[k]])
+            {
+                reachable[succ[k]] = true;
+                work[nwork++] = succ[k];
+            }
+    }
+    free(work);
+}
+
+//! Compactage : suppression du code inaccessible et des NOP, relocation
+/*!
+ * \return la nouvelle taille du texte
+ */
+static unsigned compact(Instruction *text, unsigned textsize, Opt_Stats *pstats)
+{
+    bool *reachable = (bool *) malloc(textsize * sizeof(bool));
+    bool *keep = (bool *) malloc(textsize * sizeof(bool));
+    unsigned *newaddr = (unsigned *) malloc((textsize + 1) * sizeof(unsigned));
+
+    find_reachable(text, textsize, reachable);
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        bool useless = text[i].instr_generic._cop == NOP
+            || (is_direct(text[i]) && text[i].instr_generic._cop == BRANCH
+                && text[i].instr_absolute._address == i + 1);
+        keep[i] = reachable[i] && !useless;
+        if (!reachable[i])
+            pstats->_unreachable++;
+        else if (useless)
+            pstats->_nops++;
+    }
+
+    // une adresse supprimée est remplacée par celle de la prochaine instruction conservée
+    unsigned n = 0;
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        newaddr[i] = n;
+        if (keep[i])
+            n++;
+    }
+    newaddr[textsize] = n;
+
+    unsigned j = 0;
+    for (unsigned i = 0; i < textsize; ++i)
+    {
+        if (!keep[i])
+            continue;
+        Instruction instr = text[i];
+        if (is_direct(instr) && instr.instr_absolute._address <= textsize)
+            instr.instr_absolute._address = newaddr[instr.instr_absolute._address];
+        text[j++] = instr;
+    }
+
+    free(reachable);
+    free(keep);
+    free(newaddr);
+    return n;
+}
+
+//! Taille du segment de données indiquée par un fichier binaire
+/*!
+ * C'est la taille d'origine, avant le complément de pile ajouté par
+ * read_program() (voir \c MINSTACKSIZE).
+ *
+ * \param programfile le fichier (ancien format ou image)
+ */
+static unsigned file_datasize(const char *programfile)
+{
+    int fd = open(programfile, O_RDONLY);
+    union
+    {
+        uint32_t _legacy[3];	// textsize, datasize, dataend
+        Image_Header _image;
+    } header;
+
+    ssize_t n = fd == -1 ? -1 : read(fd, &header, sizeof(header));
+    if (n < (ssize_t) sizeof(header._legacy))
+    {
+        perror(programfile);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    if (!image_probe(&header, n))
+        return header._legacy[1];
+    if (n < (ssize_t) sizeof(header._image))
+    {
+        fprintf(stderr, "%s: truncated image header\n", programfile);
+        exit(EXIT_FAILURE);
+    }
+    // image éventuellement d'ordre étranger
+    return header._image._magic == IMAGE_MAGIC
+        ? header._image._datasize : __builtin_bswap32(header._image._datasize);
+}
+
+//! Exécution d'un programme par le moteur rapide
+/*!
+ * \return le nombre d'instructions exécutées
+ */
+static uint64_t run(Machine *pmach)
+{
+    simul_fast(pmach);
+    return pmach->_icount;
+}
+
+//! Optimiseur de programmes binaires
+/*!
+ * Options de la ligne de commande :
+ *
+ * <dl>
+ *   <dt>-s</dt><dd>mode sûr : aucune instruction n'est déplacée</dd>
+ *   <dt>-r</dt><dd>exécution des deux versions et comparaison</dd>
+ * </dl>
+ */
+int main(int argc, char *argv[])
+{
+    bool safe = false;
+    bool compare = false;
+    char *files[2];
+    int nfiles = 0;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] == '-')
+            switch (argv[iarg][1])
+            {
+                case 's':
+                    safe = true;
+                    break;
+                case 'r':
+                    compare = true;
+                    break;
+                case 'h':
+                    usage();
+                    exit(EXIT_SUCCESS);
+                default:
+                    fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                    usage();
+                    exit(EXIT_FAILURE);
+            }
+        else if (nfiles < 2)
+            files[nfiles++] = argv[iarg];
+        else
+            fprintf(stderr, "Trailing options ignored...\n");
+    }
+    if (nfiles != 2)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    Machine mach;
+    read_program(&mach, files[0]);
+    unsigned textsize = mach._textsize;
+    Instruction *text = (Instruction *) malloc((textsize + 1) * sizeof(Instruction));
+    memcpy(text, mach._text, textsize * sizeof(Instruction));
+
+    bool indirect = false;
+    for (unsigned i = 0; i < textsize; ++i)
+        indirect = indirect || is_indirect(text[i]);
+    if (indirect && !safe)
+    {
+        printf("%s: indexed branch or call found, relocation disabled\n", files[0]);
+        safe = true;
+    }
+
+    // chaque passe peut en rendre d'autres possibles (un compactage crée de
+    // nouveaux branchements vers l'instruction suivante, etc.) : on itère
+    // jusqu'à stabilité
+    Opt_Stats stats = { 0, 0, 0, 0 };
+    bool *leader = (bool *) malloc((textsize + 1) * sizeof(bool));
+    unsigned newsize = textsize;
+    for (unsigned changes = 1; changes > 0; )
+    {
+        Opt_Stats before = stats;
+        thread_jumps(text, newsize, &stats);
+        find_leaders(text, newsize, indirect, leader);
+        fold_immediates(text, newsize, leader, &stats);
+        if (!safe)
+            newsize = compact(text, newsize, &stats);
+        changes = stats._threaded - before._threaded + stats._folded - before._folded
+            + stats._unreachable - before._unreachable + stats._nops - before._nops;
+    }
+    free(leader);
+
+    printf("%s -> %s\n", files[0], files[1]);
+    printf("  branches threaded:        %u\n", stats._threaded);
+    printf("  immediates folded:        %u\n", stats._folded);
+    printf("  unreachable removed:      %u\n", stats._unreachable);
+    printf("  NOPs/null jumps removed:  %u\n", stats._nops);
+    printf("  text size:                %u -> %u (%.1f%%)\n", textsize, newsize,
+           textsize > 0 ? 100.0 * ((double) newsize - textsize) / textsize : 0.0);
+
+    // taille des données du fichier (le chargement a pu ajouter une pile)
+    Machine optimized = mach;
+    optimized._text = text;
+    optimized._textsize = newsize;
+    optimized._textmap = NULL;
+    optimized._datasize = file_datasize(files[0]);
+    write_program(&optimized, files[1]);
+
+    if (compare)
+    {
+        Machine before, after;
+        read_program(&before, files[0]);
+        read_program(&after, files[1]);
+        uint64_t n1 = run(&before), n2 = run(&after);
+        printf("  executed instructions:    %llu -> %llu (%.1f%%)\n",
+               (unsigned long long) n1, (unsigned long long) n2,
+               n1 > 0 ? 100.0 * ((double) n2 - n1) / n1 : 0.0);
+
+        // la pile contient des adresses de retour relogées : on ne compare
+        // que les données statiques et les registres
+        bool same = before._cc == after._cc
+            && memcmp(before._registers, after._registers, sizeof(before._registers)) == 0
+            && memcmp(before._data, after._data, before._dataend * sizeof(Word)) == 0;
+        printf("  final registers and static data: %s\n", same ? "identical" : "DIFFERENT");
+        if (!same)
+            return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*!
+ * \file simul_pack.c
+ * \brief Construction et examen d'archives de programmes
+ *
+ * Les programmes binaires donnés (ancien format ou image) sont rangés dans
+ * une archive (archive_write()), chacun sous le nom donné sur la ligne de
+ * commande. L'option \c -l affiche l'index d'une archive (numéro, nom,
+ * format, position et taille de chaque membre) ; l'option \c -t charge en
+ * plus chaque membre (archive_load()), ce qui vérifie les sommes de contrôle
+ * des images.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "machine.h"
+#include "image.h"
+#include "archive.h"
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_pack archive file.bin...\n"
+           "       simul_pack -l|-t archive\n");
+    printf("where options are:\n"
+           "\t-l\tList the members of an archive\n"
+           "\t-t\tList the members and load each of them (verifies image checksums)\n"
+           "\t-h\tprint this help message\n");
+}
+
+//! Affichage (et chargement) des membres d'une archive
+/*!
+ * \param file le nom de l'archive
+ * \param load charger chaque membre ?
+ */
+static void list(const char *file, bool load)
+{
+    Archive *par = archive_open(file);
+    printf("%s: %u members\n", file, par->_count);
+    for (unsigned i = 0; i < par->_count; ++i)
+    {
+        const Archive_Entry *pe = &par->_entries[i];
+        bool image = image_probe((const char *) par->_map + pe->_offset, pe->_size);
+        printf("%6u  %-6s  offset %10llu  size %8llu  %s\n", i, image ? "image" : "legacy",
+               (unsigned long long) pe->_offset, (unsigned long long) pe->_size,
+               archive_name(par, i));
+        if (load)
+        {
+            Machine mach;
+            archive_load(&mach, par, i);
+            machine_free(&mach);
+        }
+    }
+    archive_close(par);
+}
+
+int main(int argc, char *argv[])
+{
+    bool show = false;
+    bool load = false;
+    int first = argc;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] != '-')
+        {
+            first = iarg;
+            break;
+        }
+        switch (argv[iarg][1])
+        {
+            case 't':
+                load = true;
+                // puis comme -l
+            case 'l':
+                show = true;
+                break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (show)
+    {
+        if (argc - first != 1)
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        list(argv[first], load);
+        return EXIT_SUCCESS;
+    }
+    if (argc - first < 1)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    archive_write(argv[first], argc - first - 1, argv + first + 1);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+/*!
+ * \file simul_watch.c
+ * \brief Points d'observation et trace des transferts de contrôle
+ *
+ * Exemple de moteur instrumenté produit par fast_engine.h : le moteur de
+ * cet outil a des crochets d'instruction, de lecture, d'écriture et de
+ * transfert, et ses fautes passent par \c EXEC_FAULT. Le moteur ordinaire
+ * (simul_fast()) n'en est pas affecté.
+ *
+ * Avec \c -w, chaque accès (pile et blocs compris) à l'un des mots observés
+ * est affiché avec l'adresse de l'instruction ; avec \c -j, chaque transfert
+ * de contrôle effectif ; avec \c -c, les instructions les plus exécutées à la
+ * fin. En cas de faute, le nombre d'instructions exécutées et l'adresse de
+ * la dernière instruction sont affichés avant le message d'erreur.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "error.h"
+
+//! Faute : bilan puis erreur fatale (voir EXEC_FAULT dans exec.h)
+static void watch_fault(Error err, unsigned addr);
+#define EXEC_FAULT(err, addr) (watch_fault(err, addr), error(err, addr))
+
+#include "machine.h"
+#include "instruction.h"
+#include "fast.h"
+#include "model.h"
+
+//! Nombre maximal de mots observés
+#define WATCH_MAX 16
+
+//! Nombre d'instructions affichées par l'option -c
+#define WATCH_TOPPC 10
+
+//! Mots observés
+static unsigned watched[WATCH_MAX];
+
+//! Nombre de mots observés
+static unsigned nwatched;
+
+//! Affichage des transferts de contrôle ?
+static bool show_jumps;
+
+//! Nombre d'exécutions de chaque instruction (option -c, sinon NULL)
+static uint64_t *counts;
+
+//! Machine en cours d'exécution (bilan en cas de faute)
+static Machine *current;
+
+//! Accès à un bloc de données
+/*!
+ * \param pmach la machine
+ * \param what "read" ou "write"
+ * \param adresse première adresse
+ * \param count nombre de mots
+ */
+static void watch_access(Machine *pmach, const char *what, unsigned adresse, unsigned count)
+{
+    for (unsigned i = 0; i < nwatched; ++i)
+        if (watched[i] - adresse < count)
+        {
+            printf("0x%04x: %-5s [0x%04x]", pmach->_pc - 1, what, watched[i]);
+            if (watched[i] < pmach->_datasize)
+                printf(" = 0x%08x", pmach->_data[watched[i]]);
+            putchar('\n');
+        }
+}
+
+//! Transfert de contrôle
+static void watch_transfer(unsigned from, unsigned to)
+{
+    if (show_jumps)
+        printf("0x%04x: jump -> 0x%04x\n", from, to);
+}
+
+//! Faute : bilan avant le message d'erreur
+static void watch_fault(Error err, unsigned addr)
+{
+    (void) err;
+    (void) addr;
+    if (current != NULL)
+        printf("*** fault after %llu instructions, last instruction at 0x%04x ***\n",
+               (unsigned long long) current->_icount, current->_pc - 1);
+}
+
+#define FAST_ENGINE watch_engine
+#define FAST_HOOK_BEFORE(pmach, addr, d) do { if (counts != NULL) counts[addr]++; } while (0)
+#define FAST_HOOK_READ(pmach, adresse, count) watch_access(pmach, "read", adresse, count)
+#define FAST_HOOK_WRITE(pmach, adresse, count) watch_access(pmach, "write", adresse, count)
+#define FAST_HOOK_TRANSFER(pmach, from, to) watch_transfer(from, to)
+#include "fast_engine.h"
+
+//! Clé de classement d'une instruction : son nombre d'exécutions
+static bool pc_count(const void *ctx, unsigned pc, uint64_t *pkey)
+{
+    (void) ctx;
+    *pkey = counts[pc];
+    return counts[pc] > 0;
+}
+
+//! Affichage des instructions les plus exécutées
+static void print_counts(Machine *pmach)
+{
+    printf("\nMost executed instructions (top %d):\n", WATCH_TOPPC);
+    unsigned top[WATCH_TOPPC];
+    unsigned ntop = model_top(pmach->_textsize, pc_count, NULL, top, WATCH_TOPPC);
+    for (unsigned rank = 0; rank < ntop; ++rank)
+    {
+        unsigned pc = top[rank];
+        char buf[DISASM_MAXLEN + 1];
+        buf[format_instruction(buf, pmach->_text[pc], pc)] = '\0';
+        printf("0x%04x %12llu  %s\n", pc, (unsigned long long) counts[pc], buf);
+    }
+}
+
+//! Help message.
+static void usage()
+{
+    printf("Usage: simul_watch [options] file.bin\n");
+    printf("where options are:\n"
+           "\t-w addr\tReport every access to data word addr (up to %d)\n"
+           "\t-j\tReport every control transfer\n"
+           "\t-c\tPrint the most executed instructions\n"
+           "\t-h\tprint this help message\n", WATCH_MAX);
+}
+
+int main(int argc, char *argv[])
+{
+    bool count = false;
+    char *programfile = NULL;
+
+    for (int iarg = 1; iarg < argc; ++iarg)
+    {
+        if (argv[iarg][0] == '-')
+            switch (argv[iarg][1])
+            {
+                case 'w':
+                    if (iarg + 1 >= argc || nwatched == WATCH_MAX)
+                    {
+                        usage();
+                        exit(EXIT_FAILURE);
+                    }
+                    watched[nwatched++] = strtoul(argv[++iarg], NULL, 0);
+                    break;
+                case 'j':
+                    show_jumps = true;
+                    break;
+                case 'c':
+                    count = true;
+                    break;
+                case 'h':
+                    usage();
+                    exit(EXIT_SUCCESS);
+                default:
+                    fprintf(stderr, "Unknown option: %s\n", argv[iarg]);
+                    usage();
+                    exit(EXIT_FAILURE);
+            }
+        else if (programfile == NULL)
+            programfile = argv[iarg];
+        else
+            fprintf(stderr, "Trailing options ignored...\n");
+    }
+    if (programfile == NULL)
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    Machine mach;
+    read_program(&mach, programfile);
+    if (count)
+        counts = (uint64_t *) xcalloc(mach._textsize + 1, sizeof(uint64_t));
+
+    current = &mach;
+    watch_engine(&mach);
+    current = NULL;
+
+    printf("%llu instructions, halted at 0x%04x\n", (unsigned long long) mach._icount, mach._pc - 1);
+    if (counts != NULL)
+    {
+        print_counts(&mach);
+        free(counts);
+    }
+    machine_free(&mach);
+    return EXIT_SUCCESS;
+}
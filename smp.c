@@ -0,0 +1,119 @@
+/*!
+ * \file smp.c
+ * \brief Machine multiprocesseur à mémoire de données partagée.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "smp.h"
+#include "fast.h"
+#include "arena.h"
+
+//! Préparation d'une machine multiprocesseur
+/*!
+ * \param psmp la machine multiprocesseur
+ * \param pmach la machine chargée avec le programme
+ * \param ncores le nombre de processeurs
+ */
+void smp_init(Smp *psmp, Machine *pmach, unsigned ncores)
+{
+    unsigned stacksize = pmach->_datasize - pmach->_dataend;
+    unsigned datasize = pmach->_dataend + ncores * stacksize;
+
+    // nouveau segment partagé : données statiques puis une pile par processeur
+    Word *data = (Word *) arena_alloc(datasize * sizeof(Word));
+    memcpy(data, pmach->_data, pmach->_dataend * sizeof(Word));
+    memset(data + pmach->_dataend, 0, (datasize - pmach->_dataend) * sizeof(Word));
+    arena_release(pmach->_data);
+    pmach->_data = data;
+    pmach->_datasize = datasize;
+    pmach->_stackhigh = datasize;
+    pmach->_sp = datasize - 1;
+
+    // texte entièrement prédécodé d'avance : la forme partagée n'est plus modifiée
+    Fast_Text *pfast = fast_prepare(pmach);
+    for (unsigned page = 0; page < pfast->_npages; ++page)
+        if (pfast->_code[page << FAST_PAGE_SHIFT]._op == F_LAZY)
+            fast_decode_page(pfast, pmach->_text, page << FAST_PAGE_SHIFT);
+
+    psmp->_shared = pmach;
+    psmp->_ncores = ncores;
+    psmp->_stacksize = stacksize;
+    for (unsigned i = 0; i < ncores; ++i)
+    {
+        Machine *pcore = &psmp->_cores[i];
+        *pcore = *pmach;
+        for (unsigned r = 0; r < NREGISTERS; ++r)
+            pcore->_registers[r] = 0;
+        pcore->_registers[0] = i;
+        pcore->_stacklow = pmach->_dataend + i * stacksize;
+        pcore->_stackhigh = pcore->_stacklow + stacksize;
+        pcore->_sp = pcore->_stackhigh - 1;
+        pcore->_pc = 0;
+        pcore->_cc = CC_U;
+        pcore->_icount = 0;
+        pcore->_devices = NULL;
+        pcore->_models = NULL;
+    }
+}
+
+// Moteur rapide sur le segment de données partagé (accès atomiques)
+#define FAST_ENGINE simul_smp
+#define FAST_ATOMIC
+#include "fast_engine.h"
+
+//! Exécution d'un processeur (fonction de thread)
+static void *run_core(void *arg)
+{
+    simul_smp((Machine *) arg);
+    return NULL;
+}
+
+//! Exécution de tous les processeurs jusqu'à leur arrêt
+/*!
+ * Le processeur 0 est exécuté par le thread appelant.
+ *
+ * \param psmp la machine multiprocesseur
+ */
+void smp_run(Smp *psmp)
+{
+    pthread_t threads[SMP_MAXCORES];
+
+    for (unsigned i = 1; i < psmp->_ncores; ++i)
+    {
+        int err = pthread_create(&threads[i], NULL, run_core, &psmp->_cores[i]);
+        if (err != 0)
+        {
+            fprintf(stderr, "smp_run.pthread_create: %s\n", strerror(err));
+            exit(EXIT_FAILURE);
+        }
+    }
+    run_core(&psmp->_cores[0]);
+    for (unsigned i = 1; i < psmp->_ncores; ++i)
+        pthread_join(threads[i], NULL);
+
+    // bilan sur la machine d'origine
+    psmp->_shared->_icount = 0;
+    for (unsigned i = 0; i < psmp->_ncores; ++i)
+        psmp->_shared->_icount += psmp->_cores[i]._icount;
+}
+
+//! Affichage de l'état des processeurs
+/*!
+ * \param psmp la machine multiprocesseur
+ */
+void smp_print_cpus(Smp *psmp)
+{
+    for (unsigned i = 0; i < psmp->_ncores; ++i)
+    {
+        printf("\n*** Core %u (stack [0x%04x, 0x%04x[, %llu instructions) ***\n", i,
+               psmp->_cores[i]._stacklow, psmp->_cores[i]._stackhigh,
+               (unsigned long long) psmp->_cores[i]._icount);
+        print_cpu(&psmp->_cores[i]);
+    }
+}
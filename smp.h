@@ -0,0 +1,76 @@
+#ifndef _SMP_H_
+#define _SMP_H_
+
+/*!
+ * \file smp.h
+ * \brief Machine multiprocesseur à mémoire de données partagée.
+ */
+
+#include <stdio.h>
+
+#include "machine.h"
+
+//! Nombre maximal de processeurs
+#define SMP_MAXCORES 64
+
+//! Machine multiprocesseur
+/*!
+ * Les \c _ncores processeurs exécutent le même segment de texte et partagent
+ * le segment de données de la machine d'origine. Chacun a son compteur
+ * ordinal, son code condition, ses registres et sa propre zone de pile de
+ * \c _stacksize mots, placée après les données statiques :
+ *
+ *     [0, dataend[                                    données statiques
+ *     [dataend + i * stacksize, dataend + (i+1) * stacksize[   pile du processeur i
+ *
+ * Au départ, \c R00 contient le numéro du processeur (0 à \c _ncores - 1) et
+ * SP le sommet de sa pile ; les autres registres sont nuls. Chaque processeur
+ * est exécuté dans un thread de l'hôte par le moteur rapide (voir fast.h),
+ * dans sa version pour données partagées (\c FAST_ATOMIC, voir
+ * fast_engine.h), jusqu'à son propre \c HALT. Une erreur sur un processeur
+ * est fatale pour toute la simulation. Les périphériques ne sont pas
+ * accessibles.
+ *
+ * <b>Modèle mémoire.</b> Chaque lecture ou écriture d'un mot est indivisible
+ * (accès atomique relâché de l'hôte), mais les accès ordinaires (\c LOAD,
+ * \c STORE, \c ADD, \c SUB, \c PUSH, \c POP...) d'un processeur peuvent
+ * être observés dans un ordre quelconque par les autres. \c XCHG et \c FADD
+ * sont atomiques, séquentiellement cohérentes entre elles et servent de
+ * barrière complète : les accès qui les précèdent dans le programme sont
+ * visibles par les autres processeurs avant elles, ceux qui les suivent ne
+ * sont pas effectués avant. Un verrou se programme donc avec \c XCHG (prise)
+ * puis \c XCHG ou \c FADD (libération).
+ */
+typedef struct
+{
+    Machine *_shared;		//!< Machine d'origine (texte, données partagées)
+    unsigned _ncores;		//!< Nombre de processeurs
+    unsigned _stacksize;	//!< Taille de la pile de chaque processeur
+    Machine _cores[SMP_MAXCORES]; //!< État de chaque processeur
+} Smp;
+
+//! Préparation d'une machine multiprocesseur
+/*!
+ * Le segment de données de la machine est agrandi pour contenir une pile
+ * par processeur ; sa pile d'origine (et son contenu) sont abandonnés. La
+ * taille de pile de chaque processeur est celle de la pile d'origine.
+ *
+ * \param psmp la machine multiprocesseur
+ * \param pmach la machine chargée avec le programme
+ * \param ncores le nombre de processeurs (1 à \c SMP_MAXCORES)
+ */
+void smp_init(Smp *psmp, Machine *pmach, unsigned ncores);
+
+//! Exécution de tous les processeurs jusqu'à leur arrêt
+/*!
+ * \param psmp la machine multiprocesseur
+ */
+void smp_run(Smp *psmp);
+
+//! Affichage de l'état des processeurs
+/*!
+ * \param psmp la machine multiprocesseur
+ */
+void smp_print_cpus(Smp *psmp);
+
+#endif
@@ -5,9 +5,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "machine.h"
+#include "device.h"
 #include "debug.h"
+#include "fast.h"
+#include "pcache.h"
+#include "guard.h"
+#include "exec.h"
+#include "model.h"
+#include "smp.h"
+#include "profile.h"
+#include "hostperf.h"
 
 //! Segment de texte
 extern Instruction text[];
@@ -35,6 +46,25 @@ static void usage()
            "\t-d\tDebug mode (interactive execution)\n"
            "\t-b\tA binary file is provided\n"
            "\t-l\tDo not execute; just display the listing\n"
+           "\t-f\tUse the fast engine (predecoded text, no trace); with -b the\n"
+           "\t\ttext segment is mapped from the file on demand and the predecoded\n"
+           "\t\tform is cached in the directory $SIMUL_CACHE (if set)\n"
+           "\t-i file\tFeed the input device FIFO from file (binary words)\n"
+           "\t-o file\tWrite the output device FIFO to file (binary words)\n"
+           "\t-C spec\tSimulate a data cache hierarchy, e.g. 256:4:8,4096:8:8:plru\n"
+           "\t\t(size:assoc:line[:lru|plru] per level, in words, powers of 2)\n"
+           "\t-P spec\tSimulate a branch predictor: static|bimodal|gshare[:bits[:ras]]\n"
+           "\t-T spec\tSimulate pipeline timing; spec is name=cycles,... with name an\n"
+           "\t\topcode (result latency), mem, l1miss, l2miss or branch ('' = defaults)\n"
+           "\t-m N\tRun N cores (fast engine) sharing the data segment\n"
+           "\t-g\tPlace the segments between guard pages: out-of-range accesses\n"
+           "\t\tfault, and the fast engine runs without bounds compares\n"
+           "\t-s usec\tSample the PC every usec microseconds of CPU time and print\n"
+           "\t\ta hot-spot report (0 = default period)\n"
+           "\t-H\tMeasure the host performance counters (perf_event_open) during\n"
+           "\t\tthe execution, per simulated instruction and per opcode\n"
+           "\t-c\tPrint only the registers and data words changed by the execution\n"
+           "\t-q\tQuiet: no execution trace\n"
            "\t-h\tprint this help message\n"
            "If -b is given, the next argument must be a file name containing\n"
            "a valid program in binary format. Otherwise an internally defined\n"
@@ -49,10 +79,51 @@ static void usage()
  * <dl>
  *   <dt>-d</dt><dd>mode pas à pas (mise au point)</dd>
  *
- *   <dt>-f</dt><dd>le programme est dans un fichier binaire ; le nom de ce
+ *   <dt>-b</dt><dd>le programme est dans un fichier binaire ; le nom de ce
  *   fichier doit être fourni également en paramètre de la ligne de
  *   commande ; sans cette option, on exécute un programme de test prédéfini.</dd>
  *
+ *   <dt>-f</dt><dd>exécution par le moteur rapide (texte prédécodé par pages
+ *   à la demande, sans trace) ; avec \c -b, le segment de texte est projeté
+ *   depuis le fichier au lieu d'être lu.</dd>
+ *
+ *   <dt>-i fichier, -o fichier</dt><dd>alimentation de la file d'entrée des
+ *   périphériques (voir device.h) depuis un fichier, écriture de la file de
+ *   sortie dans un fichier.</dd>
+ *
+ *   <dt>-C description</dt><dd>simulation d'une hiérarchie de caches de
+ *   données (voir cache_parse()) et affichage de ses statistiques après
+ *   l'exécution.</dd>
+ *
+ *   <dt>-P description</dt><dd>simulation d'un prédicteur de branchement
+ *   (voir bpred_parse()) et affichage de ses statistiques après
+ *   l'exécution.</dd>
+ *
+ *   <dt>-T description</dt><dd>simulation temporelle d'un pipeline (voir
+ *   timing_parse()), combinée avec les modèles \c -C et \c -P s'ils sont
+ *   présents ; affichage des cycles et du CPI après l'exécution.</dd>
+ *
+ *   <dt>-m N</dt><dd>exécution par N processeurs partageant le segment
+ *   de données (voir smp.h).</dd>
+ *
+ *   <dt>-g</dt><dd>segments placés entre des pages de garde (voir guard.h) :
+ *   le compteur ordinal de l'interpréteur est contrôlé et le moteur rapide
+ *   n'a plus de comparaison de limites.</dd>
+ *
+ *   <dt>-s période</dt><dd>profilage par échantillonnage du compteur
+ *   ordinal (voir profile.h) et affichage des points chauds après
+ *   l'exécution.</dd>
+ *
+ *   <dt>-H</dt><dd>mesure des compteurs de performance de l'hôte pendant
+ *   l'exécution (voir hostperf.h) et affichage par instruction simulée et
+ *   par code opération.</dd>
+ *
+ *   <dt>-c</dt><dd>au lieu du contenu complet des données avant et après
+ *   l'exécution, affichage des seuls registres et mots de données modifiés
+ *   (voir print_changes()).</dd>
+ *
+ *   <dt>-q</dt><dd>pas de trace d'exécution.</dd>
+ *
  * </dl>
  */
 int main(int argc, char *argv[])
@@ -60,7 +131,19 @@ int main(int argc, char *argv[])
     bool debug = false;
     bool binfile = false;
     bool no_exec = false;
+    bool fast = false;
+    bool guard = false;
     char *programfile = NULL;
+    char *infile = NULL;
+    char *outfile = NULL;
+    char *cachespec = NULL;
+    char *bpredspec = NULL;
+    char *timingspec = NULL;
+    unsigned ncores = 0;
+    bool sampling = false;
+    bool hostcounters = false;
+    bool changes = false;
+    unsigned period = 0;
 
     if (argc > 1) 
     {
@@ -78,6 +161,63 @@ int main(int argc, char *argv[])
                  case 'l': 
                     no_exec = true;
                     break;
+                case 'f':
+                    fast = true;
+                    break;
+                case 'g':
+                    guard = true;
+                    break;
+                case 'm':
+                    if (iarg + 1 >= argc || sscanf(argv[iarg + 1], "%u", &ncores) != 1
+                        || ncores < 1 || ncores > SMP_MAXCORES)
+                    {
+                        fprintf(stderr, "Expected a number of cores (1 to %d) after -m\n", SMP_MAXCORES);
+                        usage();
+                        exit(EXIT_FAILURE);
+                    }
+                    iarg++;
+                    break;
+                case 's':
+                    if (iarg + 1 >= argc || sscanf(argv[iarg + 1], "%u", &period) != 1)
+                    {
+                        fprintf(stderr, "Expected a sampling period (microseconds) after -s\n");
+                        usage();
+                        exit(EXIT_FAILURE);
+                    }
+                    sampling = true;
+                    iarg++;
+                    break;
+                case 'H':
+                    hostcounters = true;
+                    break;
+                case 'c':
+                    changes = true;
+                    break;
+                case 'q':
+                    trace_enabled = false;
+                    break;
+                case 'i':
+                case 'o':
+                case 'C':
+                case 'P':
+                case 'T':
+                    if (iarg + 1 >= argc)
+                    {
+                        fprintf(stderr, "Missing argument after %s\n", argv[iarg]);
+                        usage();
+                        exit(EXIT_FAILURE);
+                    }
+                    if (argv[iarg][1] == 'i')
+                        infile = argv[++iarg];
+                    else if (argv[iarg][1] == 'o')
+                        outfile = argv[++iarg];
+                    else if (argv[iarg][1] == 'C')
+                        cachespec = argv[++iarg];
+                    else if (argv[iarg][1] == 'P')
+                        bpredspec = argv[++iarg];
+                    else
+                        timingspec = argv[++iarg];
+                    break;
                   case 'h':
                     usage();
                     exit(EXIT_SUCCESS);
@@ -97,26 +237,164 @@ int main(int argc, char *argv[])
 
     if (!binfile) 
         load_program(&mach, textsize, text, datasize, data, dataend);
+    else if (fast)
+    {
+        map_program(&mach, programfile);
+        pcache_attach(&mach, programfile);
+    }
     else 
         read_program(&mach, programfile);   
+    if (guard && ncores == 0)
+        guard_protect(&mach);
+
+    Devices devices;
+    if (infile != NULL || outfile != NULL)
+    {
+        int infd = -1, outfd = -1;
+        if (infile != NULL && (infd = open(infile, O_RDONLY)) == -1)
+        {
+            perror(infile);
+            exit(EXIT_FAILURE);
+        }
+        if (outfile != NULL
+            && (outfd = open(outfile, O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)) == -1)
+        {
+            perror(outfile);
+            exit(EXIT_FAILURE);
+        }
+        devices_init(&devices, DEV_RINGSIZE);
+        devices_bind_fds(&devices, infd, outfd);
+        mach._devices = &devices;
+    }
+
+    Models models = { NULL, NULL, NULL };
+    if (cachespec != NULL)
+    {
+        Cache_Config cfg[CACHE_MAXLEVELS];
+        unsigned nlevels = cache_parse(cachespec, cfg);
+        if (nlevels == 0)
+        {
+            fprintf(stderr, "Invalid cache description: %s\n", cachespec);
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        models._cache = cache_new(cfg, nlevels, mach._textsize, mach._dataend);
+        mach._models = &models;
+    }
+    if (bpredspec != NULL)
+    {
+        Bpred_Config cfg;
+        if (!bpred_parse(bpredspec, &cfg))
+        {
+            fprintf(stderr, "Invalid branch predictor description: %s\n", bpredspec);
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        models._bpred = bpred_new(&cfg, mach._textsize);
+        mach._models = &models;
+    }
+    if (timingspec != NULL)
+    {
+        Timing_Config cfg;
+        if (!timing_parse(timingspec, &cfg))
+        {
+            fprintf(stderr, "Invalid timing description: %s\n", timingspec);
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        models._timing = timing_new(&cfg, mach._textsize);
+        mach._models = &models;
+    }
 
     printf("\n*** Sauvegarde des programmes et données initiales en format binaire ***\n\n");
     dump_memory(&mach);
 
     printf("\n*** Machine state before execution ***\n");
     print_program(&mach);
-    print_data(&mach);
+    Machine_State initial;
+    if (changes)
+        save_state(&mach, &initial);
+    else
+        print_data(&mach);
     print_cpu(&mach);
 
     if (no_exec) 
         return 0;
 
-    printf("\n*** Execution trace ***\n\n");
-    simul(&mach, debug);
+    if (ncores > 0)
+    {
+        if (debug || sampling || hostcounters || guard || mach._models != NULL || mach._devices != NULL)
+        {
+            fprintf(stderr, "Option -m excludes -d, -s, -H, -g, -C, -P, -T, -i and -o\n");
+            exit(EXIT_FAILURE);
+        }
+        static Smp smp;
+        smp_init(&smp, &mach, ncores);
+        if (changes)
+        {
+            // segment refait par smp_init() (une pile par processeur) : nouvel état de référence
+            free_state(&initial);
+            save_state(&mach, &initial);
+        }
+        printf("\n*** Execution (%u cores) ***\n\n", ncores);
+        smp_run(&smp);
+        smp_print_cpus(&smp);
+        printf("\n*** Shared memory after execution ***\n");
+        if (changes)
+        {
+            print_changes(&mach, &initial);
+            free_state(&initial);
+        }
+        else
+            print_data(&mach);
+        return (int) smp._cores[0]._status; // TRAP_EXIT du processeur 0
+    }
+
+    if (sampling)
+        profile_start(&mach, period);
+    if (hostcounters)
+        hostperf_start(&mach);
+    if (fast && !debug && mach._models == NULL)
+    {
+        printf("\n*** Execution (fast engine) ***\n\n");
+        if (mach._guard != NULL && mach._devices == NULL)
+            simul_guard(&mach); // accès et branchements contrôlés par les pages de garde
+        else
+            simul_fast(&mach);
+    }
+    else
+    {
+        printf("\n*** Execution trace ***\n\n");
+        if (mach._guard != NULL)
+            guard_simul(&mach, debug); // fautes des pages de garde signalées par error()
+        else
+            simul(&mach, debug);
+    }
+    if (hostcounters)
+        hostperf_stop();
+    if (sampling)
+        profile_stop();
 
     printf("\n*** Machine state after execution ***\n");
-    print_cpu(&mach);
-    print_data(&mach);
+    if (changes)
+    {
+        print_changes(&mach, &initial);
+        free_state(&initial);
+    }
+    else
+    {
+        print_cpu(&mach);
+        print_data(&mach);
+    }
+    models_report(stdout, &mach);
+    if (sampling)
+        profile_report(stdout, &mach);
+    if (hostcounters)
+        hostperf_report(stdout, &mach);
+    int status = (int) mach._status; // code de retour du programme (TRAP_EXIT)
+    machine_free(&mach);
+    if (infile != NULL || outfile != NULL)
+        devices_free(&devices); // ferme aussi les fichiers
 
-    return 0; 
+    return status;
 }
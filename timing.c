@@ -0,0 +1,329 @@
+/*!
+ * \file timing.c
+ * \brief Modèle temporel d'un pipeline dans l'ordre.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "timing.h"
+
+//! Indice du code condition dans la table des dates de disponibilité
+#define TIMING_CC NREGISTERS
+
+//! Registre pointeur de pile
+#define TIMING_SP (NREGISTERS - 1)
+
+//! Comparaison de chaînes sans distinction de casse (sur \c len caractères de \c s)
+static bool same_name(const char *s, size_t len, const char *name)
+{
+    if (strlen(name) != len)
+        return false;
+    for (size_t i = 0; i < len; ++i)
+        if (tolower((unsigned char) s[i]) != tolower((unsigned char) name[i]))
+            return false;
+    return true;
+}
+
+//! Analyse d'une description du modèle temporel
+/*!
+ * \param spec la description (<tt>nom=cycles,...</tt>)
+ * \param pcfg les paramètres résultants
+ * \return faux si la description est invalide
+ */
+bool timing_parse(const char *spec, Timing_Config *pcfg)
+{
+    for (unsigned c = 0; c < TIMING_NCOPS; ++c)
+        pcfg->_latency[c] = 1;
+    pcfg->_latency[MUL] = 3;
+    pcfg->_latency[DIV] = pcfg->_latency[MOD] = 12;
+    pcfg->_mem = 1;
+    pcfg->_miss[0] = 10;
+    pcfg->_miss[1] = 100;
+    pcfg->_branch = 2;
+
+    const char *p = spec;
+    while (*p != '\0')
+    {
+        size_t len = strcspn(p, "=");
+        unsigned value;
+        int n = 0;
+        if (p[len] != '=' || sscanf(p + len + 1, "%u%n", &value, &n) < 1 || n == 0)
+            return false;
+
+        unsigned *pv = NULL;
+        if (same_name(p, len, "mem"))
+            pv = &pcfg->_mem;
+        else if (same_name(p, len, "l1miss"))
+            pv = &pcfg->_miss[0];
+        else if (same_name(p, len, "l2miss"))
+            pv = &pcfg->_miss[1];
+        else if (same_name(p, len, "branch"))
+            pv = &pcfg->_branch;
+        else
+            for (unsigned c = 0; c <= LAST_COP && pv == NULL; ++c)
+                if (same_name(p, len, cop_names[c]))
+                    pv = &pcfg->_latency[c];
+        if (pv == NULL)
+            return false;
+        *pv = value;
+
+        p += len + 1 + n;
+        if (*p == ',')
+            p++;
+        else if (*p != '\0')
+            return false;
+    }
+    return true;
+}
+
+//! Création d'un modèle temporel
+/*!
+ * \param pcfg les paramètres
+ * \param textsize la taille du texte du programme observé
+ * \return le modèle
+ */
+Timing *timing_new(const Timing_Config *pcfg, unsigned textsize)
+{
+    Timing *pt = (Timing *) calloc(1, sizeof(Timing));
+    if (pt == NULL || (pt->_subs = (Timing_Sub *) calloc(textsize + 1, sizeof(Timing_Sub))) == NULL)
+    {
+        perror("timing_new.calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    pt->_cfg = *pcfg;
+    pt->_textsize = textsize;
+    pt->_maxdepth = 64;
+    pt->_frames = (Timing_Frame *) malloc(pt->_maxdepth * sizeof(Timing_Frame));
+    if (pt->_frames == NULL)
+    {
+        perror("timing_new.malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // le programme lui-même est l'activation de l'adresse 0
+    pt->_frames[0] = (Timing_Frame) { 0, 0, 0 };
+    pt->_depth = 1;
+    pt->_subs[0]._calls = 1;
+    pt->_subs[0]._active = 1;
+    return pt;
+}
+
+//! Destruction d'un modèle temporel
+void timing_free(Timing *pt)
+{
+    free(pt->_subs);
+    free(pt->_frames);
+    free(pt);
+}
+
+//! Entrée dans un sous-programme
+static void enter(Timing *pt, unsigned entry)
+{
+    if (entry > pt->_textsize)
+        entry = pt->_textsize;
+    if (pt->_depth == pt->_maxdepth)
+    {
+        pt->_maxdepth *= 2;
+        pt->_frames = (Timing_Frame *) realloc(pt->_frames, pt->_maxdepth * sizeof(Timing_Frame));
+        if (pt->_frames == NULL)
+        {
+            perror("timing_step.realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pt->_frames[pt->_depth++] = (Timing_Frame) { entry, pt->_issue, pt->_icount };
+    pt->_subs[entry]._calls++;
+    pt->_subs[entry]._active++;
+}
+
+//! Sortie d'un sous-programme
+/*!
+ * Les totaux « appelés compris » ne sont cumulés qu'à la sortie de
+ * l'activation la plus externe, pour ne pas compter deux fois la récursion.
+ */
+static void leave(Timing *pt)
+{
+    if (pt->_depth <= 1)
+        return; // RET sans CALL observé
+    Timing_Frame *pf = &pt->_frames[--pt->_depth];
+    Timing_Sub *ps = &pt->_subs[pf->_entry];
+    if (--ps->_active == 0)
+    {
+        ps->_incl_cycles += pt->_issue - pf->_cycle;
+        ps->_incl_instrs += pt->_icount - pf->_icount;
+    }
+}
+
+//! Prise en compte d'une instruction exécutée
+/*!
+ * \param pt le modèle
+ * \param instr l'instruction
+ * \param taken le branchement a-t-il été pris ?
+ * \param redirect le chargement des instructions doit-il être redirigé ?
+ * \param next l'adresse de l'instruction suivante effective
+ */
+void timing_step(Timing *pt, Instruction instr, bool taken, bool redirect, unsigned next)
+{
+    unsigned cop = instr.instr_generic._cop;
+    unsigned reg = instr.instr_generic._regcond;
+    bool imm = instr.instr_generic._immediate;
+    bool idx = !imm && instr.instr_generic._indexed;
+    uint32_t src = 0, dst = 0;		// ensembles de registres (bit TIMING_CC : code condition)
+    bool memop = false;
+    bool stackop = cop == CALL || cop == RET || cop == PUSH || cop == POP; // SP mis à jour en un cycle
+
+    if (idx)
+        src |= 1u << instr.instr_indexed._rindex;
+    switch (cop)
+    {
+        case LOAD:
+            memop = !imm;
+            dst = (1u << reg) | (1u << TIMING_CC);
+            break;
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+        case AND:
+        case OR:
+        case XOR:
+        case SHL:
+        case SHR:
+            memop = !imm;
+            src |= 1u << reg;
+            dst = (1u << reg) | (1u << TIMING_CC);
+            break;
+        case CMP:
+            memop = !imm;
+            src |= 1u << reg;
+            dst = 1u << TIMING_CC;
+            break;
+        case STORE:
+            src |= 1u << reg;
+            break;
+        case MOVE:
+        case FILL:
+            src |= 1u << reg | 1u << instr.instr_block._rdest | 1u << instr.instr_block._rsrc;
+            break;
+        case TRAP: // arguments et résultats du service (voir trap.h)
+            src |= 1u << 0 | 1u << 1 | 1u << 2;
+            dst = 1u << 0 | 1u << 1 | 1u << TIMING_CC;
+            break;
+        case XCHG:
+        case FADD:
+            memop = true;
+            src |= 1u << reg;
+            dst = (1u << reg) | (1u << TIMING_CC);
+            break;
+        case BRANCH:
+            if (reg != NC)
+                src |= 1u << TIMING_CC;
+            break;
+        case CALL:
+            if (reg != NC)
+                src |= 1u << TIMING_CC;
+            // puis comme les autres instructions de pile
+        case RET:
+        case PUSH:
+        case POP:
+            src |= 1u << TIMING_SP;
+            dst = 1u << TIMING_SP;
+            break;
+        default:
+            break;
+    }
+
+    // lancement : dans l'ordre, une fois les sources prêtes
+    uint64_t previous = pt->_icount == 0 ? 0 : pt->_issue + 1;
+    uint64_t issue = previous;
+    for (unsigned r = 0; r <= TIMING_CC; ++r)
+        if ((src >> r) & 1 && pt->_ready[r] > issue)
+            issue = pt->_ready[r];
+    pt->_stall_data += issue - previous;
+
+    // blocage sur les échecs de cache
+    issue += pt->_pending;
+    pt->_stall_mem += pt->_pending;
+    pt->_pending = 0;
+
+    uint64_t done = issue + pt->_cfg._latency[cop] + (memop ? pt->_cfg._mem : 0);
+    for (unsigned r = 0; r <= TIMING_CC; ++r)
+        if ((dst >> r) & 1)
+            pt->_ready[r] = (r == TIMING_SP && stackop) ? issue + 1 : done;
+    if (done > pt->_end)
+        pt->_end = done;
+
+    // redirection : bulles avant l'instruction suivante
+    if (redirect)
+    {
+        issue += pt->_cfg._branch;
+        pt->_stall_branch += pt->_cfg._branch;
+    }
+
+    Timing_Sub *ps = &pt->_subs[pt->_frames[pt->_depth - 1]._entry];
+    ps->_cycles += issue + 1 - previous;
+    ps->_instrs++;
+    pt->_issue = issue;
+    pt->_icount++;
+
+    if (cop == CALL && taken)
+        enter(pt, next);
+    else if (cop == RET)
+        leave(pt);
+}
+
+//! Nombre total de cycles
+uint64_t timing_cycles(const Timing *pt)
+{
+    uint64_t cycles = pt->_icount == 0 ? 0 : pt->_issue + 1;
+    return pt->_end > cycles ? pt->_end : cycles;
+}
+
+//! Affichage d'une ligne de résultats
+static void print_line(FILE *out, const char *name, uint64_t calls, uint64_t instrs, uint64_t cycles)
+{
+    fprintf(out, "%-10s calls %8llu  instructions %12llu  cycles %12llu  CPI %6.3f\n", name,
+            (unsigned long long) calls, (unsigned long long) instrs, (unsigned long long) cycles,
+            instrs > 0 ? (double) cycles / instrs : 0.0);
+}
+
+//! Affichage des résultats
+/*!
+ * \param out le flot de sortie
+ * \param pt le modèle
+ */
+void timing_report(FILE *out, const Timing *pt)
+{
+    uint64_t cycles = timing_cycles(pt);
+    char name[32];
+
+    fprintf(out, "\n*** TIMING ***\n");
+    fprintf(out, "Instructions %llu, cycles %llu, CPI %.3f\n", (unsigned long long) pt->_icount,
+            (unsigned long long) cycles, pt->_icount > 0 ? (double) cycles / pt->_icount : 0.0);
+    fprintf(out, "Stall cycles: data %llu, memory %llu, branch %llu\n",
+            (unsigned long long) pt->_stall_data, (unsigned long long) pt->_stall_mem,
+            (unsigned long long) pt->_stall_branch);
+
+    fprintf(out, "\nBy subroutine (self, then including callees):\n");
+    for (unsigned entry = 0; entry <= pt->_textsize; ++entry)
+    {
+        const Timing_Sub *ps = &pt->_subs[entry];
+        if (ps->_calls == 0)
+            continue;
+        if (entry == 0)
+            strcpy(name, "(program)");
+        else
+            sprintf(name, "0x%04x", entry);
+        print_line(out, name, ps->_calls, ps->_instrs, ps->_cycles);
+        if (entry == 0)
+            print_line(out, "", ps->_calls, pt->_icount, cycles);
+        else
+            print_line(out, "", ps->_calls, ps->_incl_instrs, ps->_incl_cycles);
+    }
+    putc('\n', out);
+}
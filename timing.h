@@ -0,0 +1,134 @@
+#ifndef _TIMING_H_
+#define _TIMING_H_
+
+/*!
+ * \file timing.h
+ * \brief Modèle temporel d'un pipeline dans l'ordre.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "instruction.h"
+#include "machine.h"
+#include "cache.h"
+
+//! Nombre de codes opérations possibles (champ de 6 bits)
+#define TIMING_NCOPS 64
+
+//! Paramètres du modèle temporel (en cycles)
+typedef struct
+{
+    unsigned _latency[TIMING_NCOPS]; //!< Latence du résultat, par code opération
+    unsigned _mem;		//!< Latence supplémentaire d'un opérande en mémoire
+    unsigned _miss[CACHE_MAXLEVELS]; //!< Pénalité d'un échec, par niveau de cache manqué
+    unsigned _branch;		//!< Pénalité d'une redirection du chargement des instructions
+} Timing_Config;
+
+//! Statistiques d'un sous-programme
+typedef struct
+{
+    uint64_t _calls;		//!< Nombre d'appels
+    uint64_t _instrs;		//!< Instructions exécutées (propres)
+    uint64_t _cycles;		//!< Cycles (propres)
+    uint64_t _incl_instrs;	//!< Instructions exécutées (appelés compris)
+    uint64_t _incl_cycles;	//!< Cycles (appelés compris)
+    unsigned _active;		//!< Nombre d'activations en cours (récursion)
+} Timing_Sub;
+
+//! Activation de sous-programme en cours
+typedef struct
+{
+    unsigned _entry;		//!< Adresse d'entrée
+    uint64_t _cycle;		//!< Cycle de l'appel
+    uint64_t _icount;		//!< Instructions exécutées avant l'appel
+} Timing_Frame;
+
+//! État du modèle temporel
+/*!
+ * Le pipeline lance au plus une instruction par cycle, dans l'ordre. Une
+ * instruction attend que ses registres sources (code condition compris)
+ * soient prêts ; les échecs de cache bloquent le pipeline ; une redirection
+ * du chargement (branchement pris sans prédicteur, mauvaise prédiction avec
+ * prédicteur) coûte \c _branch cycles.
+ */
+typedef struct Timing
+{
+    Timing_Config _cfg;		//!< Paramètres
+    uint64_t _ready[NREGISTERS + 1]; //!< Cycle où chaque registre (puis le code condition) est prêt
+    uint64_t _issue;		//!< Cycle de lancement de la dernière instruction
+    uint64_t _end;		//!< Cycle de fin de la dernière opération
+    uint64_t _pending;		//!< Cycles de blocage à imputer à l'instruction courante
+    uint64_t _icount;		//!< Instructions vues
+    uint64_t _stall_data;	//!< Cycles perdus en dépendances de registres
+    uint64_t _stall_mem;	//!< Cycles perdus en échecs de cache
+    uint64_t _stall_branch;	//!< Cycles perdus en redirections
+    unsigned _textsize;		//!< Taille du texte
+    Timing_Sub *_subs;		//!< Statistiques par adresse d'entrée de sous-programme
+    Timing_Frame *_frames;	//!< Pile des activations (la première est le programme)
+    unsigned _depth;		//!< Nombre d'activations
+    unsigned _maxdepth;		//!< Capacité de la pile des activations
+} Timing;
+
+//! Analyse d'une description du modèle temporel
+/*!
+ * La description est une liste <tt>nom=cycles</tt> séparés par des virgules,
+ * qui modifie les valeurs par défaut. \c nom est un code opération (latence
+ * de son résultat, par exemple <tt>add=1</tt>), \c mem (latence
+ * supplémentaire d'un opérande en mémoire), \c l1miss, \c l2miss (pénalités
+ * d'échec) ou \c branch (pénalité de redirection). Une description vide
+ * donne les valeurs par défaut.
+ *
+ * \param spec la description
+ * \param pcfg les paramètres résultants
+ * \return faux si la description est invalide
+ */
+bool timing_parse(const char *spec, Timing_Config *pcfg);
+
+//! Création d'un modèle temporel
+/*!
+ * \param pcfg les paramètres
+ * \param textsize la taille du texte du programme observé
+ * \return le modèle
+ */
+Timing *timing_new(const Timing_Config *pcfg, unsigned textsize);
+
+//! Destruction d'un modèle temporel
+void timing_free(Timing *pt);
+
+//! Prise en compte d'un accès aux données de l'instruction courante
+/*!
+ * \param pt le modèle
+ * \param missed le nombre de niveaux de cache manqués (voir cache_access())
+ */
+static inline void timing_memory(Timing *pt, unsigned missed)
+{
+    for (unsigned l = 0; l < missed; ++l)
+        pt->_pending += pt->_cfg._miss[l];
+}
+
+//! Prise en compte d'une instruction exécutée
+/*!
+ * \param pt le modèle
+ * \param instr l'instruction
+ * \param taken le branchement a-t-il été pris (voir transfer_taken()) ?
+ * \param redirect le chargement des instructions doit-il être redirigé ?
+ * \param next l'adresse de l'instruction suivante effective
+ */
+void timing_step(Timing *pt, Instruction instr, bool taken, bool redirect, unsigned next);
+
+//! Nombre total de cycles
+uint64_t timing_cycles(const Timing *pt);
+
+//! Affichage des résultats
+/*!
+ * Cycles et CPI du programme, répartition des cycles perdus, puis cycles et
+ * CPI de chaque sous-programme appelé.
+ *
+ * \param out le flot de sortie
+ * \param pt le modèle
+ */
+void timing_report(FILE *out, const Timing *pt);
+
+#endif
@@ -0,0 +1,142 @@
+/*!
+ * \file trap.c
+ * \brief Appels de services de l'hôte (instruction TRAP).
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trap.h"
+#include "exec.h"
+#include "error.h"
+
+//! Service TRAP_EXIT
+static bool trap_exit(Machine *pmach, unsigned addr)
+{
+    (void) addr;
+    pmach->_status = pmach->_registers[0];
+    return false;
+}
+
+//! Service TRAP_READ
+static bool trap_read(Machine *pmach, unsigned addr)
+{
+    Word *regs = pmach->_registers;
+    int fd = (int) regs[0];
+    Word adresse = regs[1], count = regs[2];
+    check_block(pmach, adresse, count, addr);
+
+    // comme read() : ce qui est disponible, mais au moins un mot entier
+    char *buf = (char *) (pmach->_data + adresse);
+    size_t want = (size_t) count * sizeof(Word), done = 0;
+    while (done < want && (done == 0 || done % sizeof(Word) != 0))
+    {
+        ssize_t n = read(fd, buf + done, want - done);
+        if (n > 0)
+            done += n;
+        else if (n == -1 && errno == EINTR)
+            continue;
+        else if (n == -1 && done == 0)
+        {
+            regs[0] = (Word) -1;
+            return true;
+        }
+        else
+            break; // fin de fichier
+    }
+    // dernier mot incomplet : complété par des zéros
+    size_t words = (done + sizeof(Word) - 1) / sizeof(Word);
+    memset(buf + done, 0, words * sizeof(Word) - done);
+    regs[0] = words;
+    return true;
+}
+
+//! Service TRAP_WRITE
+static bool trap_write(Machine *pmach, unsigned addr)
+{
+    Word *regs = pmach->_registers;
+    int fd = (int) regs[0];
+    Word adresse = regs[1], count = regs[2];
+    check_block(pmach, adresse, count, addr);
+
+    // les sorties du simulateur déjà demandées passent avant
+    if (fd == STDOUT_FILENO)
+        fflush(stdout);
+    else if (fd == STDERR_FILENO)
+        fflush(stderr);
+
+    const char *buf = (const char *) (pmach->_data + adresse);
+    size_t want = (size_t) count * sizeof(Word), done = 0;
+    while (done < want)
+    {
+        ssize_t n = write(fd, buf + done, want - done);
+        if (n > 0)
+            done += n;
+        else if (n == -1 && errno == EINTR)
+            continue;
+        else
+        {
+            regs[0] = (Word) -1;
+            return true;
+        }
+    }
+    regs[0] = count;
+    return true;
+}
+
+//! Service TRAP_TIME
+static bool trap_time(Machine *pmach, unsigned addr)
+{
+    (void) addr;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    pmach->_registers[0] = (Word) ts.tv_sec;
+    pmach->_registers[1] = (Word) (ts.tv_nsec / 1000);
+    return true;
+}
+
+//! Table des services (indexée par le numéro)
+Trap_Service trap_table[TRAP_MAXSERVICES] = {
+    [TRAP_EXIT] = { "exit", trap_exit, TRAP_NOACCESS },
+    [TRAP_READ] = { "read", trap_read, TRAP_DATA_WRITE },
+    [TRAP_WRITE] = { "write", trap_write, TRAP_DATA_READ },
+    [TRAP_TIME] = { "time", trap_time, TRAP_NOACCESS },
+};
+
+//! Ajout ou remplacement d'un service
+/*!
+ * \param number le numéro du service (moins de \c TRAP_MAXSERVICES)
+ * \param name son nom
+ * \param handler sa réalisation (NULL : retrait du service)
+ * \param access ses accès au segment de données
+ * \return faux si le numéro est invalide
+ */
+bool trap_register(unsigned number, const char *name, Trap_Handler handler, Trap_Access access)
+{
+    if (number >= TRAP_MAXSERVICES)
+        return false;
+    trap_table[number] = (Trap_Service) { name, handler, access };
+    return true;
+}
+
+//! Exécution d'un service (instruction TRAP)
+/*!
+ * \param pmach la machine
+ * \param number le numéro du service
+ * \param addr adresse de l'instruction en cours (pour les erreurs)
+ * \return faux pour arrêter l'exécution
+ */
+bool trap_call(Machine *pmach, Word number, unsigned addr)
+{
+    const Trap_Service *ps = trap_service(number);
+    if (ps == NULL)
+        EXEC_FAULT(ERR_TRAP, addr);
+    bool running = ps->_handler(pmach, addr);
+    refresh_code_cond(pmach, pmach->_registers[0]);
+    return running;
+}
@@ -0,0 +1,112 @@
+#ifndef _TRAP_H_
+#define _TRAP_H_
+
+/*!
+ * \file trap.h
+ * \brief Appels de services de l'hôte (instruction TRAP).
+ *
+ * L'instruction <tt>TRAP #n</tt> appelle le service numéro \c n de la table
+ * des services de l'hôte. Les arguments sont passés dans les registres R00,
+ * R01 et R02 ; le résultat est rendu dans R00 (et R01 si besoin) et le code
+ * condition reçoit le signe de R00. Un bloc est toujours transféré d'un seul
+ * coup, par un seul appel système quand c'est possible.
+ *
+ * Services prédéfinis :
+ *
+ *  - \c TRAP_EXIT : arrêt du programme (comme \c HALT) avec le code de
+ *    retour R00, rangé dans \c _status ;
+ *
+ *  - \c TRAP_READ : lecture d'au plus R02 mots depuis le descripteur de
+ *    fichier R00 de l'hôte vers Data[R01...] ; R00 reçoit le nombre de mots
+ *    lus (0 en fin de fichier, -1 en cas d'erreur), un dernier mot incomplet
+ *    étant complété par des zéros ;
+ *
+ *  - \c TRAP_WRITE : écriture de R02 mots de Data[R01...] sur le
+ *    descripteur R00 ; R00 reçoit le nombre de mots écrits (-1 en cas
+ *    d'erreur) ;
+ *
+ *  - \c TRAP_TIME : heure de l'hôte, secondes depuis l'origine (32 bits de
+ *    poids faible) dans R00 et microsecondes dans R01.
+ *
+ * Un bloc hors du segment de données provoque l'erreur \c ERR_SEGDATA, un
+ * numéro de service sans service l'erreur \c ERR_TRAP. D'autres services
+ * peuvent être ajoutés (ou les services prédéfinis remplacés) par
+ * trap_register() avant l'exécution.
+ *
+ * \attention Les descripteurs sont ceux du simulateur : le programme simulé
+ * peut lire et écrire tout ce que le simulateur a ouvert.
+ */
+
+#include <stdbool.h>
+
+#include "machine.h"
+
+//! Nombre de services de la table
+#define TRAP_MAXSERVICES 64
+
+//! Numéros des services prédéfinis
+typedef enum
+{
+    TRAP_EXIT = 0,	//!< Arrêt avec un code de retour
+    TRAP_READ,		//!< Lecture d'un bloc depuis un descripteur de l'hôte
+    TRAP_WRITE,		//!< Écriture d'un bloc sur un descripteur de l'hôte
+    TRAP_TIME,		//!< Heure de l'hôte
+} Trap_Number;
+
+//! Accès d'un service au segment de données (modèles et crochets des moteurs)
+typedef enum
+{
+    TRAP_NOACCESS = 0,	//!< Aucun accès
+    TRAP_DATA_READ,	//!< Lecture du bloc Data[R01..R01 + R02[
+    TRAP_DATA_WRITE,	//!< Écriture du bloc Data[R01..R01 + R02[
+} Trap_Access;
+
+//! Réalisation d'un service
+/*!
+ * \param pmach la machine
+ * \param addr adresse de l'instruction en cours (pour les erreurs)
+ * \return faux pour arrêter l'exécution
+ */
+typedef bool (*Trap_Handler)(Machine *pmach, unsigned addr);
+
+//! Entrée de la table des services
+typedef struct
+{
+    const char *_name;		//!< Nom du service (NULL : pas de service)
+    Trap_Handler _handler;	//!< Réalisation
+    Trap_Access _access;	//!< Accès au segment de données
+} Trap_Service;
+
+//! Table des services (indexée par le numéro)
+extern Trap_Service trap_table[TRAP_MAXSERVICES];
+
+//! Service d'un numéro
+/*!
+ * \param number le numéro
+ * \return le service, ou NULL s'il n'y en a pas
+ */
+static inline const Trap_Service *trap_service(Word number)
+{
+    return number < TRAP_MAXSERVICES && trap_table[number]._handler != NULL ? &trap_table[number] : NULL;
+}
+
+//! Ajout ou remplacement d'un service
+/*!
+ * \param number le numéro du service (moins de \c TRAP_MAXSERVICES)
+ * \param name son nom
+ * \param handler sa réalisation (NULL : retrait du service)
+ * \param access ses accès au segment de données
+ * \return faux si le numéro est invalide
+ */
+bool trap_register(unsigned number, const char *name, Trap_Handler handler, Trap_Access access);
+
+//! Exécution d'un service (instruction TRAP)
+/*!
+ * \param pmach la machine
+ * \param number le numéro du service
+ * \param addr adresse de l'instruction en cours (pour les erreurs)
+ * \return faux pour arrêter l'exécution
+ */
+bool trap_call(Machine *pmach, Word number, unsigned addr);
+
+#endif